@@ -0,0 +1,149 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <chrono>
+
+#include "I3D.h"
+#include "I3D_simd.h"
+#include "I3D_texture_compress.h"
+
+#include <EASTL/vector.h>
+namespace ea = eastl;
+
+static uint32_t nextRandom(uint32_t& state) {
+    state = state * 1664525u + 1013904223u;
+    return state >> 8;
+}
+
+//----------------------------
+// reference decoders, as the GPU reads the blocks
+
+static void decode565(uint16_t color, int rgb[3]) {
+    const int r = color >> 11, g = (color >> 5) & 63, b = color & 31;
+    rgb[0] = (r << 3) | (r >> 2);
+    rgb[1] = (g << 2) | (g >> 4);
+    rgb[2] = (b << 3) | (b >> 2);
+}
+
+static void decodeColor(const uint8_t* src, uint32_t* pixels) {
+    uint16_t c0, c1;
+    uint32_t indices;
+    memcpy(&c0, src, 2);
+    memcpy(&c1, src + 2, 2);
+    memcpy(&indices, src + 4, 4);
+
+    int palette[4][3];
+    decode565(c0, palette[0]);
+    decode565(c1, palette[1]);
+    for(int c = 0; c < 3; ++c) {
+        palette[2][c] = c0 > c1 ? (2 * palette[0][c] + palette[1][c]) / 3 : (palette[0][c] + palette[1][c]) / 2;
+        palette[3][c] = c0 > c1 ? (palette[0][c] + 2 * palette[1][c]) / 3 : 0;
+    }
+
+    for(int i = 0; i < 16; ++i) {
+        const int* rgb = palette[(indices >> (2 * i)) & 3];
+        pixels[i] = (pixels[i] & 0xff000000) | uint32_t(rgb[0]) | (uint32_t(rgb[1]) << 8) | (uint32_t(rgb[2]) << 16);
+    }
+}
+
+static void decodeAlpha(const uint8_t* src, uint32_t* pixels) {
+    const int a0 = src[0], a1 = src[1];
+    int palette[8] = { a0, a1 };
+    if(a0 > a1) {
+        for(int i = 1; i < 7; ++i) palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+    } else {
+        for(int i = 1; i < 5; ++i) palette[i + 1] = ((5 - i) * a0 + i * a1) / 5;
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+
+    uint64_t indices = 0;
+    for(int i = 0; i < 6; ++i) indices |= uint64_t(src[2 + i]) << (8 * i);
+    for(int i = 0; i < 16; ++i)
+        pixels[i] = (pixels[i] & 0x00ffffff) | (uint32_t(palette[(indices >> (3 * i)) & 7]) << 24);
+}
+
+static double psnr(double squaredError, double count) {
+    return squaredError > 0.0 ? 10.0 * log10(255.0 * 255.0 * count / squaredError) : 99.0;
+}
+
+// bcbench [size] [runs] - BC1 and BC3 encodes a size x size test image (smooth gradients with
+// noise, alpha that's opaque, cut out or soft by region) with every compress kernel set this CPU
+// runs. Checks that all sets give the same bits as the scalar one, prints GB/s of source pixels
+// and PSNR of the decoded blocks.
+int main(int argc, char** argv) {
+    const uint32_t size = glm::max(argc > 1 ? uint32_t(atoi(argv[1])) : 1024u, 4u) & ~3u;
+    const uint32_t numRuns = argc > 2 ? uint32_t(atoi(argv[2])) : 10;
+    const uint32_t numBlocks = (size / 4) * (size / 4);
+    const double sourceGB = double(numBlocks) * 64.0 / (1024.0 * 1024.0 * 1024.0);
+
+    // blocks in the encoders' layout, 16 pixels row by row
+    uint32_t state = 1;
+    ea::vector<uint32_t> blocks(size_t(numBlocks) * 16);
+    for(uint32_t y = 0; y < size; ++y) {
+        for(uint32_t x = 0; x < size; ++x) {
+            const uint32_t noise = nextRandom(state) % 6;
+            const uint32_t r = glm::min(x * 255 / size + noise, 255u);
+            const uint32_t g = glm::min(y * 255 / size + noise, 255u);
+            const uint32_t b = glm::min((x + y) * 127 / size + noise, 255u);
+            const uint32_t region = (x / 64 + y / 64) % 3;
+            const uint32_t a = region == 0 ? 255 : region == 1 ? (((x / 4 + y / 4) & 1) ? 255 : 0) : (x * 4) & 0xff;
+
+            const size_t block = size_t(y / 4) * (size / 4) + x / 4;
+            blocks[block * 16 + (y & 3) * 4 + (x & 3)] = r | (g << 8) | (b << 16) | (a << 24);
+        }
+    }
+
+    const uint32_t cpuFeatures = I3D_GetCPUFeatures();
+    bool allMatch = true;
+    for(I3D_TEXTURE_FORMAT format : { TXTFMT_BC1, TXTFMT_BC3 }) {
+        const size_t blockSize = format == TXTFMT_BC1 ? 8 : 16;
+        ea::vector<uint8_t> reference;
+        ea::vector<uint8_t> encoded(numBlocks * blockSize);
+        for(uint32_t features : { 0u, uint32_t(CPUF_SSE2) }) {
+            if((cpuFeatures & features) != features) continue;
+
+            const I3D_compress_kernels& kernels = I3D_GetCompressKernels(features);
+            const auto encode = format == TXTFMT_BC1 ? kernels.encodeBC1 : kernels.encodeBC3;
+            const auto start = std::chrono::steady_clock::now();
+            for(uint32_t r = 0; r < numRuns; ++r)
+                encode(encoded.data(), blocks.data(), numBlocks);
+            const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / numRuns;
+
+            bool match = true;
+            if(reference.empty())
+                reference = encoded;
+            else
+                match = memcmp(reference.data(), encoded.data(), encoded.size()) == 0;
+            allMatch = allMatch && match;
+
+            printf("BC%u %-8s %.3f ms, %.2f GB/s%s\n", format == TXTFMT_BC1 ? 1 : 3, kernels.name, ms, sourceGB / (ms / 1000.0),
+                match ? "" : ", MISMATCH");
+        }
+
+        // BC1 keeps color only, alpha is compared for BC3
+        double colorError = 0.0, alphaError = 0.0;
+        uint32_t decoded[16];
+        for(uint32_t i = 0; i < numBlocks; ++i) {
+            const uint32_t* source = blocks.data() + size_t(i) * 16;
+            const uint8_t* block = reference.data() + i * blockSize;
+            for(int p = 0; p < 16; ++p) decoded[p] = source[p] | 0xff000000;
+            if(format == TXTFMT_BC3) decodeAlpha(block, decoded);
+            decodeColor(format == TXTFMT_BC3 ? block + 8 : block, decoded);
+
+            for(int p = 0; p < 16; ++p) {
+                for(int c = 0; c < 24; c += 8) {
+                    const double e = double((decoded[p] >> c) & 0xff) - double((source[p] >> c) & 0xff);
+                    colorError += e * e;
+                }
+                const double e = double(decoded[p] >> 24) - double(source[p] >> 24);
+                alphaError += e * e;
+            }
+        }
+        printf("BC%u psnr color %.2f dB", format == TXTFMT_BC1 ? 1 : 3, psnr(colorError, double(numBlocks) * 48.0));
+        if(format == TXTFMT_BC3) printf(", alpha %.2f dB", psnr(alphaError, double(numBlocks) * 16.0));
+        printf("\n");
+    }
+    return allMatch ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,80 @@
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+
+#include "I3D.h"
+#include "I3D_driver.h"
+#include "I3D_cull.h"
+#include "I3D_simd.h"
+
+#include <glm/glm.hpp>
+#include <glm/ext.hpp>
+
+static uint32_t nextRandom(uint32_t& state) {
+    state = state * 1664525u + 1013904223u;
+    return state >> 8;
+}
+
+static float randomFloat(uint32_t& state, float min, float max) {
+    return min + (max - min) * float(nextRandom(state) & 0xffff) / 65535.0f;
+}
+
+// cullbench [boxes] [runs] - culls random boxes and their bounding spheres against a camera
+// frustum on one core with every cull kernel set this CPU runs. Prints time per run and boxes per
+// second, and checks the visible lists of all sets against the scalar one.
+int main(int argc, char** argv) {
+    const uint32_t count = argc > 1 ? uint32_t(atoi(argv[1])) : 1000000;
+    const uint32_t numRuns = argc > 2 ? uint32_t(atoi(argv[2])) : 20;
+
+    // boxes all around the camera, roughly a fifth of them in the view
+    uint32_t state = 1;
+    ea::vector<I3D_bbox> boxes(count);
+    ea::vector<I3D_bsphere> spheres(count);
+    for(uint32_t i = 0; i < count; ++i) {
+        const glm::vec3 center(randomFloat(state, -500.0f, 500.0f), randomFloat(state, -50.0f, 50.0f), randomFloat(state, -500.0f, 500.0f));
+        const glm::vec3 extent(randomFloat(state, 0.5f, 5.0f), randomFloat(state, 0.5f, 5.0f), randomFloat(state, 0.5f, 5.0f));
+        boxes[i] = I3D_bbox(center - extent, center + extent);
+        spheres[i] = I3D_bsphere(center, glm::length(extent));
+    }
+
+    I3D_driver driver{};
+    I3D_camera* camera = I3DCAST_CAMERA(driver.createFrame(FRAME_CAMERA));
+    camera->setFOV(glm::radians(65.0f));
+    camera->setRange(glm::vec2(0.5f, 400.0f));
+    glm::vec3 eye(0.0f, 2.0f, 0.0f);
+    camera->setPos(eye);
+    camera->updateCameraMatrices(16.0f / 9.0f);
+    const I3D_frustum frustum = camera->getFrustum();
+    camera->release();
+
+    ea::vector<uint32_t> reference[2];
+    ea::vector<uint32_t> visible(count);
+    const uint32_t cpuFeatures = I3D_GetCPUFeatures();
+    bool allMatch = true;
+    for(uint32_t features : { 0u, uint32_t(CPUF_SSE2), uint32_t(CPUF_SSE2 | CPUF_AVX2) }) {
+        if((cpuFeatures & features) != features) continue;
+
+        const I3D_cull_kernels& kernels = I3D_GetCullKernels(features);
+        for(uint32_t type = 0; type < 2; ++type) {
+            uint32_t numVisible = 0;
+            const auto start = std::chrono::steady_clock::now();
+            for(uint32_t r = 0; r < numRuns; ++r) {
+                numVisible = type ? kernels.cullSpheres(frustum, spheres.data(), count, visible.data())
+                    : kernels.cullBoxes(frustum, boxes.data(), count, visible.data());
+            }
+            const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / numRuns;
+
+            // visible lists must be the same whatever the instruction set
+            bool match = true;
+            if(reference[type].empty())
+                reference[type].assign(visible.begin(), visible.begin() + numVisible);
+            else
+                match = numVisible == reference[type].size() && ea::equal(reference[type].begin(), reference[type].end(), visible.begin());
+            allMatch = allMatch && match;
+
+            printf("%-8s %-7s %u visible, %.3f ms, %.1f M/s%s\n", kernels.name, type ? "spheres" : "boxes", numVisible, ms,
+                double(count) / (ms * 1000.0), match ? "" : ", MISMATCH");
+        }
+    }
+    return allMatch ? 0 : 1;
+}
\ No newline at end of file
@@ -1,33 +1,20 @@
 #include <iostream>
+#include <string>
 #include "IDevice.h"
 #include "IGraph.h"
 
 #include "I3D.h"
 #include "I3D_driver.h"
+#include "I3D_scene.h"
+#include "I3D_pvs.h"
+#include "Loader_4DS.h"
 
 #include <glm/glm.hpp>
 #include <glm/ext.hpp>
 
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
-
 #define ARRAY_LEN(X) sizeof(X) / sizeof(X[0])
 
-Image loadTextureFromFile(IDevice* device, const char* file) {
-    int w = 0, h = 0, channels = 0;
-    auto* data = stbi_load("chopin.jpg", &w, &h, &channels, 4);
-
-    ImageDesc imageDesc{};
-    imageDesc.width = w;
-    imageDesc.height = h;
-    imageDesc.data.subimage[0][0] = sg_range{ data, size_t(w * h * 4) };
-
-    Image texture = device->createImage(imageDesc);
-    STBI_FREE(data);
-    return texture;
-}
-
-int main() {
+int main(int argc, char** argv) {
     IGraph graph{};
     I3D_driver driver{};
 
@@ -36,7 +23,48 @@ int main() {
     graph.init(800, 600, "Demo");
 
     auto* device = graph.getDevice();
-    auto texture = loadTextureFromFile(device, "chopin.jpg");
+    driver.init(device);
+
+    // loads in the background, shows a placeholder until then
+    I3D_texture texture(&driver);
+    I3D_CREATETEXTURE textureParams{};
+    textureParams._flags = TXTMAP_DIFFUSE;
+    textureParams._diffuse = I3D_name("chopin.jpg");
+    texture.open(textureParams);
+
+    // demo <model.4ds> [texture dir] - the model is cooked to <model.4ds>.cooked on first run
+    // and loaded from there while the source doesn't change; sector visibility baked by pvsbake
+    // is read from <model.4ds>.pvs
+    I3D_pvs pvs;
+    I3D_scene scene(&driver);
+    if(argc > 1) {
+        Loader_4DS loader(&driver);
+        if(argc > 2) loader.setTexturePath(argv[2]);
+
+        const std::string cookedName = std::string(argv[1]) + ".cooked";
+        I3D_RESULT result = loader.openCooked(cookedName.c_str(), argv[1]);
+        const bool cooked = result == I3D_OK;
+        if(!cooked) {
+            result = loader.open(argv[1]);
+            if(result == I3D_OK && loader.cook(cookedName.c_str()) != I3D_OK)
+                printf("can't write %s\n", cookedName.c_str());
+        }
+
+        if(result == I3D_OK) result = loader.create(scene.getPrimarySector());
+        loader.close();
+
+        const I3D_LOAD_STATS& stats = loader.getStats();
+        printf("%s (%s): result %d, %u frames, %u meshes, %u textures\n", argv[1], cooked ? "cooked" : "source",
+            result, stats.numFrames, stats.numMeshes, stats.numTextures);
+        printf("parse %.2f ms, build %.2f ms, decode %.2f ms, create %.2f ms, upload %.2f ms\n",
+            stats.parseMs, stats.buildMs, stats.decodeMs, stats.createMs, stats.uploadMs);
+
+        const std::string pvsName = std::string(argv[1]) + ".pvs";
+        if(pvs.load(pvsName.c_str(), argv[1]) == I3D_OK) {
+            scene.setPVS(&pvs);
+            printf("%s: %u sectors\n", pvsName.c_str(), pvs.getNumSectors());
+        }
+    }
 
     struct Vertex {
         glm::vec3 p;
@@ -83,7 +111,6 @@ int main() {
     Buffer vindex = device->createBuffer(bufferDescIndex);
     device->bindIndexBuffer(vindex);
 
-    device->bindImage(texture, 0);
     
     const auto& windowSize = graph.getWindowSize();
     auto projMatrix = glm::perspectiveLH(glm::radians(45.0f), float(windowSize.x / (float)windowSize.y), 0.1f, 100.0f);
@@ -92,7 +119,9 @@ int main() {
    
     while(!graph.closeRequested()) {
         graph.pollEvents();
+        driver.tick();
         device->clear();
+        device->bindImage(texture.getTextureHandle(), 0);
 
         if(graph.isKeyDown(KEY_A)) {
             targetPosition.x += 0.01f;
@@ -119,7 +148,6 @@ int main() {
         graph.render();
     }
 
-    device->destroyImage(texture);
     device->destroyBuffer(vbuffer);
     device->destroyBuffer(vindex);
     return 0;
@@ -0,0 +1,143 @@
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+
+#include "I3D.h"
+#include "I3D_driver.h"
+#include "I3D_scene.h"
+#include "Loader_4DS.h"
+
+#include <glm/glm.hpp>
+#include <glm/ext.hpp>
+
+// sphere of 'rings' x 2 * 'rings' quads, a cheaper LOD per halving
+static void buildSphere(uint32_t rings, ea::vector<I3D_vertex>& vertices, ea::vector<uint16_t>& indices) {
+    const uint32_t segments = rings * 2;
+    for(uint32_t r = 0; r <= rings; ++r) {
+        const float phi = glm::pi<float>() * float(r) / float(rings);
+        for(uint32_t s = 0; s <= segments; ++s) {
+            const float theta = glm::two_pi<float>() * float(s) / float(segments);
+            const glm::vec3 normal(glm::sin(phi) * glm::cos(theta), glm::cos(phi), glm::sin(phi) * glm::sin(theta));
+            vertices.push_back({ normal, normal, glm::vec2(float(s) / float(segments), float(r) / float(rings)) });
+        }
+    }
+    for(uint32_t r = 0; r < rings; ++r) {
+        for(uint32_t s = 0; s < segments; ++s) {
+            const uint16_t a = uint16_t(r * (segments + 1) + s);
+            const uint16_t b = uint16_t(a + segments + 1);
+            indices.insert(indices.end(), { a, b, uint16_t(a + 1), uint16_t(a + 1), b, uint16_t(b + 1) });
+        }
+    }
+}
+
+static void collectVisuals(I3D_frame* frame, ea::vector<I3D_visual*>& visuals) {
+    for(I3D_frame* child = frame->getFirstChild(); child; child = child->getNextSibling()) {
+        if(child->getFrameType() == FRAME_VISUAL) visuals.push_back(I3DCAST_VISUAL(child));
+        collectVisuals(child, visuals);
+    }
+}
+
+// lodscene [model.4ds] [instances] - places instances of a model (a sphere with 4 LODs without
+// one) on a grid, flies a camera over them and picks LODs every frame. Prints the vertices of the
+// picked LODs against the most detailed ones, and how often LODs switch with and without
+// hysteresis. No window or device, only the CPU side runs.
+int main(int argc, char** argv) {
+    const uint32_t numInstances = argc > 2 ? uint32_t(atoi(argv[2])) : 10000;
+    const uint32_t numFrames = 600;
+
+    I3D_driver driver{};
+    I3D_scene scene(&driver);
+
+    // the prototype stays out of the scene, instances are copies of it
+    I3D_model* prototype = I3DCAST_MODEL(driver.createFrame(FRAME_MODEL));
+    ea::vector<I3D_vertex> sphereVertices[4];
+    ea::vector<uint16_t> sphereIndices[4];
+    if(argc > 1 && argv[1][0]) {
+        Loader_4DS loader(&driver);
+        I3D_RESULT result = loader.open(argv[1]);
+        if(result == I3D_OK) result = loader.create(prototype);
+        loader.close();
+        if(result != I3D_OK) {
+            printf("can't load %s: result %d\n", argv[1], result);
+            return 1;
+        }
+    } else {
+        const float distances[4] = { 0.0f, 30.0f, 70.0f, 150.0f };
+        auto mesh = ea::make_shared<I3D_mesh>();
+        for(uint32_t l = 0; l < 4; ++l) {
+            buildSphere(32 >> l, sphereVertices[l], sphereIndices[l]);
+            I3D_mesh_lod& lod = mesh->addLod(distances[l], sphereVertices[l].data(), uint32_t(sphereVertices[l].size()));
+            mesh->addFaceGroup(lod, nullptr, sphereIndices[l].data(), uint32_t(sphereIndices[l].size()));
+        }
+        mesh->setBBox(I3D_bbox(glm::vec3(-1.0f), glm::vec3(1.0f)));
+        mesh->upload(nullptr);
+
+        I3D_visual* visual = I3DCAST_VISUAL(driver.createFrame(FRAME_VISUAL));
+        visual->setMesh(mesh);
+        prototype->addChild(visual);
+        visual->release();
+    }
+
+    const auto createStart = std::chrono::steady_clock::now();
+    const uint32_t side = uint32_t(glm::ceil(glm::sqrt(float(numInstances))));
+    const float spacing = 4.0f;
+    ea::vector<I3D_frame*> instances(numInstances);
+    driver.createFrames(FRAME_MODEL, numInstances, instances.data());
+
+    ea::vector<I3D_visual*> visuals;
+    for(uint32_t i = 0; i < numInstances; ++i) {
+        I3D_model* instance = I3DCAST_MODEL(instances[i]);
+        instance->duplicate(prototype);
+        glm::vec3 pos((float(i % side) - float(side) * 0.5f) * spacing, 0.0f, float(i / side) * spacing);
+        instance->setPos(pos);
+        scene.getPrimarySector()->addChild(instance);
+        instance->release();
+        collectVisuals(instance, visuals);
+    }
+    prototype->release();
+    const double createMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - createStart).count();
+    printf("%u instances, %zu visuals, created in %.2f ms\n", numInstances, visuals.size(), createMs);
+
+    I3D_camera* camera = I3DCAST_CAMERA(driver.createFrame(FRAME_CAMERA));
+    camera->setFOV(glm::radians(65.0f));
+    camera->setRange(glm::vec2(0.5f, 400.0f));
+
+    for(float hysteresis : { 0.1f, 0.0f }) {
+        uint64_t lodVertices = 0, fullVertices = 0;
+        uint32_t numSwitches = 0;
+        double selectMs = 0.0;
+        // start over, setting the mesh forgets the LOD
+        for(I3D_visual* visual : visuals)
+            visual->setMesh(visual->getMesh());
+
+        for(uint32_t f = 0; f < numFrames; ++f) {
+            // down the grid and back, swaying a little, so visuals cross LOD distances both ways
+            const float t = float(f) / float(numFrames);
+            glm::vec3 eye(glm::sin(t * 12.0f) * 6.0f, 3.0f, (1.0f - glm::abs(t * 2.0f - 1.0f)) * float(side) * spacing * 0.6f);
+            camera->setPos(eye);
+            camera->setRot(glm::angleAxis(glm::sin(t * 7.0f) * 0.4f, glm::vec3(0.0f, 1.0f, 0.0f)));
+            driver.tick();
+
+            const auto start = std::chrono::steady_clock::now();
+            I3D_LOD_VIEW view(camera);
+            view.hysteresis = hysteresis;
+            for(I3D_visual* visual : visuals) {
+                const uint32_t previous = visual->getLod();
+                const uint32_t lod = visual->updateLod(view);
+                if(lod == I3D_visual::NO_LOD) continue;
+
+                numSwitches += previous != I3D_visual::NO_LOD && previous != lod;
+                lodVertices += visual->getMesh()->getLod(lod).numVertices;
+                fullVertices += visual->getMesh()->getLod(0).numVertices;
+            }
+            selectMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        printf("hysteresis %.2f: %.0f vertices per frame with LODs, %.0f without (%.1f%%), %.1f LOD switches per frame, select %.3f ms\n",
+            hysteresis, double(lodVertices) / numFrames, double(fullVertices) / numFrames,
+            fullVertices ? 100.0 * double(lodVertices) / double(fullVertices) : 0.0, double(numSwitches) / numFrames, selectMs / numFrames);
+    }
+
+    camera->release();
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,88 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+
+#include "I3D.h"
+#include "I3D_simd.h"
+#include "I3D_mipmap.h"
+
+#include <EASTL/vector.h>
+namespace ea = eastl;
+
+static uint32_t nextRandom(uint32_t& state) {
+    state = state * 1664525u + 1013904223u;
+    return state >> 8;
+}
+
+// mipbench [size] [runs] - downsamples a size x size RGBA8 level with every mipmap kernel set this
+// CPU runs, as stored and in linear light (sRGB), and builds whole chains with I3D_GenerateMips.
+// Prints MB/s of source pixels and checks every set against the scalar one.
+int main(int argc, char** argv) {
+    const uint32_t size = glm::max(argc > 1 ? uint32_t(atoi(argv[1])) : 2048u, 2u) & ~1u;
+    const uint32_t numRuns = argc > 2 ? uint32_t(atoi(argv[2])) : 10;
+    const uint32_t half = size / 2;
+    const double sourceMB = double(size) * size * 4.0 / (1024.0 * 1024.0);
+
+    // gradients with noise, alpha tested in patches
+    uint32_t state = 1;
+    ea::vector<uint32_t> level(size_t(size) * size);
+    for(uint32_t y = 0; y < size; ++y) {
+        for(uint32_t x = 0; x < size; ++x) {
+            const uint32_t noise = nextRandom(state) & 0x0f;
+            const uint32_t r = (x * 255 / size + noise) & 0xff;
+            const uint32_t g = (y * 255 / size + noise) & 0xff;
+            const uint32_t b = ((x + y) * 127 / size) & 0xff;
+            const uint32_t a = ((x / 16 + y / 16) % 3) ? 255 : 0;
+            level[size_t(y) * size + x] = r | (g << 8) | (b << 16) | (a << 24);
+        }
+    }
+
+    ea::vector<uint32_t> reference[2];
+    ea::vector<uint32_t> result(size_t(half) * half);
+    const uint32_t cpuFeatures = I3D_GetCPUFeatures();
+    bool allMatch = true;
+    for(uint32_t features : { 0u, uint32_t(CPUF_SSE2), uint32_t(CPUF_SSE2 | CPUF_AVX2) }) {
+        if((cpuFeatures & features) != features) continue;
+
+        const I3D_mipmap_kernels& kernels = I3D_GetMipmapKernels(features);
+        for(uint32_t srgb = 0; srgb < 2; ++srgb) {
+            const auto downsample = srgb ? kernels.downsampleSRGB : kernels.downsample;
+            const auto start = std::chrono::steady_clock::now();
+            for(uint32_t r = 0; r < numRuns; ++r) {
+                for(uint32_t y = 0; y < half; ++y) {
+                    const uint32_t* row0 = level.data() + size_t(y * 2) * size;
+                    downsample(result.data() + size_t(y) * half, row0, row0 + size, half);
+                }
+            }
+            const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / numRuns;
+
+            bool match = true;
+            if(reference[srgb].empty())
+                reference[srgb] = result;
+            else
+                match = memcmp(reference[srgb].data(), result.data(), result.size() * sizeof(uint32_t)) == 0;
+            allMatch = allMatch && match;
+
+            printf("%-8s %-6s %.3f ms, %.0f MB/s%s\n", kernels.name, srgb ? "srgb" : "linear", ms, sourceMB / (ms / 1000.0),
+                match ? "" : ", MISMATCH");
+        }
+    }
+
+    // whole chains, the way textures get them
+    const uint32_t numLevels = I3D_GetNumMipLevels(size, size);
+    ea::vector<uint8_t> chain(I3D_GetMipChainSize(size, size, numLevels));
+    for(uint32_t flags : { 0u, uint32_t(MIPMAP_SRGB), uint32_t(MIPMAP_SRGB | MIPMAP_ALPHA_COVERAGE) }) {
+        double ms = 0.0;
+        for(uint32_t r = 0; r < numRuns; ++r) {
+            memcpy(chain.data(), level.data(), level.size() * sizeof(uint32_t));
+            const auto start = std::chrono::steady_clock::now();
+            I3D_GenerateMips(chain.data(), size, size, numLevels, flags);
+            ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+        ms /= numRuns;
+        printf("chain %-14s %u levels, %.3f ms, %.0f MB/s\n", flags & MIPMAP_ALPHA_COVERAGE ? "srgb+coverage" : flags ? "srgb" : "linear",
+            numLevels, ms, sourceMB / (ms / 1000.0));
+    }
+    return allMatch ? 0 : 1;
+}
\ No newline at end of file
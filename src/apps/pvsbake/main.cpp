@@ -0,0 +1,64 @@
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <chrono>
+
+#include "I3D.h"
+#include "I3D_driver.h"
+#include "I3D_scene.h"
+#include "I3D_pvs.h"
+#include "I3D_mapped_file.h"
+#include "Loader_4DS.h"
+
+// pvsbake <model.4ds> [samples per axis] - bakes sector visibility of the model to <model.4ds>.pvs,
+// where the demo picks it up. No window or device, textures and buffers aren't created.
+int main(int argc, char** argv) {
+    if(argc < 2) {
+        printf("usage: %s <model.4ds> [samples per axis]\n", argv[0]);
+        return 1;
+    }
+
+    const uint32_t samplesPerAxis = argc > 2 ? uint32_t(atoi(argv[2])) : 8;
+
+    I3D_mapped_file source;
+    if(!source.open(argv[1])) {
+        printf("can't open %s\n", argv[1]);
+        return 1;
+    }
+    const uint64_t sourceHash = I3D_HashData(source.getData(), source.getSize());
+    source.close();
+
+    I3D_driver driver{};
+    I3D_scene scene(&driver);
+
+    Loader_4DS loader(&driver);
+    const std::string cookedName = std::string(argv[1]) + ".cooked";
+    I3D_RESULT result = loader.openCooked(cookedName.c_str(), argv[1]);
+    if(result != I3D_OK) result = loader.open(argv[1]);
+    if(result == I3D_OK) result = loader.create(scene.getPrimarySector());
+    loader.close();
+    if(result != I3D_OK) {
+        printf("can't load %s: result %d\n", argv[1], result);
+        return 1;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    I3D_pvs pvs;
+    pvs.bake(&scene, samplesPerAxis);
+    const double bakeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    uint32_t numVisible = 0;
+    for(uint32_t from = 0; from < pvs.getNumSectors(); ++from) {
+        for(uint32_t to = 0; to < pvs.getNumSectors(); ++to)
+            numVisible += pvs.isVisible(from, to);
+    }
+    printf("%s: %u sectors, %u visible pairs, %zu bytes, bake %.2f ms\n", argv[1], pvs.getNumSectors(), numVisible,
+        pvs.getDataSize(), bakeMs);
+
+    const std::string pvsName = std::string(argv[1]) + ".pvs";
+    if(pvs.save(pvsName.c_str(), sourceHash) != I3D_OK) {
+        printf("can't write %s\n", pvsName.c_str());
+        return 1;
+    }
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,99 @@
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+
+#include "I3D.h"
+#include "I3D_simd.h"
+#include "I3D_transform.h"
+
+#include <EASTL/vector.h>
+namespace ea = eastl;
+
+#include <glm/glm.hpp>
+#include <glm/ext.hpp>
+#include <glm/gtx/quaternion.hpp>
+
+static uint32_t nextRandom(uint32_t& state) {
+    state = state * 1664525u + 1013904223u;
+    return state >> 8;
+}
+
+static float randomFloat(uint32_t& state, float min, float max) {
+    return min + (max - min) * float(nextRandom(state) & 0xffff) / 65535.0f;
+}
+
+// largest difference of matrix elements, relative to the element where it's above 1
+static float maxDifference(const ea::vector<glm::mat4>& a, const ea::vector<glm::mat4>& b) {
+    float diff = 0.0f;
+    for(size_t i = 0; i < a.size(); ++i) {
+        for(int c = 0; c < 4; ++c)
+            diff = glm::max(diff, glm::compMax(glm::abs(a[i][c] - b[i][c]) / glm::max(glm::abs(b[i][c]), 1.0f)));
+    }
+    return diff;
+}
+
+template<typename Fn>
+static double timeMs(uint32_t numRuns, Fn&& fn) {
+    const auto start = std::chrono::steady_clock::now();
+    for(uint32_t r = 0; r < numRuns; ++r) fn();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / numRuns;
+}
+
+// simdbench [transforms] [runs] - times local (compose TRS) and world (parent * local) matrices
+// of random transforms, with the old glm path (translate * toMat4 * scale, full mat4 multiply)
+// and every transform kernel set this CPU runs. Kernel results are checked against glm.
+int main(int argc, char** argv) {
+    const uint32_t count = argc > 1 ? uint32_t(atoi(argv[1])) : 100000;
+    const uint32_t numRuns = argc > 2 ? uint32_t(atoi(argv[2])) : 50;
+
+    // groups of 16 under a root, parents always precede children, like slots of the transform store
+    uint32_t state = 1;
+    ea::vector<glm::vec3> pos(count), scale(count);
+    ea::vector<glm::quat> rot(count);
+    ea::vector<uint32_t> parents(count), slots(count);
+    for(uint32_t i = 0; i < count; ++i) {
+        pos[i] = glm::vec3(randomFloat(state, -10.0f, 10.0f), randomFloat(state, -10.0f, 10.0f), randomFloat(state, -10.0f, 10.0f));
+        scale[i] = glm::vec3(randomFloat(state, 0.5f, 1.5f), randomFloat(state, 0.5f, 1.5f), randomFloat(state, 0.5f, 1.5f));
+        const glm::vec3 axis(randomFloat(state, -1.0f, 1.0f), randomFloat(state, -1.0f, 1.0f), randomFloat(state, 0.1f, 1.0f));
+        rot[i] = glm::angleAxis(randomFloat(state, -3.0f, 3.0f), glm::normalize(axis));
+        parents[i] = i % 16 == 0 ? I3D_XFORM_NONE : i - 1 - nextRandom(state) % (i % 16);
+        slots[i] = i;
+    }
+
+    ea::vector<glm::mat4> glmLocal(count), glmWorld(count);
+    const double glmComposeMs = timeMs(numRuns, [&]() {
+        for(uint32_t i = 0; i < count; ++i)
+            glmLocal[i] = glm::translate(glm::mat4(1.0f), pos[i]) * glm::toMat4(rot[i]) * glm::scale(glm::mat4(1.0f), scale[i]);
+    });
+    const double glmConcatMs = timeMs(numRuns, [&]() {
+        for(uint32_t i = 0; i < count; ++i)
+            glmWorld[i] = parents[i] != I3D_XFORM_NONE ? glmWorld[parents[i]] * glmLocal[i] : glmLocal[i];
+    });
+    printf("%-8s compose %.3f ms, concat %.3f ms\n", "glm", glmComposeMs, glmConcatMs);
+
+    // kernels round differently (fused multiply-adds, fewer operations), errors grow down chains
+    const float tolerance = 1e-4f;
+    const uint32_t cpuFeatures = I3D_GetCPUFeatures();
+    bool allMatch = true;
+    for(uint32_t features : { 0u, uint32_t(CPUF_SSE2), uint32_t(CPUF_SSE2 | CPUF_AVX2) }) {
+        if((cpuFeatures & features) != features) continue;
+
+        const I3D_xform_kernels& kernels = I3D_GetXformKernels(features);
+        ea::vector<glm::mat4> local(count), world(count);
+        const double composeMs = timeMs(numRuns, [&]() {
+            kernels.composeTRS(local.data(), pos.data(), rot.data(), scale.data(), slots.data(), count);
+        });
+        const double concatMs = timeMs(numRuns, [&]() {
+            kernels.concatAffine(world.data(), local.data(), parents.data(), slots.data(), count);
+        });
+
+        const float localDiff = maxDifference(local, glmLocal);
+        const float worldDiff = maxDifference(world, glmWorld);
+        const bool match = localDiff < tolerance && worldDiff < tolerance;
+        allMatch = allMatch && match;
+
+        printf("%-8s compose %.3f ms (%.2fx), concat %.3f ms (%.2fx), max difference %g / %g%s\n", kernels.name,
+            composeMs, glmComposeMs / composeMs, concatMs, glmConcatMs / concatMs, localDiff, worldDiff, match ? "" : ", MISMATCH");
+    }
+    return allMatch ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,87 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <thread>
+
+#include "I3D.h"
+#include "I3D_jobs.h"
+#include "I3D_transform.h"
+
+#include <glm/glm.hpp>
+#include <glm/ext.hpp>
+
+// same tree every run
+static uint32_t nextRandom(uint32_t& state) {
+    state = state * 1664525u + 1013904223u;
+    return state >> 8;
+}
+
+// Root, 'numObjects' animated objects under it, the rest hung randomly below the objects, which
+// gives subtrees of very different sizes and depths like a real scene.
+static void buildTree(I3D_transform_store& store, uint32_t numNodes, uint32_t numObjects, ea::vector<I3D_xform>& nodes) {
+    uint32_t state = 1;
+    nodes.push_back(store.create());
+    for(uint32_t i = 1; i < numNodes; ++i) {
+        const I3D_xform xf = store.create();
+        const I3D_xform parent = i <= numObjects ? nodes[0] : nodes[1 + nextRandom(state) % (i - 1)];
+        store.setParent(xf, parent);
+        store.setPos(xf, glm::vec3(float(nextRandom(state) % 100) * 0.1f, 0.0f, 1.0f));
+        store.setRot(xf, glm::angleAxis(float(nextRandom(state) % 360) * 0.01745f, glm::vec3(0.0f, 1.0f, 0.0f)));
+        nodes.push_back(xf);
+    }
+}
+
+// xformbench [nodes] [frames] [max threads] - resolves world matrices of a synthetic tree with 1 to
+// N threads, every frame all objects move, so the whole tree is dirty. Prints update() time per
+// thread count and checks the matrices against the single thread run.
+int main(int argc, char** argv) {
+    const uint32_t numNodes = argc > 1 ? uint32_t(atoi(argv[1])) : 100000;
+    const uint32_t numFrames = argc > 2 ? uint32_t(atoi(argv[2])) : 100;
+    const uint32_t numObjects = glm::max(numNodes / 100, 1u);
+    const uint32_t maxThreads = glm::max(argc > 3 ? uint32_t(atoi(argv[3])) : std::thread::hardware_concurrency(), 1u);
+
+    ea::vector<uint32_t> threadCounts;
+    for(uint32_t n = 1; n < maxThreads; n *= 2)
+        threadCounts.push_back(n);
+    threadCounts.push_back(maxThreads);
+
+    ea::vector<glm::mat4> reference;
+    double referenceMs = 0.0;
+    bool allMatch = true;
+    for(uint32_t numThreads : threadCounts) {
+        I3D_jobs jobs;
+        if(numThreads > 1) jobs.init(numThreads - 1);
+
+        I3D_transform_store store;
+        ea::vector<I3D_xform> nodes;
+        buildTree(store, numNodes, numObjects, nodes);
+        store.update(numThreads > 1 ? &jobs : nullptr);
+
+        double totalMs = 0.0;
+        for(uint32_t f = 0; f < numFrames; ++f) {
+            const float angle = float(f) * 0.01f;
+            for(uint32_t i = 1; i <= numObjects && i < numNodes; ++i)
+                store.setRot(nodes[i], glm::angleAxis(angle + float(i), glm::vec3(0.0f, 1.0f, 0.0f)));
+
+            const auto start = std::chrono::steady_clock::now();
+            store.update(numThreads > 1 ? &jobs : nullptr);
+            totalMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        // matrices must not depend on the number of threads
+        bool match = true;
+        if(reference.empty()) {
+            for(I3D_xform xf : nodes) reference.push_back(store.getMatrix(xf));
+            referenceMs = totalMs;
+        } else {
+            for(uint32_t i = 0; i < numNodes && match; ++i)
+                match = memcmp(&reference[i], &store.getMatrix(nodes[i]), sizeof(glm::mat4)) == 0;
+        }
+        allMatch = allMatch && match;
+
+        printf("%2u threads: %u nodes, %u batches, update %.3f ms, speedup %.2fx%s\n", numThreads, numNodes,
+            store.getNumBatches(), totalMs / numFrames, referenceMs / totalMs, match ? "" : ", MISMATCH");
+    }
+    return allMatch ? 0 : 1;
+}
\ No newline at end of file
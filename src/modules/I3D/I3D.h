@@ -1,9 +1,12 @@
 #pragma once
 #include <cassert>
+#include <cstdint>
+#include <cstring>
 #include <glm/glm.hpp>
 
 class I3D_frame;
 class I3D_sector;
+class I3D_scene;
 class I3D_driver;
 
 enum I3D_FRAME_TYPE {
@@ -23,6 +26,55 @@ enum I3D_FRAME_TYPE {
     FRAME_LAST,
 };
 
+enum I3D_RESULT {
+    I3D_OK,
+    I3DERR_FILENOTFOUND,
+    I3DERR_BADFORMAT,       // corrupted or truncated data
+    I3DERR_UNSUPPORTED,     // valid data using a feature or version we can't handle
+    I3DERR_OUTOFDATE,       // cached data made from a different source
+};
+
+//----------------------------
+// Case insensitive FNV-1a hash of a name. Asset and frame names come from DOS-era data,
+// where "Car01" and "CAR01" refer to the same thing.
+inline uint32_t I3D_HashName(const char* name, uint32_t length) {
+    uint32_t hash = 2166136261u;
+    for(uint32_t i = 0; i < length; ++i) {
+        char c = name[i];
+        if(c >= 'A' && c <= 'Z') c += 'a' - 'A';
+        hash = (hash ^ uint8_t(c)) * 16777619u;
+    }
+    return hash;
+}
+
+inline uint32_t I3D_HashName(const char* name) {
+    return I3D_HashName(name, uint32_t(strlen(name)));
+}
+
+//----------------------------
+// 64-bit FNV-1a of a block of data, taken a word at a time in 4 interleaved lanes so the
+// multiplies don't wait on each other - meant to detect changed files quickly, not as a
+// general purpose hash.
+inline uint64_t I3D_HashData(const void* data, size_t size) {
+    constexpr uint64_t prime = 1099511628211ull;
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    uint64_t lanes[4] = { 14695981039346656037ull, 14695981039346656037ull ^ 1, 14695981039346656037ull ^ 2, 14695981039346656037ull ^ 3 };
+
+    for(; size >= sizeof(lanes); size -= sizeof(lanes), bytes += sizeof(lanes)) {
+        uint64_t words[4];
+        memcpy(words, bytes, sizeof(words));
+        for(int i = 0; i < 4; ++i)
+            lanes[i] = (lanes[i] ^ words[i]) * prime;
+    }
+
+    uint64_t hash = lanes[0];
+    for(int i = 1; i < 4; ++i)
+        hash = (hash ^ lanes[i]) * prime;
+    for(; size > 0; --size, ++bytes)
+        hash = (hash ^ *bytes) * prime;
+    return hash;
+}
+
 //----------------------------
 // bounding box defined by 2 boundary points
 struct I3D_bbox {
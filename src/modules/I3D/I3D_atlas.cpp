@@ -0,0 +1,77 @@
+#include "I3D_atlas.h"
+
+#include <EASTL/algorithm.h>
+
+I3D_atlas::I3D_atlas(uint32_t width, uint32_t height) :
+    _width(width),
+    _height(height) {
+    _skyline.push_back({ 0, 0, width });
+}
+
+// top of a rectangle standing on the skyline from segment 'index' on
+bool I3D_atlas::fit(size_t index, uint32_t width, uint32_t height, uint32_t& y) const {
+    if(_skyline[index].x + uint64_t(width) > _width) return false;
+
+    y = 0;
+    uint32_t remaining = width;
+    for(size_t i = index; remaining > 0; ++i) {
+        y = ea::max(y, _skyline[i].y);
+        if(y + uint64_t(height) > _height) return false;
+        remaining -= ea::min(remaining, _skyline[i].width);
+    }
+    return true;
+}
+
+bool I3D_atlas::insert(uint32_t width, uint32_t height, uint32_t& x, uint32_t& y) {
+    if(!width || !height) return false;
+
+    size_t best = _skyline.size();
+    uint32_t bestY = 0;
+    for(size_t i = 0; i < _skyline.size(); ++i) {
+        uint32_t top;
+        if(!fit(i, width, height, top)) continue;
+
+        if(best == _skyline.size() || top < bestY || (top == bestY && _skyline[i].width < _skyline[best].width)) {
+            best = i;
+            bestY = top;
+        }
+    }
+    if(best == _skyline.size()) return false;
+
+    const Segment segment{ _skyline[best].x, bestY + height, width };
+    _skyline.insert(_skyline.begin() + best, segment);
+
+    // cut the segments now under the rectangle
+    const uint32_t end = segment.x + segment.width;
+    for(size_t i = best + 1; i < _skyline.size() && _skyline[i].x < end;) {
+        Segment& next = _skyline[i];
+        const uint32_t covered = end - next.x;
+        if(next.width > covered) {
+            next.x += covered;
+            next.width -= covered;
+            break;
+        }
+        _skyline.erase(_skyline.begin() + i);
+    }
+
+    // neighbours at the same height are one segment
+    for(size_t i = 0; i + 1 < _skyline.size();) {
+        if(_skyline[i].y == _skyline[i + 1].y) {
+            _skyline[i].width += _skyline[i + 1].width;
+            _skyline.erase(_skyline.begin() + i + 1);
+        } else {
+            ++i;
+        }
+    }
+
+    x = segment.x;
+    y = bestY;
+    _usedHeight = ea::max(_usedHeight, bestY + height);
+    _usedArea += uint64_t(width) * height;
+    ++_numRects;
+    return true;
+}
+
+float I3D_atlas::getOccupancy() const {
+    return _usedHeight ? float(double(_usedArea) / (double(_width) * _usedHeight)) : 0.0f;
+}
\ No newline at end of file
@@ -7,6 +7,7 @@ I3D_camera::I3D_camera(I3D_driver* driver) :
     _camFlags(CAMFLAGS_PROJ_DIRTY) 
 {
     _type = FRAME_CAMERA;
+    _flags |= FRMFLAGS_TRACK_SECTOR;
 }
 
 void I3D_camera::duplicate(I3D_frame* src) {
@@ -30,6 +31,15 @@ void I3D_camera::setRange(const glm::vec2& range) {
     _camFlags |= CAMFLAGS_PROJ_DIRTY;
 }
 
+const glm::mat4& I3D_camera::getViewMatrix() {
+    _view = glm::affineInverse(getMatrix());
+    return _view;
+}
+
+I3D_frustum I3D_camera::getFrustum() {
+    return I3D_frustum(getProjMatrix() * getViewMatrix());
+}
+
 void I3D_camera::updateCameraMatrices(float aspectRatio) {
     if(!(_camFlags & CAMFLAGS_PROJ_DIRTY)) return;
     _proj = glm::perspectiveLH(_fov, aspectRatio, _range.x, _range.y);
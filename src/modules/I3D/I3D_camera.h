@@ -1,5 +1,6 @@
 #pragma once
 #include "I3D_frame.h"
+#include "I3D_cull.h"
 
 enum I3D_CAM_FLAGS : uint32_t {
     CAMFLAGS_PROJ_DIRTY = (1 << 1)
@@ -10,15 +11,20 @@ public:
     I3D_camera(I3D_driver* driver);
     void duplicate(I3D_frame* src);
     
-    const glm::mat4& getViewMatrix() { assert(!(_flags&FRMFLAGS_MAT_DIRTY)); return _matrix; }
+    // inverse of the camera's world matrix
+    const glm::mat4& getViewMatrix();
     const glm::mat4& getProjMatrix() { assert(!(_camFlags&CAMFLAGS_PROJ_DIRTY)); return _proj; }
 
+    // world space view frustum, valid after updateCameraMatrices()
+    I3D_frustum getFrustum();
+
     void setFOV(float fov);
     float getFOV() const { return _fov; }
 
     void setRange(const glm::vec2& range);
     const glm::vec2& getRange() const { return _range; }
 
+    // kept up to date by the scene every tick unless setTrackSector(false)
     void setCurrSector(I3D_sector* sect) { _sector = sect; }
     I3D_sector* getCurrSector() { return _sector; }
 
@@ -29,6 +35,7 @@ private:
     float _fov{};
     glm::vec2 _range{};
     glm::mat4 _proj{};
+    glm::mat4 _view{};
 };
 
 //----------------------------
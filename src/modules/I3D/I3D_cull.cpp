@@ -0,0 +1,346 @@
+#include "I3D_cull.h"
+#include "I3D_simd.h"
+
+#include <EASTL/algorithm.h>
+namespace ea = eastl;
+
+// volumes are loaded straight from the arrays, 4 floats per sphere and 6 per box
+static_assert(sizeof(I3D_bsphere) == 4 * sizeof(float), "unexpected I3D_bsphere layout");
+static_assert(sizeof(I3D_bbox) == 6 * sizeof(float), "unexpected I3D_bbox layout");
+
+I3D_frustum::I3D_frustum(const glm::mat4& viewProj) :
+    I3D_frustum(viewProj, glm::vec4(-1.0f, -1.0f, 1.0f, 1.0f)) {
+}
+
+I3D_frustum::I3D_frustum(const glm::mat4& viewProj, const glm::vec4& rect) {
+    // Gribb / Hartmann: planes are sums and differences of the matrix rows,
+    // x / w >= min is x - min * w >= 0
+    const glm::mat4 m = glm::transpose(viewProj);
+    planes[LEFT] = m[0] - rect.x * m[3];
+    planes[RIGHT] = rect.z * m[3] - m[0];
+    planes[BOTTOM] = m[1] - rect.y * m[3];
+    planes[TOP] = rect.w * m[3] - m[1];
+#if GLM_CONFIG_CLIP_CONTROL & GLM_CLIP_CONTROL_ZO_BIT
+    planes[NEAR] = m[2];
+#else
+    planes[NEAR] = m[3] + m[2];
+#endif
+    planes[FAR] = m[3] - m[2];
+
+    for(glm::vec4& plane : planes)
+        plane /= glm::length(glm::vec3(plane));
+}
+
+bool I3D_frustum::testSphere(const I3D_bsphere& sphere) const {
+    if(sphere.radius < 0.0f) return false;
+
+    for(const glm::vec4& plane : planes) {
+        if(glm::dot(glm::vec3(plane), sphere.pos) + plane.w < -sphere.radius)
+            return false;
+    }
+    return true;
+}
+
+bool I3D_frustum::testBox(const I3D_bbox& box) const {
+    if(!box.IsValid()) return false;
+
+    // distance of the corner furthest along the plane normal
+    const glm::vec3 center = (box.min + box.max) * 0.5f;
+    const glm::vec3 extent = (box.max - box.min) * 0.5f;
+    for(const glm::vec4& plane : planes) {
+        if(glm::dot(glm::vec3(plane), center) + glm::dot(glm::abs(glm::vec3(plane)), extent) + plane.w < 0.0f)
+            return false;
+    }
+    return true;
+}
+
+//----------------------------
+// scalar
+
+static uint32_t cullSpheres_scalar(const I3D_frustum& frustum, const I3D_bsphere* spheres, uint32_t count, uint32_t* visible) {
+    uint32_t numVisible = 0;
+    for(uint32_t i = 0; i < count; ++i) {
+        visible[numVisible] = i;
+        numVisible += frustum.testSphere(spheres[i]);
+    }
+    return numVisible;
+}
+
+static uint32_t cullBoxes_scalar(const I3D_frustum& frustum, const I3D_bbox* boxes, uint32_t count, uint32_t* visible) {
+    uint32_t numVisible = 0;
+    for(uint32_t i = 0; i < count; ++i) {
+        visible[numVisible] = i;
+        numVisible += frustum.testBox(boxes[i]);
+    }
+    return numVisible;
+}
+
+#if I3D_SIMD_X86
+
+// indices of set bits of a lane mask, written without branches
+static inline uint32_t compactLanes(uint32_t mask, uint32_t numLanes, uint32_t base, uint32_t* visible) {
+    uint32_t numVisible = 0;
+    for(uint32_t k = 0; k < numLanes; ++k) {
+        visible[numVisible] = base + k;
+        numVisible += (mask >> k) & 1;
+    }
+    return numVisible;
+}
+
+//----------------------------
+// SSE2 - 4 volumes per step, lane = volume
+
+struct I3D_planes_sse2 {
+    __m128 nx[I3D_frustum::NUM_PLANES], ny[I3D_frustum::NUM_PLANES], nz[I3D_frustum::NUM_PLANES], w[I3D_frustum::NUM_PLANES];
+    __m128 ax[I3D_frustum::NUM_PLANES], ay[I3D_frustum::NUM_PLANES], az[I3D_frustum::NUM_PLANES];
+};
+
+I3D_TARGET_SSE2
+static inline void splatPlanes_sse2(I3D_planes_sse2& p, const I3D_frustum& frustum) {
+    for(int i = 0; i < I3D_frustum::NUM_PLANES; ++i) {
+        const glm::vec4& plane = frustum.planes[i];
+        p.nx[i] = _mm_set1_ps(plane.x);
+        p.ny[i] = _mm_set1_ps(plane.y);
+        p.nz[i] = _mm_set1_ps(plane.z);
+        p.w[i] = _mm_set1_ps(plane.w);
+        p.ax[i] = _mm_set1_ps(glm::abs(plane.x));
+        p.ay[i] = _mm_set1_ps(glm::abs(plane.y));
+        p.az[i] = _mm_set1_ps(glm::abs(plane.z));
+    }
+}
+
+I3D_TARGET_SSE2
+static inline uint32_t testSpheres4_sse2(const I3D_planes_sse2& p, const I3D_bsphere* spheres) {
+    __m128 x = _mm_loadu_ps(&spheres[0].pos.x);
+    __m128 y = _mm_loadu_ps(&spheres[1].pos.x);
+    __m128 z = _mm_loadu_ps(&spheres[2].pos.x);
+    __m128 r = _mm_loadu_ps(&spheres[3].pos.x);
+    _MM_TRANSPOSE4_PS(x, y, z, r);
+
+    const __m128 negR = _mm_sub_ps(_mm_setzero_ps(), r);
+    __m128 inside = _mm_cmpge_ps(r, _mm_setzero_ps());
+    for(int i = 0; i < I3D_frustum::NUM_PLANES; ++i) {
+        __m128 d = _mm_add_ps(_mm_mul_ps(x, p.nx[i]), p.w[i]);
+        d = _mm_add_ps(d, _mm_mul_ps(y, p.ny[i]));
+        d = _mm_add_ps(d, _mm_mul_ps(z, p.nz[i]));
+        inside = _mm_and_ps(inside, _mm_cmpge_ps(d, negR));
+    }
+    return uint32_t(_mm_movemask_ps(inside));
+}
+
+// min.xyz, max.x and min.z, max.xyz of 4 boxes, transposed to lanes
+I3D_TARGET_SSE2
+static inline void loadBoxes4_sse2(const I3D_bbox* boxes, __m128& minX, __m128& minY, __m128& minZ, __m128& maxX, __m128& maxY, __m128& maxZ) {
+    minX = _mm_loadu_ps(&boxes[0].min.x);
+    minY = _mm_loadu_ps(&boxes[1].min.x);
+    minZ = _mm_loadu_ps(&boxes[2].min.x);
+    maxX = _mm_loadu_ps(&boxes[3].min.x);
+    _MM_TRANSPOSE4_PS(minX, minY, minZ, maxX);
+
+    __m128 t0 = _mm_loadu_ps(&boxes[0].min.z);
+    __m128 t1 = _mm_loadu_ps(&boxes[1].min.z);
+    maxY = _mm_loadu_ps(&boxes[2].min.z);
+    maxZ = _mm_loadu_ps(&boxes[3].min.z);
+    _MM_TRANSPOSE4_PS(t0, t1, maxY, maxZ);
+}
+
+I3D_TARGET_SSE2
+static inline uint32_t testBoxes4_sse2(const I3D_planes_sse2& p, const I3D_bbox* boxes) {
+    __m128 minX, minY, minZ, maxX, maxY, maxZ;
+    loadBoxes4_sse2(boxes, minX, minY, minZ, maxX, maxY, maxZ);
+
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 cx = _mm_mul_ps(_mm_add_ps(minX, maxX), half);
+    const __m128 cy = _mm_mul_ps(_mm_add_ps(minY, maxY), half);
+    const __m128 cz = _mm_mul_ps(_mm_add_ps(minZ, maxZ), half);
+    const __m128 ex = _mm_mul_ps(_mm_sub_ps(maxX, minX), half);
+    const __m128 ey = _mm_mul_ps(_mm_sub_ps(maxY, minY), half);
+    const __m128 ez = _mm_mul_ps(_mm_sub_ps(maxZ, minZ), half);
+
+    __m128 inside = _mm_cmple_ps(minX, maxX);
+    for(int i = 0; i < I3D_frustum::NUM_PLANES; ++i) {
+        __m128 d = _mm_add_ps(_mm_mul_ps(cx, p.nx[i]), p.w[i]);
+        d = _mm_add_ps(d, _mm_mul_ps(cy, p.ny[i]));
+        d = _mm_add_ps(d, _mm_mul_ps(cz, p.nz[i]));
+        d = _mm_add_ps(d, _mm_mul_ps(ex, p.ax[i]));
+        d = _mm_add_ps(d, _mm_mul_ps(ey, p.ay[i]));
+        d = _mm_add_ps(d, _mm_mul_ps(ez, p.az[i]));
+        inside = _mm_and_ps(inside, _mm_cmpge_ps(d, _mm_setzero_ps()));
+    }
+    return uint32_t(_mm_movemask_ps(inside));
+}
+
+I3D_TARGET_SSE2
+static uint32_t cullSpheres_sse2(const I3D_frustum& frustum, const I3D_bsphere* spheres, uint32_t count, uint32_t* visible) {
+    I3D_planes_sse2 planes;
+    splatPlanes_sse2(planes, frustum);
+
+    uint32_t numVisible = 0;
+    uint32_t i = 0;
+    for(; i + 4 <= count; i += 4)
+        numVisible += compactLanes(testSpheres4_sse2(planes, spheres + i), 4, i, visible + numVisible);
+
+    // tail is padded with the last volume, so it gets the same test as the rest
+    if(i < count) {
+        I3D_bsphere tail[4];
+        for(uint32_t k = 0; k < 4; ++k) tail[k] = spheres[ea::min(i + k, count - 1)];
+        numVisible += compactLanes(testSpheres4_sse2(planes, tail), count - i, i, visible + numVisible);
+    }
+    return numVisible;
+}
+
+I3D_TARGET_SSE2
+static uint32_t cullBoxes_sse2(const I3D_frustum& frustum, const I3D_bbox* boxes, uint32_t count, uint32_t* visible) {
+    I3D_planes_sse2 planes;
+    splatPlanes_sse2(planes, frustum);
+
+    uint32_t numVisible = 0;
+    uint32_t i = 0;
+    for(; i + 4 <= count; i += 4)
+        numVisible += compactLanes(testBoxes4_sse2(planes, boxes + i), 4, i, visible + numVisible);
+
+    if(i < count) {
+        I3D_bbox tail[4];
+        for(uint32_t k = 0; k < 4; ++k) tail[k] = boxes[ea::min(i + k, count - 1)];
+        numVisible += compactLanes(testBoxes4_sse2(planes, tail), count - i, i, visible + numVisible);
+    }
+    return numVisible;
+}
+
+//----------------------------
+// AVX2 - 8 volumes per step, loaded as two transposed halves of 4
+
+struct I3D_planes_avx2 {
+    __m256 nx[I3D_frustum::NUM_PLANES], ny[I3D_frustum::NUM_PLANES], nz[I3D_frustum::NUM_PLANES], w[I3D_frustum::NUM_PLANES];
+    __m256 ax[I3D_frustum::NUM_PLANES], ay[I3D_frustum::NUM_PLANES], az[I3D_frustum::NUM_PLANES];
+};
+
+I3D_TARGET_AVX2
+static inline void splatPlanes_avx2(I3D_planes_avx2& p, const I3D_frustum& frustum) {
+    for(int i = 0; i < I3D_frustum::NUM_PLANES; ++i) {
+        const glm::vec4& plane = frustum.planes[i];
+        p.nx[i] = _mm256_set1_ps(plane.x);
+        p.ny[i] = _mm256_set1_ps(plane.y);
+        p.nz[i] = _mm256_set1_ps(plane.z);
+        p.w[i] = _mm256_set1_ps(plane.w);
+        p.ax[i] = _mm256_set1_ps(glm::abs(plane.x));
+        p.ay[i] = _mm256_set1_ps(glm::abs(plane.y));
+        p.az[i] = _mm256_set1_ps(glm::abs(plane.z));
+    }
+}
+
+I3D_TARGET_AVX2
+static inline __m256 combine_avx2(__m128 lo, __m128 hi) {
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1);
+}
+
+I3D_TARGET_AVX2
+static inline uint32_t testSpheres8_avx2(const I3D_planes_avx2& p, const I3D_bsphere* spheres) {
+    __m128 x0 = _mm_loadu_ps(&spheres[0].pos.x), y0 = _mm_loadu_ps(&spheres[1].pos.x);
+    __m128 z0 = _mm_loadu_ps(&spheres[2].pos.x), r0 = _mm_loadu_ps(&spheres[3].pos.x);
+    __m128 x1 = _mm_loadu_ps(&spheres[4].pos.x), y1 = _mm_loadu_ps(&spheres[5].pos.x);
+    __m128 z1 = _mm_loadu_ps(&spheres[6].pos.x), r1 = _mm_loadu_ps(&spheres[7].pos.x);
+    _MM_TRANSPOSE4_PS(x0, y0, z0, r0);
+    _MM_TRANSPOSE4_PS(x1, y1, z1, r1);
+
+    const __m256 x = combine_avx2(x0, x1), y = combine_avx2(y0, y1), z = combine_avx2(z0, z1), r = combine_avx2(r0, r1);
+    const __m256 negR = _mm256_sub_ps(_mm256_setzero_ps(), r);
+    __m256 inside = _mm256_cmp_ps(r, _mm256_setzero_ps(), _CMP_GE_OQ);
+    for(int i = 0; i < I3D_frustum::NUM_PLANES; ++i) {
+        __m256 d = _mm256_fmadd_ps(x, p.nx[i], p.w[i]);
+        d = _mm256_fmadd_ps(y, p.ny[i], d);
+        d = _mm256_fmadd_ps(z, p.nz[i], d);
+        inside = _mm256_and_ps(inside, _mm256_cmp_ps(d, negR, _CMP_GE_OQ));
+    }
+    return uint32_t(_mm256_movemask_ps(inside));
+}
+
+I3D_TARGET_AVX2
+static inline uint32_t testBoxes8_avx2(const I3D_planes_avx2& p, const I3D_bbox* boxes) {
+    __m128 minX0, minY0, minZ0, maxX0, maxY0, maxZ0;
+    __m128 minX1, minY1, minZ1, maxX1, maxY1, maxZ1;
+    loadBoxes4_sse2(boxes, minX0, minY0, minZ0, maxX0, maxY0, maxZ0);
+    loadBoxes4_sse2(boxes + 4, minX1, minY1, minZ1, maxX1, maxY1, maxZ1);
+
+    const __m256 minX = combine_avx2(minX0, minX1), minY = combine_avx2(minY0, minY1), minZ = combine_avx2(minZ0, minZ1);
+    const __m256 maxX = combine_avx2(maxX0, maxX1), maxY = combine_avx2(maxY0, maxY1), maxZ = combine_avx2(maxZ0, maxZ1);
+
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 cx = _mm256_mul_ps(_mm256_add_ps(minX, maxX), half);
+    const __m256 cy = _mm256_mul_ps(_mm256_add_ps(minY, maxY), half);
+    const __m256 cz = _mm256_mul_ps(_mm256_add_ps(minZ, maxZ), half);
+    const __m256 ex = _mm256_mul_ps(_mm256_sub_ps(maxX, minX), half);
+    const __m256 ey = _mm256_mul_ps(_mm256_sub_ps(maxY, minY), half);
+    const __m256 ez = _mm256_mul_ps(_mm256_sub_ps(maxZ, minZ), half);
+
+    __m256 inside = _mm256_cmp_ps(minX, maxX, _CMP_LE_OQ);
+    for(int i = 0; i < I3D_frustum::NUM_PLANES; ++i) {
+        __m256 d = _mm256_fmadd_ps(cx, p.nx[i], p.w[i]);
+        d = _mm256_fmadd_ps(cy, p.ny[i], d);
+        d = _mm256_fmadd_ps(cz, p.nz[i], d);
+        d = _mm256_fmadd_ps(ex, p.ax[i], d);
+        d = _mm256_fmadd_ps(ey, p.ay[i], d);
+        d = _mm256_fmadd_ps(ez, p.az[i], d);
+        inside = _mm256_and_ps(inside, _mm256_cmp_ps(d, _mm256_setzero_ps(), _CMP_GE_OQ));
+    }
+    return uint32_t(_mm256_movemask_ps(inside));
+}
+
+I3D_TARGET_AVX2
+static uint32_t cullSpheres_avx2(const I3D_frustum& frustum, const I3D_bsphere* spheres, uint32_t count, uint32_t* visible) {
+    I3D_planes_avx2 planes;
+    splatPlanes_avx2(planes, frustum);
+
+    uint32_t numVisible = 0;
+    uint32_t i = 0;
+    for(; i + 8 <= count; i += 8)
+        numVisible += compactLanes(testSpheres8_avx2(planes, spheres + i), 8, i, visible + numVisible);
+
+    if(i < count) {
+        I3D_bsphere tail[8];
+        for(uint32_t k = 0; k < 8; ++k) tail[k] = spheres[ea::min(i + k, count - 1)];
+        numVisible += compactLanes(testSpheres8_avx2(planes, tail), count - i, i, visible + numVisible);
+    }
+    return numVisible;
+}
+
+I3D_TARGET_AVX2
+static uint32_t cullBoxes_avx2(const I3D_frustum& frustum, const I3D_bbox* boxes, uint32_t count, uint32_t* visible) {
+    I3D_planes_avx2 planes;
+    splatPlanes_avx2(planes, frustum);
+
+    uint32_t numVisible = 0;
+    uint32_t i = 0;
+    for(; i + 8 <= count; i += 8)
+        numVisible += compactLanes(testBoxes8_avx2(planes, boxes + i), 8, i, visible + numVisible);
+
+    if(i < count) {
+        I3D_bbox tail[8];
+        for(uint32_t k = 0; k < 8; ++k) tail[k] = boxes[ea::min(i + k, count - 1)];
+        numVisible += compactLanes(testBoxes8_avx2(planes, tail), count - i, i, visible + numVisible);
+    }
+    return numVisible;
+}
+
+#endif
+
+//----------------------------
+
+static const I3D_cull_kernels kernelsScalar = { "scalar", cullSpheres_scalar, cullBoxes_scalar };
+#if I3D_SIMD_X86
+static const I3D_cull_kernels kernelsSSE2 = { "sse2", cullSpheres_sse2, cullBoxes_sse2 };
+static const I3D_cull_kernels kernelsAVX2 = { "avx2", cullSpheres_avx2, cullBoxes_avx2 };
+#endif
+
+const I3D_cull_kernels& I3D_GetCullKernels(uint32_t features) {
+#if I3D_SIMD_X86
+    if(features & CPUF_AVX2) return kernelsAVX2;
+    if(features & CPUF_SSE2) return kernelsSSE2;
+#endif
+    return kernelsScalar;
+}
+
+const I3D_cull_kernels& I3D_GetCullKernels() {
+    static const I3D_cull_kernels& kernels = I3D_GetCullKernels(I3D_GetCPUFeatures());
+    return kernels;
+}
\ No newline at end of file
@@ -0,0 +1,41 @@
+#pragma once
+#include "I3D.h"
+
+#include <cstdint>
+#include <glm/glm.hpp>
+
+//----------------------------
+// View frustum as 6 normalized planes (xyz = normal pointing inside, w = distance),
+// a point p is inside a plane when dot(normal, p) + w >= 0.
+struct I3D_frustum {
+    enum { LEFT, RIGHT, BOTTOM, TOP, NEAR, FAR, NUM_PLANES };
+
+    I3D_frustum() {}
+    explicit I3D_frustum(const glm::mat4& viewProj);
+
+    // the part of the view through a rectangle (min x, min y, max x, max y) in normalized
+    // device coordinates, (-1, -1, 1, 1) is the whole view
+    I3D_frustum(const glm::mat4& viewProj, const glm::vec4& rect);
+
+    bool testSphere(const I3D_bsphere& sphere) const;
+    bool testBox(const I3D_bbox& box) const;
+
+    glm::vec4 planes[NUM_PLANES];
+};
+
+//----------------------------
+// Batch culling kernels. Every volume in [0, count) is tested against all planes and indices of
+// the ones at least partially inside are written to 'visible' in order (room for 'count' is needed).
+// Spheres with negative radius and invalid boxes are never visible. Returns number of visible.
+struct I3D_cull_kernels {
+    const char* name;
+
+    uint32_t (*cullSpheres)(const I3D_frustum& frustum, const I3D_bsphere* spheres, uint32_t count, uint32_t* visible);
+    uint32_t (*cullBoxes)(const I3D_frustum& frustum, const I3D_bbox* boxes, uint32_t count, uint32_t* visible);
+};
+
+// kernels for the best instruction set of this CPU
+const I3D_cull_kernels& I3D_GetCullKernels();
+
+// kernels for a given feature mask (CPUF_*), e.g. to compare implementations
+const I3D_cull_kernels& I3D_GetCullKernels(uint32_t features);
\ No newline at end of file
@@ -1,24 +1,76 @@
 #include "I3D_driver.h"
-#include "I3D_frame.h"
-#include "I3D_dummy.h"
-#include "I3D_camera.h"
-#include "I3D_sector.h"
+#include "I3D_scene.h"
+
+I3D_driver::I3D_driver() {
+    _jobs.init();
+
+    registerFrameType<I3D_frame>(FRAME_NULL);
+    registerFrameType<I3D_visual>(FRAME_VISUAL);
+    registerFrameType<I3D_dummy>(FRAME_DUMMY);
+    registerFrameType<I3D_camera>(FRAME_CAMERA);
+    registerFrameType<I3D_sector>(FRAME_SECTOR);
+    registerFrameType<I3D_occluder>(FRAME_OCCLUDER);
+    registerFrameType<I3D_model>(FRAME_MODEL);
+}
+
+I3D_driver::~I3D_driver() {
+    // workers may still decode for the texture loader
+    _jobs.shutdown();
+    _textureCache.clear();
+    _textureLoader.shutdown();
+}
+
+void I3D_driver::init(IDevice* device) {
+    _device = device;
+    if(_device) _textureLoader.init(_device);
+}
 
 I3D_frame* I3D_driver::createFrame(I3D_FRAME_TYPE type) {
-    switch (type) {
-        case FRAME_NULL:
-            return new I3D_frame(this);
-        case FRAME_DUMMY: 
-            return new I3D_dummy(this);
-        case FRAME_CAMERA:
-            return new I3D_camera(this);
-        case FRAME_SECTOR: 
-            return new I3D_sector(this);
-        default:
-            return nullptr;
+    if(!_framePools[type]) return nullptr;
+    return _framePools[type]->alloc(this);
+}
+
+uint32_t I3D_driver::createFrames(I3D_FRAME_TYPE type, uint32_t count, I3D_frame** frames) {
+    if(!_framePools[type]) return 0;
+
+    _framePools[type]->reserve(count);
+    _transforms.reserve(count);
+    for(uint32_t i = 0; i < count; ++i)
+        frames[i] = _framePools[type]->alloc(this);
+
+    return count;
+}
+
+void I3D_driver::destroyFrame(I3D_frame* frame) {
+    assert(_framePools[frame->getFrameType()]);
+    _framePools[frame->getFrameType()]->free(frame);
+}
+
+bool I3D_driver::getPoolStats(I3D_FRAME_TYPE type, I3D_POOL_STATS& stats) const {
+    if(!_framePools[type]) return false;
+
+    stats = _framePools[type]->getStats();
+    return true;
+}
+
+void I3D_driver::trimPools() {
+    for(auto& pool : _framePools) {
+        if(pool) pool->trim();
     }
 }
 
-uint32_t I3D_driver::getRenderTime() {
-    return 0;
+void I3D_driver::tick() {
+    // measured from the start, so rounding to ms doesn't add up over ticks
+    const auto now = std::chrono::steady_clock::now() - _startTime;
+    const uint32_t renderTime = uint32_t(std::chrono::duration_cast<std::chrono::milliseconds>(now).count());
+    const uint32_t elapsed = renderTime - _renderTime;
+    _renderTime = renderTime;
+
+    ++_tickCount;
+    _transforms.update(&_jobs);
+    for(I3D_scene* scene : _scenes)
+        scene->updateSectors();
+    _textureLoader.tick();
+    _textureCache.tick();
+    _textureAnimator.tick(elapsed);
 }
\ No newline at end of file
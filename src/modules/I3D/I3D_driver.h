@@ -1,8 +1,113 @@
 #pragma once
 #include "I3D.h"
+#include "I3D_transform.h"
+#include "I3D_jobs.h"
+#include "I3D_pool.h"
+#include "I3D_frame.h"
+#include "I3D_dummy.h"
+#include "I3D_camera.h"
+#include "I3D_sector.h"
+#include "I3D_occluder.h"
+#include "I3D_visual.h"
+#include "I3D_model.h"
+#include "I3D_texture_loader.h"
+#include "I3D_texture_cache.h"
+#include "I3D_texture_animator.h"
+
+#include <EASTL/unique_ptr.h>
+#include <EASTL/algorithm.h>
+#include <chrono>
+
+class IDevice;
+
+//----------------------------
+// Type-erased pool of one frame class, so the driver can keep a pool per I3D_FRAME_TYPE.
+class I3D_frame_pool_base {
+public:
+    virtual ~I3D_frame_pool_base() {}
+    virtual I3D_frame* alloc(I3D_driver* driver) = 0;
+    virtual void free(I3D_frame* frame) = 0;
+    virtual void reserve(uint32_t count) = 0;
+    virtual void trim() = 0;
+    virtual I3D_POOL_STATS getStats() const = 0;
+};
+
+template<typename T>
+class I3D_frame_pool : public I3D_frame_pool_base {
+public:
+    I3D_frame* alloc(I3D_driver* driver) override { return _pool.alloc(driver); }
+    void free(I3D_frame* frame) override { _pool.free(static_cast<T*>(frame)); }
+    void reserve(uint32_t count) override { _pool.reserve(count); }
+    void trim() override { _pool.trim(); }
+    I3D_POOL_STATS getStats() const override { return _pool.getStats(); }
+private:
+    I3D_pool<T> _pool{};
+};
+
+//----------------------------
 
 class I3D_driver {
 public:
+    I3D_driver();
+    ~I3D_driver();
+
+    // device used for GPU resources; without one, resources keep only their CPU side
+    void init(IDevice* device);
+    IDevice* getDevice() { return _device; }
+
     I3D_frame* createFrame(I3D_FRAME_TYPE type);
-    uint32_t getRenderTime();
+
+    //----------------------------
+    // Create 'count' frames of one type at once, stores them to 'frames' and returns how many
+    // were created (0 for types without a frame class). Frames of a batch come from the pool's slabs
+    // in order, so they're contiguous in memory within each slab.
+    uint32_t createFrames(I3D_FRAME_TYPE type, uint32_t count, I3D_frame** frames);
+
+    // called by I3D_frame::release() when the last reference is gone, memory is recycled by the type's pool
+    void destroyFrame(I3D_frame* frame);
+
+    //----------------------------
+    // Frame classes are allocated from a pool per type; new frame types register their class here.
+    template<typename T>
+    void registerFrameType(I3D_FRAME_TYPE type) { _framePools[type] = ea::make_unique<I3D_frame_pool<T>>(); }
+
+    bool getPoolStats(I3D_FRAME_TYPE type, I3D_POOL_STATS& stats) const;
+
+    // return memory of completely unused slabs
+    void trimPools();
+
+    // milliseconds since the driver was created, as of the last tick
+    uint32_t getRenderTime() const { return _renderTime; }
+
+    //----------------------------
+    // Per-frame update - resolves world matrices of all frames in one pass and the sectors of
+    // tracked frames, uploads textures finished by the texture loader, keeps cached textures in
+    // budget and advances animated textures by the time since the last tick. Called on the
+    // render thread.
+    void tick();
+
+    // number of ticks so far
+    uint32_t getTickCount() const { return _tickCount; }
+
+    I3D_transform_store& getTransforms() { return _transforms; }
+    I3D_jobs& getJobs() { return _jobs; }
+    I3D_texture_loader& getTextureLoader() { return _textureLoader; }
+    I3D_texture_cache& getTextureCache() { return _textureCache; }
+    I3D_texture_animator& getTextureAnimator() { return _textureAnimator; }
+
+    //NOTE: used internally by I3D_scene, scenes update their tracked frames' sectors on tick
+    void addScene(I3D_scene* scene) { _scenes.push_back(scene); }
+    void removeScene(I3D_scene* scene) { _scenes.erase(ea::remove(_scenes.begin(), _scenes.end(), scene), _scenes.end()); }
+private:
+    IDevice* _device{ nullptr };
+    I3D_jobs _jobs{};
+    I3D_transform_store _transforms{};
+    I3D_texture_loader _textureLoader{ this };
+    I3D_texture_cache _textureCache{ this };
+    I3D_texture_animator _textureAnimator{};
+    ea::vector<I3D_scene*> _scenes{};
+    std::chrono::steady_clock::time_point _startTime{ std::chrono::steady_clock::now() };
+    uint32_t _renderTime{};
+    uint32_t _tickCount{};
+    ea::unique_ptr<I3D_frame_pool_base> _framePools[FRAME_LAST]{};
 };
\ No newline at end of file
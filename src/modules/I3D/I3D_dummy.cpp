@@ -4,22 +4,22 @@ I3D_dummy::I3D_dummy(I3D_driver* driver) :
     I3D_frame(driver)
 {
     _type = FRAME_DUMMY;
-    _bbox.Invalidate();
 }
 
 void I3D_dummy::duplicate(I3D_frame* src) {
     if(src->getFrameType() == FRAME_DUMMY) {
         I3D_dummy* dummy = I3DCAST_DUMMY(src);
-        _bbox = dummy->_bbox;
+        setBBox(dummy->getBBox());
     }
 
     return I3D_frame::duplicate(src);   
 }
 
+// local bbox lives in the transform store, which keeps world bounds of the hierarchy
 void I3D_dummy::setBBox(const I3D_bbox& bbox) {
-    _bbox = bbox;
+    getTransforms().setLocalBBox(_xform, bbox);
 }
 
 const I3D_bbox& I3D_dummy::getBBox() const {
-    return _bbox;
+    return getTransforms().getLocalBBox(_xform);
 }
\ No newline at end of file
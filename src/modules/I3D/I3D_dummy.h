@@ -9,8 +9,6 @@ public:
     
     void setBBox(const I3D_bbox& bbox);
     const I3D_bbox& getBBox() const;
-private:
-    I3D_bbox _bbox{};
 };
 
 //----------------------------
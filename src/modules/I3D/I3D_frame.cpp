@@ -1,104 +1,182 @@
 #include "I3D_frame.h"
-#include <glm/gtx/quaternion.hpp>
+#include "I3D_driver.h"
+#include "I3D_scene.h"
+
+I3D_frame::I3D_frame(I3D_driver* driver) :
+    _flags(FRMFLAGS_ON),
+    _driver(driver) {
+    _xform = getTransforms().create();
+}
+
+I3D_frame::~I3D_frame() {
+    assert(!_parent);
+    while(_firstChild)
+        removeChild(_firstChild);
+
+    getTransforms().release(_xform);
+}
+
+uint32_t I3D_frame::release() {
+    assert(_refs > 0);
+    if(--_refs) return _refs;
+
+    _driver->destroyFrame(this);
+    return 0;
+}
 
 void I3D_frame::duplicate(I3D_frame* src) {
-    _pos = src->_pos;
-    _rot = src->_rot;
-    _scale = src->_scale;
-    _name = src->_name;
-    _flags = src->_flags;
-    _matrix = src->_matrix;
-    _worldMatrix = src->_worldMatrix;
+    setName(src->_name);
+    setFrameFlags(src->_flags);
+    getTransforms().copy(_xform, src->_xform);
 }
 
-void I3D_frame::addChild(ea::shared_ptr<I3D_frame> child) {
+void I3D_frame::addChild(I3D_frame* child) {
+    assert(child && child != this);
+    child->addRef();
+    if(child->_parent)
+        child->_parent->removeChild(child);
+
     child->_parent = this;
-    child->_flags |= FRMFLAGS_MAT_DIRTY;
+    child->_prevSibling = _lastChild;
+    child->_nextSibling = nullptr;
+    if(_lastChild)
+        _lastChild->_nextSibling = child;
+    else
+        _firstChild = child;
+    _lastChild = child;
+
+    getTransforms().setParent(child->_xform, _xform);
+
+    if(_scene)
+        child->setScene(_scene);
+}
+
+void I3D_frame::removeChild(I3D_frame* child) {
+    if(!child || child->_parent != this) return;
+
+    if(child->_prevSibling)
+        child->_prevSibling->_nextSibling = child->_nextSibling;
+    else
+        _firstChild = child->_nextSibling;
+
+    if(child->_nextSibling)
+        child->_nextSibling->_prevSibling = child->_prevSibling;
+    else
+        _lastChild = child->_prevSibling;
+
+    child->_parent = nullptr;
+    child->_prevSibling = nullptr;
+    child->_nextSibling = nullptr;
+    getTransforms().setParent(child->_xform, I3D_XFORM_NONE);
+
+    if(child->_scene)
+        child->setScene(nullptr);
+
+    child->release();
+}
+
+void I3D_frame::setName(const I3D_name& name) {
+    if(_name == name) return;
+    if(_scene) _scene->removeFromIndex(this);
+
+    _name = name;
 
-    _children.push_back(ea::move(child));
+    if(_scene) _scene->addToIndex(this);
 }
 
-void I3D_frame::removeChild(ea::shared_ptr<I3D_frame> child) {
-    auto it = ea::find(_children.begin(), _children.end(), child);
-    if(it != _children.end()) {
-        _children.erase(ea::remove(_children.begin(), _children.end(), child), _children.end());
+void I3D_frame::setScene(I3D_scene* scene) {
+    if(_scene == scene) return;
+
+    if(_scene) {
+        _scene->removeFromIndex(this);
+        if(_type == FRAME_SECTOR) _scene->removeSector(I3DCAST_SECTOR(this));
+        if(_type == FRAME_OCCLUDER) _scene->removeOccluder(I3DCAST_OCCLUDER(this));
+        if(_flags & FRMFLAGS_TRACK_SECTOR) _scene->removeTracked(this);
+    }
+    _scene = scene;
+    if(_scene) {
+        _scene->addToIndex(this);
+        if(_type == FRAME_SECTOR) _scene->addSector(I3DCAST_SECTOR(this));
+        if(_type == FRAME_OCCLUDER) _scene->addOccluder(I3DCAST_OCCLUDER(this));
+        if(_flags & FRMFLAGS_TRACK_SECTOR) _scene->addTracked(this);
     }
+
+    for(I3D_frame* child = _firstChild; child; child = child->_nextSibling)
+        child->setScene(scene);
+}
+
+void I3D_frame::setTrackSector(bool track) {
+    if(track == bool(_flags & FRMFLAGS_TRACK_SECTOR)) return;
+
+    if(track)
+        _flags |= FRMFLAGS_TRACK_SECTOR;
+    else
+        _flags &= ~FRMFLAGS_TRACK_SECTOR;
+
+    if(!_scene) return;
+    if(track)
+        _scene->addTracked(this);
+    else
+        _scene->removeTracked(this);
 }
 
 void I3D_frame::setOn(bool on) {
     if(on)
         _flags |= FRMFLAGS_ON;
-    else 
-        _flags &= ~FRMFLAGS_ON;   
+    else
+        _flags &= ~FRMFLAGS_ON;
 }
 
 const glm::mat4& I3D_frame::getLocalMatrix() {
-    if(!(_flags & FRMFLAGS_MAT_DIRTY))
-        return _matrix;
-
-    getMatrix();
-    return _matrix;
+    return getTransforms().getLocalMatrix(_xform);
 }
 
 const glm::mat4& I3D_frame::getMatrix() {
-    if(!(_flags & FRMFLAGS_MAT_DIRTY))
-        return _worldMatrix;
-    
-    if((_flags & FRMFLAGS_POS_DIRTY) || (_flags & FRMFLAGS_ROT_DIRTY) || (_flags & FRMFLAGS_SCALE_DIRTY)) {
-        glm::mat4 translation = glm::translate(glm::mat4(1.0f), _pos);
-        glm::mat4 scale = glm::scale(glm::mat4(1.0f), _scale);
-        glm::mat4 rot = glm::toMat4(_rot);
-
-        _matrix = translation * rot * scale;
-        _flags &= ~(FRMFLAGS_POS_DIRTY | FRMFLAGS_ROT_DIRTY | FRMFLAGS_SCALE_DIRTY);
-    }
-
-    _worldMatrix = (_parent != nullptr) ? _parent->getMatrix() * _matrix : _matrix;
-    _flags &= ~FRMFLAGS_MAT_DIRTY;
-    return _worldMatrix;
+    return getTransforms().getMatrix(_xform);
 }
 
 void I3D_frame::setMatrix(const glm::mat4& mat) {
-    _matrix = mat;
-    propagateDirty();
+    getTransforms().setLocalMatrix(_xform, mat);
 }
 
 const glm::vec3& I3D_frame::getPos() const {
-    return _pos;
+    return getTransforms().getPos(_xform);
 }
 
 void I3D_frame::setPos(glm::vec3& pos) {
-    _flags |= FRMFLAGS_POS_DIRTY;
-    _pos = pos;
-    propagateDirty();
+    getTransforms().setPos(_xform, pos);
 }
 
 const glm::quat& I3D_frame::getRot() const {
-    return _rot;
+    return getTransforms().getRot(_xform);
 }
 
 void I3D_frame::setRot(const glm::quat& rot) {
-    _flags |= FRMFLAGS_ROT_DIRTY;
-    _rot = rot;
-    propagateDirty();
+    getTransforms().setRot(_xform, rot);
 }
 
 const glm::vec3& I3D_frame::getScale() const {
-    return _scale;
+    return getTransforms().getScale(_xform);
 }
 
 void I3D_frame::setScale(const glm::vec3& scale) {
-    _flags |= FRMFLAGS_SCALE_DIRTY;
-    _scale = scale;
-    propagateDirty();
+    getTransforms().setScale(_xform, scale);
 }
 
-//----------------------------
+const I3D_bbox& I3D_frame::getWorldBBox() {
+    return getTransforms().getWorldBBox(_xform);
+}
 
-void I3D_frame::propagateDirty() {
-    _flags |= FRMFLAGS_MAT_DIRTY;
+const I3D_bbox& I3D_frame::getBoundBox() {
+    return getTransforms().getBoundBox(_xform);
+}
 
-    for(const ea::shared_ptr<I3D_frame>& child : _children) {
-        if(child) child->propagateDirty();
-    }
+const I3D_bsphere& I3D_frame::getBoundSphere() {
+    return getTransforms().getBoundSphere(_xform);
+}
+
+//----------------------------
+
+I3D_transform_store& I3D_frame::getTransforms() const {
+    return _driver->getTransforms();
 }
\ No newline at end of file
@@ -1,45 +1,56 @@
 #pragma once
 #include "I3D.h"
+#include "I3D_transform.h"
+#include "I3D_name.h"
 
-#include <EASTL/vector.h>
 #include <EASTL/string.h>
-#include <EASTL/shared_ptr.h>
 namespace ea = eastl;
 
 #include <glm/ext.hpp>
 
 enum I3D_FRAME_FLAGS : uint32_t {
     FRMFLAGS_ON             = (1 << 1),
-    FRMFLAGS_MAT_DIRTY      = (1 << 2),
-    FRMFLAGS_POS_DIRTY      = (1 << 5),
-    FRMFLAGS_ROT_DIRTY      = (1 << 3), 
-    FRMFLAGS_SCALE_DIRTY    = (1 << 4)
+    FRMFLAGS_TRACK_SECTOR   = (1 << 2),
 };
 
 class I3D_frame {
 public:
-    I3D_frame(I3D_driver* driver) :
-        _flags(FRMFLAGS_ON | FRMFLAGS_MAT_DIRTY),
-        _driver(driver) {
-    }
+    I3D_frame(I3D_driver* driver);
+    virtual ~I3D_frame();
+
+    //----------------------------
+    // Intrusive reference counting - frames are created with 1 reference owned by the caller,
+    // a parent holds one reference on each of its children. Last release returns the frame to
+    // the driver's pool.
+    uint32_t addRef() { return ++_refs; }
+    uint32_t release();
 
     I3D_FRAME_TYPE getFrameType() const { return _type; }
     void duplicate(I3D_frame* src);
 
-    void setFrameFlags(uint32_t flags) { _flags = flags; }
+    // FRMFLAGS_TRACK_SECTOR is kept, it's changed by setTrackSector()
+    void setFrameFlags(uint32_t flags) { _flags = (flags & ~FRMFLAGS_TRACK_SECTOR) | (_flags & FRMFLAGS_TRACK_SECTOR); }
     uint32_t getFrameFlags() const { return _flags; }
 
+    // have the scene resolve the sector the frame is in on every tick, see I3D_scene::getTrackedSector
+    void setTrackSector(bool track);
+
     I3D_frame* getParent() { return _parent; }
-    const auto& getChildren() { return _children; }
+    I3D_frame* getFirstChild() { return _firstChild; }
+    I3D_frame* getNextSibling() { return _nextSibling; }
 
-    void addChild(ea::shared_ptr<I3D_frame> child);
-    void removeChild(ea::shared_ptr<I3D_frame> child);
+    // O(1), child is detached from its previous parent first
+    void addChild(I3D_frame* child);
+    void removeChild(I3D_frame* child);
 
     bool isOn() const { return _flags & FRMFLAGS_ON; }
     void setOn(bool on);
 
-    const ea::string& getName() const { return _name; }
-    void setName(ea::string& name) { _name = name; }
+    const I3D_name& getName() const { return _name; }
+    void setName(const I3D_name& name);
+
+    // scene this frame is linked into (through the primary sector), if any
+    I3D_scene* getScene() const { return _scene; }
 
     const glm::mat4& getLocalMatrix();
     const glm::mat4& getMatrix();
@@ -53,17 +64,29 @@ public:
 
     const glm::vec3& getScale() const;
     void setScale(const glm::vec3& scale);
+
+    // world bounds of this frame alone / of the frame with all its children
+    const I3D_bbox& getWorldBBox();
+    const I3D_bbox& getBoundBox();
+    const I3D_bsphere& getBoundSphere();
+
+    I3D_xform getTransform() const { return _xform; }
+
+    //NOTE: used internally by I3D_scene, moves whole subtree to the scene
+    void setScene(I3D_scene* scene);
 protected:
-    void propagateDirty();
+    I3D_transform_store& getTransforms() const;
+
     I3D_driver* _driver{ nullptr };
     I3D_FRAME_TYPE _type{};
     uint32_t _flags{};
+    uint32_t _refs{ 1 };
     I3D_frame* _parent{ nullptr };
-    ea::vector<ea::shared_ptr<I3D_frame>> _children{};
-    ea::string _name{};
-    glm::mat4 _worldMatrix{}; // resulting world matrix = _matrix * parnent's matrix
-    glm::mat4 _matrix{}; // resulting local matrix = scale * rot * transl.
-    glm::vec3 _pos{};
-    glm::quat _rot{};
-    glm::vec3 _scale{};
+    I3D_frame* _firstChild{ nullptr };
+    I3D_frame* _lastChild{ nullptr };
+    I3D_frame* _prevSibling{ nullptr };
+    I3D_frame* _nextSibling{ nullptr };
+    I3D_name _name{};
+    I3D_scene* _scene{ nullptr };
+    I3D_xform _xform{ I3D_XFORM_NONE }; // pos/rot/scale, local and world matrix live in driver's transform store
 };
\ No newline at end of file
@@ -0,0 +1,330 @@
+#include "I3D_image.h"
+#include "I3D_simd.h"
+#include "I3D_mipmap.h"
+
+#include <cstdio>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb/stb_image.h"
+
+static void mergeAlpha_scalar(uint32_t* dst, const uint32_t* opacity, size_t count) {
+    for(size_t i = 0; i < count; ++i)
+        dst[i] = (dst[i] & 0x00ffffff) | (opacity[i] << 24);
+}
+
+#if I3D_SIMD_X86
+
+I3D_TARGET_SSE2
+static void mergeAlpha_sse2(uint32_t* dst, const uint32_t* opacity, size_t count) {
+    const __m128i colorMask = _mm_set1_epi32(0x00ffffff);
+    size_t i = 0;
+    for(; i + 4 <= count; i += 4) {
+        const __m128i color = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i)), colorMask);
+        const __m128i alpha = _mm_slli_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(opacity + i)), 24);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_or_si128(color, alpha));
+    }
+    mergeAlpha_scalar(dst + i, opacity + i, count - i);
+}
+
+I3D_TARGET_AVX2
+static void mergeAlpha_avx2(uint32_t* dst, const uint32_t* opacity, size_t count) {
+    const __m256i colorMask = _mm256_set1_epi32(0x00ffffff);
+    size_t i = 0;
+    for(; i + 8 <= count; i += 8) {
+        const __m256i color = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i)), colorMask);
+        const __m256i alpha = _mm256_slli_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(opacity + i)), 24);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_or_si256(color, alpha));
+    }
+    mergeAlpha_scalar(dst + i, opacity + i, count - i);
+}
+
+#endif
+
+//----------------------------
+
+static const I3D_image_kernels kernelsScalar = { "scalar", mergeAlpha_scalar };
+#if I3D_SIMD_X86
+static const I3D_image_kernels kernelsSSE2 = { "sse2", mergeAlpha_sse2 };
+static const I3D_image_kernels kernelsAVX2 = { "avx2", mergeAlpha_avx2 };
+#endif
+
+const I3D_image_kernels& I3D_GetImageKernels(uint32_t features) {
+#if I3D_SIMD_X86
+    if(features & CPUF_AVX2) return kernelsAVX2;
+    if(features & CPUF_SSE2) return kernelsSSE2;
+#endif
+    return kernelsScalar;
+}
+
+const I3D_image_kernels& I3D_GetImageKernels() {
+    static const I3D_image_kernels& kernels = I3D_GetImageKernels(I3D_GetCPUFeatures());
+    return kernels;
+}
+
+//----------------------------
+
+I3D_image::~I3D_image() {
+    release();
+}
+
+I3D_image::I3D_image(I3D_image&& other) {
+    *this = static_cast<I3D_image&&>(other);
+}
+
+I3D_image& I3D_image::operator=(I3D_image&& other) {
+    if(this != &other) {
+        release();
+        _data = other._data;
+        _width = other._width;
+        _height = other._height;
+        _numLevels = other._numLevels;
+        _format = other._format;
+        other._data = nullptr;
+        other._width = other._height = 0;
+        other._numLevels = 1;
+        other._format = TXTFMT_RGBA8;
+    }
+    return *this;
+}
+
+bool I3D_image::load(const char* filename) {
+    release();
+
+    int w = 0, h = 0, channels = 0;
+    _data = stbi_load(filename, &w, &h, &channels, 4);
+    if(!_data) return false;
+
+    _width = uint32_t(w);
+    _height = uint32_t(h);
+    return true;
+}
+
+bool I3D_image::load(const void* data, size_t size) {
+    release();
+
+    int w = 0, h = 0, channels = 0;
+    _data = stbi_load_from_memory(static_cast<const stbi_uc*>(data), int(size), &w, &h, &channels, 4);
+    if(!_data) return false;
+
+    _width = uint32_t(w);
+    _height = uint32_t(h);
+    return true;
+}
+
+void I3D_image::release() {
+    if(_data) STBI_FREE(_data);
+
+    _data = nullptr;
+    _width = _height = 0;
+    _numLevels = 1;
+    _format = TXTFMT_RGBA8;
+}
+
+bool I3D_image::create(uint32_t width, uint32_t height) {
+    release();
+    if(!width || !height) return false;
+
+    _data = static_cast<uint8_t*>(STBI_MALLOC(size_t(width) * height * 4));
+    if(!_data) return false;
+
+    memset(_data, 0, size_t(width) * height * 4);
+    _width = width;
+    _height = height;
+    return true;
+}
+
+bool I3D_image::resize(uint32_t width, uint32_t height) {
+    if(!_data || !width || !height || _format != TXTFMT_RGBA8) return false;
+    if(width == _width && height == _height) return true;
+
+    uint8_t* data = static_cast<uint8_t*>(STBI_MALLOC(size_t(width) * height * 4));
+    if(!data) return false;
+
+    // sample at pixel centers, edges are clamped
+    const float scaleX = float(_width) / float(width);
+    const float scaleY = float(_height) / float(height);
+    for(uint32_t y = 0; y < height; ++y) {
+        const float sy = glm::clamp((float(y) + 0.5f) * scaleY - 0.5f, 0.0f, float(_height - 1));
+        const uint32_t y0 = uint32_t(sy);
+        const uint32_t y1 = glm::min(y0 + 1, _height - 1);
+        const float fy = sy - float(y0);
+
+        for(uint32_t x = 0; x < width; ++x) {
+            const float sx = glm::clamp((float(x) + 0.5f) * scaleX - 0.5f, 0.0f, float(_width - 1));
+            const uint32_t x0 = uint32_t(sx);
+            const uint32_t x1 = glm::min(x0 + 1, _width - 1);
+            const float fx = sx - float(x0);
+
+            const uint8_t* p00 = _data + (size_t(y0) * _width + x0) * 4;
+            const uint8_t* p01 = _data + (size_t(y0) * _width + x1) * 4;
+            const uint8_t* p10 = _data + (size_t(y1) * _width + x0) * 4;
+            const uint8_t* p11 = _data + (size_t(y1) * _width + x1) * 4;
+            uint8_t* out = data + (size_t(y) * width + x) * 4;
+            for(int c = 0; c < 4; ++c) {
+                const float top = p00[c] + (p01[c] - p00[c]) * fx;
+                const float bottom = p10[c] + (p11[c] - p10[c]) * fx;
+                out[c] = uint8_t(top + (bottom - top) * fy + 0.5f);
+            }
+        }
+    }
+
+    STBI_FREE(_data);
+    _data = data;
+    _width = width;
+    _height = height;
+    _numLevels = 1;
+    return true;
+}
+
+bool I3D_image::mergeAlpha(const I3D_image& opacity) {
+    if(!_data || !opacity._data || _format != TXTFMT_RGBA8 || opacity._format != TXTFMT_RGBA8) return false;
+
+    const uint32_t* alpha = reinterpret_cast<const uint32_t*>(opacity._data);
+    I3D_image resized;
+    if(opacity._width != _width || opacity._height != _height) {
+        resized._data = static_cast<uint8_t*>(STBI_MALLOC(opacity.getSize()));
+        if(!resized._data) return false;
+
+        memcpy(resized._data, opacity._data, opacity.getSize());
+        resized._width = opacity._width;
+        resized._height = opacity._height;
+        if(!resized.resize(_width, _height)) return false;
+        alpha = reinterpret_cast<const uint32_t*>(resized._data);
+    }
+
+    I3D_GetImageKernels().mergeAlpha(reinterpret_cast<uint32_t*>(_data), alpha, size_t(_width) * _height);
+    return true;
+}
+
+bool I3D_image::blit(const I3D_image& src, uint32_t x, uint32_t y, uint32_t border) {
+    if(!_data || !src._data || _format != TXTFMT_RGBA8 || src._format != TXTFMT_RGBA8) return false;
+    if(x < border || y < border) return false;
+    if(uint64_t(x) + src._width + border > _width || uint64_t(y) + src._height + border > _height) return false;
+
+    const uint32_t* pixels = reinterpret_cast<const uint32_t*>(src._data);
+    for(uint32_t row = 0; row < src._height + 2 * border; ++row) {
+        const uint32_t srcRow = row < border ? 0 : glm::min(row - border, src._height - 1);
+        const uint32_t* line = pixels + size_t(srcRow) * src._width;
+        uint32_t* out = reinterpret_cast<uint32_t*>(_data) + size_t(y - border + row) * _width + (x - border);
+
+        for(uint32_t i = 0; i < border; ++i)
+            out[i] = line[0];
+        memcpy(out + border, line, size_t(src._width) * 4);
+        for(uint32_t i = 0; i < border; ++i)
+            out[border + src._width + i] = line[src._width - 1];
+    }
+    return true;
+}
+
+bool I3D_image::generateMips(uint32_t flags, uint32_t maxLevels) {
+    if(!_data || _format != TXTFMT_RGBA8) return false;
+
+    uint32_t numLevels = I3D_GetNumMipLevels(_width, _height);
+    if(maxLevels) numLevels = glm::min(numLevels, maxLevels);
+    uint8_t* data = static_cast<uint8_t*>(STBI_REALLOC(_data, I3D_GetMipChainSize(_width, _height, numLevels)));
+    if(!data) return false;
+
+    _data = data;
+    _numLevels = numLevels;
+    I3D_GenerateMips(_data, _width, _height, _numLevels, flags);
+    return true;
+}
+
+bool I3D_image::compress() {
+    if(!_data || _format != TXTFMT_RGBA8) return false;
+
+    // mips of an opaque level 0 are opaque too
+    const uint32_t* pixels = reinterpret_cast<const uint32_t*>(_data);
+    uint32_t alpha = 0xff000000;
+    for(size_t i = 0, count = size_t(_width) * _height; i < count; ++i)
+        alpha &= pixels[i];
+
+    const I3D_TEXTURE_FORMAT format = alpha == 0xff000000 ? TXTFMT_BC1 : TXTFMT_BC3;
+    uint8_t* data = static_cast<uint8_t*>(STBI_MALLOC(I3D_GetTextureSize(format, _width, _height, _numLevels)));
+    if(!data) return false;
+
+    I3D_CompressMips(data, _data, _width, _height, _numLevels, format);
+    STBI_FREE(_data);
+    _data = data;
+    _format = format;
+    return true;
+}
+
+//----------------------------
+
+static constexpr uint32_t VERSION_CACHE = 1;
+
+struct CacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t key;
+    uint32_t format;
+    uint32_t width;
+    uint32_t height;
+    uint32_t numLevels;
+};
+
+bool I3D_image::readCache(const char* filename, uint64_t key) {
+    release();
+
+    FILE* file = fopen(filename, "rb");
+    if(!file) return false;
+
+    CacheHeader header{};
+    const bool valid = fread(&header, sizeof(header), 1, file) == 1 && memcmp(header.magic, "I3DI", 4) == 0 &&
+                       header.version == VERSION_CACHE && header.key == key && header.format < TXTFMT_LAST &&
+                       header.width && header.height && header.width <= 0xffff && header.height <= 0xffff &&
+                       header.numLevels && header.numLevels <= I3D_GetNumMipLevels(header.width, header.height);
+    if(valid) {
+        const I3D_TEXTURE_FORMAT format = I3D_TEXTURE_FORMAT(header.format);
+        const size_t size = I3D_GetTextureSize(format, header.width, header.height, header.numLevels);
+        _data = static_cast<uint8_t*>(STBI_MALLOC(size));
+        if(_data && fread(_data, 1, size, file) == size) {
+            _width = header.width;
+            _height = header.height;
+            _numLevels = header.numLevels;
+            _format = format;
+        } else {
+            release();
+        }
+    }
+    fclose(file);
+    return _data != nullptr;
+}
+
+bool I3D_image::writeCache(const char* filename, uint64_t key) const {
+    if(!_data) return false;
+
+    CacheHeader header{};
+    memcpy(header.magic, "I3DI", 4);
+    header.version = VERSION_CACHE;
+    header.key = key;
+    header.format = _format;
+    header.width = _width;
+    header.height = _height;
+    header.numLevels = _numLevels;
+
+    // written next to the target under a name of its own, then moved over it
+    char tempName[1024];
+    snprintf(tempName, sizeof(tempName), "%s.%p.tmp", filename, static_cast<const void*>(this));
+    FILE* file = fopen(tempName, "wb");
+    if(!file) return false;
+
+    const size_t size = getTotalSize();
+    const bool written = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(_data, 1, size, file) == size;
+    if(fclose(file) != 0 || !written) {
+        remove(tempName);
+        return false;
+    }
+
+    // rename replaces the target on POSIX only
+    if(rename(tempName, filename) != 0 && (remove(filename) != 0 || rename(tempName, filename) != 0)) {
+        remove(tempName);
+        return false;
+    }
+    return true;
+}
+
+size_t I3D_image::getTotalSize() const {
+    return I3D_GetTextureSize(_format, _width, _height, _numLevels);
+}
\ No newline at end of file
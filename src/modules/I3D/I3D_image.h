@@ -0,0 +1,83 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include "I3D_texture_compress.h"
+
+//----------------------------
+// Pixel kernels, pixels are RGBA8 packed to uint32_t (red in the low byte).
+struct I3D_image_kernels {
+    const char* name;
+
+    // alpha of dst[i] = red of opacity[i], color is kept
+    void (*mergeAlpha)(uint32_t* dst, const uint32_t* opacity, size_t count);
+};
+
+// kernels for the best instruction set of this CPU
+const I3D_image_kernels& I3D_GetImageKernels();
+
+// kernels for a given feature mask (CPUF_*), e.g. to compare implementations
+const I3D_image_kernels& I3D_GetImageKernels(uint32_t features);
+
+//----------------------------
+// Decoded image, 8-bit RGBA until it's block compressed. Decoding is thread-safe, so images can be
+// loaded on workers and only handed to the device on the render thread. Editing works on RGBA8.
+class I3D_image {
+public:
+    I3D_image() {}
+    ~I3D_image();
+
+    I3D_image(I3D_image&& other);
+    I3D_image& operator=(I3D_image&& other);
+    I3D_image(const I3D_image&) = delete;
+    I3D_image& operator=(const I3D_image&) = delete;
+
+    bool load(const char* filename);
+    bool load(const void* data, size_t size);
+    void release();
+
+    // blank image, transparent black
+    bool create(uint32_t width, uint32_t height);
+
+    // bilinear resample of level 0 to a new size, mip levels are dropped
+    bool resize(uint32_t width, uint32_t height);
+
+    //----------------------------
+    // Take alpha from a grey opacity map, as the classic engine did for alpha-tested surfaces.
+    // An opacity map of a different size is resampled to this one first.
+    bool mergeAlpha(const I3D_image& opacity);
+
+    // Copy level 0 of src to x, y, with its edge pixels repeated 'border' texels around it, so
+    // filtering at the edge of a texture packed in an atlas doesn't reach its neighbours.
+    bool blit(const I3D_image& src, uint32_t x, uint32_t y, uint32_t border);
+
+    // append the mip chain of level 0, see I3D_GenerateMips for flags; 0 levels = down to 1x1
+    bool generateMips(uint32_t flags, uint32_t maxLevels = 0);
+
+    // block compress all levels, to BC3 if any alpha is below 255, else to BC1
+    bool compress();
+
+    //----------------------------
+    // Compressed images are kept in a disk cache; a cache file stores the key it was written for
+    // and is only read back for the same key. Files are replaced atomically, so workers may
+    // write the same one at once.
+    bool readCache(const char* filename, uint64_t key);
+    bool writeCache(const char* filename, uint64_t key) const;
+
+    bool isValid() const { return _data != nullptr; }
+    uint32_t getWidth() const { return _width; }
+    uint32_t getHeight() const { return _height; }
+    uint8_t* getData() { return _data; }
+    const uint8_t* getData() const { return _data; }
+    uint32_t getNumLevels() const { return _numLevels; }
+    I3D_TEXTURE_FORMAT getFormat() const { return _format; }
+
+    // size of level 0, and of all levels
+    size_t getSize() const { return I3D_GetTextureSize(_format, _width, _height); }
+    size_t getTotalSize() const;
+private:
+    uint8_t* _data{ nullptr };
+    uint32_t _width{};
+    uint32_t _height{};
+    uint32_t _numLevels{ 1 };
+    I3D_TEXTURE_FORMAT _format{ TXTFMT_RGBA8 };
+};
\ No newline at end of file
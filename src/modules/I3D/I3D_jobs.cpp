@@ -0,0 +1,103 @@
+#include "I3D_jobs.h"
+#include <cassert>
+#include <EASTL/shared_ptr.h>
+
+I3D_jobs::~I3D_jobs() {
+    shutdown();
+}
+
+void I3D_jobs::init(uint32_t numWorkers) {
+    assert(_workers.empty());
+    if(numWorkers == 0) {
+        const uint32_t hwThreads = std::thread::hardware_concurrency();
+        numWorkers = hwThreads > 1 ? hwThreads - 1 : 0;
+    }
+
+    _quit = false;
+    for(uint32_t i = 0; i < numWorkers; ++i)
+        _workers.push_back(std::thread([this]() { workerLoop(); }));
+}
+
+void I3D_jobs::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _quit = true;
+    }
+    _wake.notify_all();
+
+    for(std::thread& worker : _workers)
+        worker.join();
+
+    _workers.clear();
+}
+
+void I3D_jobs::parallelFor(uint32_t count, const ea::function<void(uint32_t)>& fn) {
+    if(count == 0) return;
+
+    if(_workers.empty() || count == 1) {
+        for(uint32_t i = 0; i < count; ++i) fn(i);
+        return;
+    }
+
+    // shared, so a helper picked up by a worker after we returned finds no work and leaves
+    struct Batch {
+        std::atomic<uint32_t> next{ 0 };
+        std::atomic<uint32_t> finished{ 0 };
+    };
+    auto batch = ea::make_shared<Batch>();
+
+    auto runner = [this, batch, count, &fn]() {
+        uint32_t i;
+        while((i = batch->next.fetch_add(1)) < count) {
+            fn(i);
+            if(batch->finished.fetch_add(1) + 1 == count) {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _done.notify_all();
+            }
+        }
+    };
+
+    const uint32_t numHelpers = ea::min(count - 1, uint32_t(_workers.size()));
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for(uint32_t i = 0; i < numHelpers; ++i)
+            _queue.push_back(runner);
+    }
+    _wake.notify_all();
+
+    runner();
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    _done.wait(lock, [&]() { return batch->finished.load() == count; });
+}
+
+void I3D_jobs::run(ea::function<void()> task) {
+    if(_workers.empty()) {
+        task();
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _queue.push_back(ea::move(task));
+    }
+    _wake.notify_one();
+}
+
+//----------------------------
+
+void I3D_jobs::workerLoop() {
+    for(;;) {
+        ea::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _wake.wait(lock, [this]() { return _quit || !_queue.empty(); });
+            if(_queue.empty()) return;
+
+            task = ea::move(_queue.front());
+            _queue.pop_front();
+        }
+
+        task();
+    }
+}
\ No newline at end of file
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+#include <EASTL/vector.h>
+#include <EASTL/deque.h>
+#include <EASTL/functional.h>
+namespace ea = eastl;
+
+//----------------------------
+// Small job system - a pool of worker threads pulling tasks from one shared queue.
+// parallelFor() splits work into indexed items, the calling thread takes part in it as well.
+class I3D_jobs {
+public:
+    I3D_jobs() {}
+    ~I3D_jobs();
+
+    // numWorkers == 0 picks (hardware threads - 1)
+    void init(uint32_t numWorkers = 0);
+    void shutdown();
+
+    // workers + calling thread
+    uint32_t getNumThreads() const { return uint32_t(_workers.size()) + 1; }
+
+    //----------------------------
+    // Run fn(i) for every i in [0, count) and wait for all of them. Each item is executed exactly once,
+    // so results are deterministic as long as items don't depend on each other.
+    void parallelFor(uint32_t count, const ea::function<void(uint32_t)>& fn);
+
+    // Queue a task and return right away, without workers it runs here. Tasks still queued
+    // at shutdown() are run before the workers exit.
+    void run(ea::function<void()> task);
+private:
+    void workerLoop();
+
+    ea::vector<std::thread> _workers{};
+    ea::deque<ea::function<void()>> _queue{};
+    std::mutex _mutex{};
+    std::condition_variable _wake{};
+    std::condition_variable _done{};
+    bool _quit{ false };
+};
\ No newline at end of file
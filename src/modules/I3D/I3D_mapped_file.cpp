@@ -0,0 +1,88 @@
+#include "I3D_mapped_file.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+I3D_mapped_file::~I3D_mapped_file() {
+    close();
+}
+
+#ifdef _WIN32
+
+bool I3D_mapped_file::open(const char* filename) {
+    close();
+
+    _file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if(_file == INVALID_HANDLE_VALUE) {
+        _file = nullptr;
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if(!GetFileSizeEx(_file, &size) || size.QuadPart == 0) {
+        close();
+        return false;
+    }
+
+    _mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if(_mapping) _data = static_cast<const uint8_t*>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+    if(!_data) {
+        close();
+        return false;
+    }
+
+    _size = size_t(size.QuadPart);
+    return true;
+}
+
+void I3D_mapped_file::close() {
+    if(_data) UnmapViewOfFile(_data);
+    if(_mapping) CloseHandle(_mapping);
+    if(_file) CloseHandle(_file);
+
+    _data = nullptr;
+    _mapping = nullptr;
+    _file = nullptr;
+    _size = 0;
+}
+
+#else
+
+bool I3D_mapped_file::open(const char* filename) {
+    close();
+
+    const int fd = ::open(filename, O_RDONLY);
+    if(fd < 0) return false;
+
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+
+    // the mapping keeps its own reference to the file
+    void* data = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if(data == MAP_FAILED) return false;
+
+    madvise(data, size_t(st.st_size), MADV_SEQUENTIAL);
+    _data = static_cast<const uint8_t*>(data);
+    _size = size_t(st.st_size);
+    return true;
+}
+
+void I3D_mapped_file::close() {
+    if(_data) munmap(const_cast<uint8_t*>(_data), _size);
+
+    _data = nullptr;
+    _size = 0;
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,29 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+//----------------------------
+// Read-only memory mapped file. Pages are loaded by the OS on first touch, so parsing straight
+// from getData() streams the file at disk speed without staging copies.
+class I3D_mapped_file {
+public:
+    I3D_mapped_file() {}
+    ~I3D_mapped_file();
+
+    I3D_mapped_file(const I3D_mapped_file&) = delete;
+    I3D_mapped_file& operator=(const I3D_mapped_file&) = delete;
+
+    bool open(const char* filename);
+    void close();
+
+    bool isOpen() const { return _data != nullptr; }
+    const uint8_t* getData() const { return _data; }
+    size_t getSize() const { return _size; }
+private:
+#ifdef _WIN32
+    void* _file{ nullptr };
+    void* _mapping{ nullptr };
+#endif
+    const uint8_t* _data{ nullptr };
+    size_t _size{};
+};
\ No newline at end of file
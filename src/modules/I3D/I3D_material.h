@@ -1,4 +1,87 @@
 #pragma once
+#include "I3D.h"
+#include "I3D_name.h"
+#include "I3D_texture.h"
+
+#include <EASTL/shared_ptr.h>
+namespace ea = eastl;
+
+#include <glm/glm.hpp>
+
+// LS3D material flags, as stored in 4DS files
+enum I3D_MATERIAL_FLAGS : uint32_t {
+    MTLFLAGS_BLEND_NORMAL       = (1u << 8),
+    MTLFLAGS_BLEND_MULTIPLY     = (1u << 9),
+    MTLFLAGS_BLEND_ADDITIVE     = (1u << 10),
+    MTLFLAGS_ENV_CALC_Y         = (1u << 12),
+    MTLFLAGS_ENV_PROJECT_Y      = (1u << 13),
+    MTLFLAGS_ENV_PROJECT_Z      = (1u << 14),
+    MTLFLAGS_ADDITIONAL_EFFECT  = (1u << 15),
+    MTLFLAGS_DIFFUSE_TEXTURE    = (1u << 18),
+    MTLFLAGS_ENV_TEXTURE        = (1u << 19),
+    MTLFLAGS_MIPMAPPING         = (1u << 23),
+    MTLFLAGS_ANIMATED_ALPHA     = (1u << 25),
+    MTLFLAGS_ANIMATED_DIFFUSE   = (1u << 26),
+    MTLFLAGS_COLORED            = (1u << 27),
+    MTLFLAGS_TWO_SIDED          = (1u << 28),
+    MTLFLAGS_COLORKEY           = (1u << 29),
+    MTLFLAGS_ALPHA_TEXTURE      = (1u << 30),
+    MTLFLAGS_ADDITIVE_MIXING    = (1u << 31),
+};
+
+enum I3D_MATERIAL_MAP {
+    MTLMAP_DIFFUSE,
+    MTLMAP_ALPHA,
+    MTLMAP_ENV,
+    MTLMAP_LAST,
+};
+
+//----------------------------
+// Surface description shared by face groups of meshes. Texture maps are referenced by file name,
+// textures created from them are attached once loaded.
 class I3D_material {
 public:
+    const I3D_name& getName() const { return _name; }
+    void setName(const I3D_name& name) { _name = name; }
+
+    void setFlags(uint32_t flags) { _flags = flags; }
+    uint32_t getFlags() const { return _flags; }
+
+    void setAmbient(const glm::vec3& color) { _ambient = color; }
+    const glm::vec3& getAmbient() const { return _ambient; }
+
+    void setDiffuse(const glm::vec3& color) { _diffuse = color; }
+    const glm::vec3& getDiffuse() const { return _diffuse; }
+
+    void setEmissive(const glm::vec3& color) { _emissive = color; }
+    const glm::vec3& getEmissive() const { return _emissive; }
+
+    void setAlpha(float alpha) { _alpha = alpha; }
+    float getAlpha() const { return _alpha; }
+
+    void setEnvRatio(float ratio) { _envRatio = ratio; }
+    float getEnvRatio() const { return _envRatio; }
+
+    void setMapName(I3D_MATERIAL_MAP map, const I3D_name& fileName) { _maps[map] = fileName; }
+    const I3D_name& getMapName(I3D_MATERIAL_MAP map) const { return _maps[map]; }
+
+    void setTexture(I3D_MATERIAL_MAP map, const ea::shared_ptr<I3D_texture_base>& texture) { _textures[map] = texture; }
+    const ea::shared_ptr<I3D_texture_base>& getTexture(I3D_MATERIAL_MAP map) const { return _textures[map]; }
+
+    // animated maps: file names are numbered sequences, e.g. "water00.bmp" .. "water07.bmp"
+    void setAnimation(uint32_t numFrames, uint32_t delay) { _animFrames = numFrames; _animDelay = delay; }
+    uint32_t getAnimFrames() const { return _animFrames; }
+    uint32_t getAnimDelay() const { return _animDelay; }
+private:
+    I3D_name _name{};
+    uint32_t _flags{};
+    glm::vec3 _ambient{ 1.0f };
+    glm::vec3 _diffuse{ 1.0f };
+    glm::vec3 _emissive{ 0.0f };
+    float _alpha{ 1.0f };
+    float _envRatio{};
+    I3D_name _maps[MTLMAP_LAST]{};
+    ea::shared_ptr<I3D_texture_base> _textures[MTLMAP_LAST]{};
+    uint32_t _animFrames{};
+    uint32_t _animDelay{}; // in ms
 };
\ No newline at end of file
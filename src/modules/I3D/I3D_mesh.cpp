@@ -1 +1,54 @@
-#include "I3D_mesh.h"
\ No newline at end of file
+#include "I3D_mesh.h"
+#include <cassert>
+
+I3D_mesh::~I3D_mesh() {
+    if(!_device) return;
+
+    for(I3D_mesh_lod& lod : _lods) {
+        _device->destroyBuffer(lod.vertexBuffer);
+        for(I3D_face_group& faceGroup : lod.faceGroups)
+            _device->destroyBuffer(faceGroup.indexBuffer);
+    }
+}
+
+I3D_mesh_lod& I3D_mesh::addLod(float distance, const void* vertices, uint32_t numVertices) {
+    _lods.push_back();
+    I3D_mesh_lod& lod = _lods.back();
+    lod.distance = distance;
+    lod.numVertices = numVertices;
+    lod.vertexData = vertices;
+    return lod;
+}
+
+void I3D_mesh::addFaceGroup(I3D_mesh_lod& lod, const ea::shared_ptr<I3D_material>& material, const void* indices, uint32_t numIndices) {
+    lod.faceGroups.push_back();
+    I3D_face_group& faceGroup = lod.faceGroups.back();
+    faceGroup.material = material;
+    faceGroup.numIndices = numIndices;
+    faceGroup.indexData = indices;
+}
+
+void I3D_mesh::upload(IDevice* device) {
+    assert(!_device);
+    _device = device;
+
+    for(I3D_mesh_lod& lod : _lods) {
+        if(_device && lod.numVertices) {
+            BufferDesc desc{};
+            desc.type = SG_BUFFERTYPE_VERTEXBUFFER;
+            desc.data = sg_range{ lod.vertexData, lod.numVertices * sizeof(I3D_vertex) };
+            lod.vertexBuffer = _device->createBuffer(desc);
+        }
+        lod.vertexData = nullptr;
+
+        for(I3D_face_group& faceGroup : lod.faceGroups) {
+            if(_device && faceGroup.numIndices) {
+                BufferDesc desc{};
+                desc.type = SG_BUFFERTYPE_INDEXBUFFER;
+                desc.data = sg_range{ faceGroup.indexData, faceGroup.numIndices * sizeof(uint16_t) };
+                faceGroup.indexBuffer = _device->createBuffer(desc);
+            }
+            faceGroup.indexData = nullptr;
+        }
+    }
+}
\ No newline at end of file
@@ -1 +1,66 @@
-#pragma once
\ No newline at end of file
+#pragma once
+#include "I3D.h"
+#include "I3D_material.h"
+#include "IDevice.h"
+
+#include <EASTL/vector.h>
+#include <EASTL/shared_ptr.h>
+namespace ea = eastl;
+
+#include <glm/glm.hpp>
+
+// vertex layout of 4DS meshes, handed to the device as is
+struct I3D_vertex {
+    glm::vec3 pos;
+    glm::vec3 normal;
+    glm::vec2 uv;
+};
+static_assert(sizeof(I3D_vertex) == 32, "I3D_vertex must match the 4DS vertex layout");
+
+// triangles sharing one material, 16-bit indices into the vertices of the LOD
+struct I3D_face_group {
+    ea::shared_ptr<I3D_material> material{};
+    uint32_t numIndices{};
+    Buffer indexBuffer{};
+    const void* indexData{ nullptr };   // source until upload()
+};
+
+struct I3D_mesh_lod {
+    float distance{};       // used from this camera distance on
+    uint32_t numVertices{};
+    Buffer vertexBuffer{};
+    const void* vertexData{ nullptr };  // source until upload()
+    ea::vector<I3D_face_group> faceGroups{};
+};
+
+//----------------------------
+// Geometry shared by visuals - levels of detail, each with its vertex buffer and an index buffer
+// per face group. A mesh is built anywhere (e.g. on a loader worker) referencing its source data,
+// buffers are created from the source by upload() on the render thread.
+class I3D_mesh {
+public:
+    I3D_mesh() {}
+    ~I3D_mesh();
+
+    I3D_mesh(const I3D_mesh&) = delete;
+    I3D_mesh& operator=(const I3D_mesh&) = delete;
+
+    // source data is referenced, not copied - it must stay valid until upload()
+    I3D_mesh_lod& addLod(float distance, const void* vertices, uint32_t numVertices);
+    void addFaceGroup(I3D_mesh_lod& lod, const ea::shared_ptr<I3D_material>& material, const void* indices, uint32_t numIndices);
+
+    // create device buffers and drop references to the source data; without a device
+    // only counts and bounds are kept (e.g. for tools)
+    void upload(IDevice* device);
+
+    uint32_t getNumLods() const { return uint32_t(_lods.size()); }
+    const I3D_mesh_lod& getLod(uint32_t i) const { return _lods[i]; }
+
+    // local bounds of the most detailed LOD
+    void setBBox(const I3D_bbox& bbox) { _bbox = bbox; }
+    const I3D_bbox& getBBox() const { return _bbox; }
+private:
+    IDevice* _device{ nullptr };
+    ea::vector<I3D_mesh_lod> _lods{};
+    I3D_bbox _bbox{ glm::vec3(1e+16f), glm::vec3(-1e+16f) };
+};
\ No newline at end of file
@@ -0,0 +1,291 @@
+#include "I3D_mipmap.h"
+#include "I3D_simd.h"
+
+#include <cmath>
+#include <cstring>
+
+uint32_t I3D_GetNumMipLevels(uint32_t width, uint32_t height) {
+    uint32_t numLevels = 1;
+    for(uint32_t size = glm::max(width, height); size > 1; size >>= 1)
+        ++numLevels;
+    return numLevels;
+}
+
+size_t I3D_GetMipChainSize(uint32_t width, uint32_t height, uint32_t numLevels) {
+    size_t size = 0;
+    for(uint32_t level = 0; level < numLevels; ++level) {
+        size += size_t(width) * height * 4;
+        width = glm::max(width >> 1, 1u);
+        height = glm::max(height >> 1, 1u);
+    }
+    return size;
+}
+
+//----------------------------
+// sRGB <-> linear lookups. Linear values are 16 bit, so the sum of a 2x2 box fits in 18 bits and
+// its top 14 bits index the way back.
+static constexpr uint32_t LINEAR_STEPS = 1 << 14;
+
+struct SRGBTables {
+    uint32_t toLinear[256];
+    uint8_t fromLinear[LINEAR_STEPS + 3];   // padded for 32-bit gathers of the last entries
+};
+
+static SRGBTables buildSRGBTables() {
+    SRGBTables tables{};
+    for(uint32_t i = 0; i < 256; ++i) {
+        const double c = i / 255.0;
+        const double linear = c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4);
+        tables.toLinear[i] = uint32_t(linear * 65535.0 + 0.5);
+    }
+    for(uint32_t i = 0; i < LINEAR_STEPS; ++i) {
+        // center of the box sums mapping to this entry
+        const double linear = glm::min((i * 4 + 1.875) / 65535.0, 1.0);
+        const double c = linear <= 0.0031308 ? linear * 12.92 : 1.055 * std::pow(linear, 1.0 / 2.4) - 0.055;
+        tables.fromLinear[i] = uint8_t(c * 255.0 + 0.5);
+    }
+    return tables;
+}
+
+static const SRGBTables& getSRGBTables() {
+    static const SRGBTables tables = buildSRGBTables();
+    return tables;
+}
+
+//----------------------------
+
+static void downsample_scalar(uint32_t* dst, const uint32_t* row0, const uint32_t* row1, uint32_t count) {
+    for(uint32_t i = 0; i < count; ++i) {
+        const uint32_t p0 = row0[2 * i], p1 = row0[2 * i + 1], p2 = row1[2 * i], p3 = row1[2 * i + 1];
+        uint32_t out = 0;
+        for(uint32_t c = 0; c < 32; c += 8) {
+            const uint32_t sum = ((p0 >> c) & 0xff) + ((p1 >> c) & 0xff) + ((p2 >> c) & 0xff) + ((p3 >> c) & 0xff);
+            out |= ((sum + 2) >> 2) << c;
+        }
+        dst[i] = out;
+    }
+}
+
+static void downsampleSRGB_scalar(uint32_t* dst, const uint32_t* row0, const uint32_t* row1, uint32_t count) {
+    const SRGBTables& tables = getSRGBTables();
+    for(uint32_t i = 0; i < count; ++i) {
+        const uint32_t p0 = row0[2 * i], p1 = row0[2 * i + 1], p2 = row1[2 * i], p3 = row1[2 * i + 1];
+        uint32_t out = 0;
+        for(uint32_t c = 0; c < 24; c += 8) {
+            const uint32_t sum = tables.toLinear[(p0 >> c) & 0xff] + tables.toLinear[(p1 >> c) & 0xff] +
+                                 tables.toLinear[(p2 >> c) & 0xff] + tables.toLinear[(p3 >> c) & 0xff];
+            out |= uint32_t(tables.fromLinear[sum >> 4]) << c;
+        }
+        const uint32_t alpha = (p0 >> 24) + (p1 >> 24) + (p2 >> 24) + (p3 >> 24);
+        dst[i] = out | (((alpha + 2) >> 2) << 24);
+    }
+}
+
+#if I3D_SIMD_X86
+
+// 4 pixels of each row to the 16-bit channel sums of 2 boxes
+I3D_TARGET_SSE2
+static inline __m128i boxSums_sse2(__m128i a, __m128i b) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+    const __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+    return _mm_add_epi16(_mm_unpacklo_epi64(lo, hi), _mm_unpackhi_epi64(lo, hi));
+}
+
+I3D_TARGET_SSE2
+static void downsample_sse2(uint32_t* dst, const uint32_t* row0, const uint32_t* row1, uint32_t count) {
+    const __m128i round = _mm_set1_epi16(2);
+    uint32_t i = 0;
+    for(; i + 4 <= count; i += 4) {
+        const __m128i* a = reinterpret_cast<const __m128i*>(row0 + 2 * i);
+        const __m128i* b = reinterpret_cast<const __m128i*>(row1 + 2 * i);
+        const __m128i s0 = boxSums_sse2(_mm_loadu_si128(a), _mm_loadu_si128(b));
+        const __m128i s1 = boxSums_sse2(_mm_loadu_si128(a + 1), _mm_loadu_si128(b + 1));
+        const __m128i out = _mm_packus_epi16(_mm_srli_epi16(_mm_add_epi16(s0, round), 2), _mm_srli_epi16(_mm_add_epi16(s1, round), 2));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), out);
+    }
+    downsample_scalar(dst + i, row0 + 2 * i, row1 + 2 * i, count - i);
+}
+
+// per 128-bit lane, like the SSE2 version
+I3D_TARGET_AVX2
+static inline __m256i boxSums_avx2(__m256i a, __m256i b) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i lo = _mm256_add_epi16(_mm256_unpacklo_epi8(a, zero), _mm256_unpacklo_epi8(b, zero));
+    const __m256i hi = _mm256_add_epi16(_mm256_unpackhi_epi8(a, zero), _mm256_unpackhi_epi8(b, zero));
+    return _mm256_add_epi16(_mm256_unpacklo_epi64(lo, hi), _mm256_unpackhi_epi64(lo, hi));
+}
+
+I3D_TARGET_AVX2
+static void downsample_avx2(uint32_t* dst, const uint32_t* row0, const uint32_t* row1, uint32_t count) {
+    const __m256i round = _mm256_set1_epi16(2);
+    uint32_t i = 0;
+    for(; i + 8 <= count; i += 8) {
+        const __m256i* a = reinterpret_cast<const __m256i*>(row0 + 2 * i);
+        const __m256i* b = reinterpret_cast<const __m256i*>(row1 + 2 * i);
+        const __m256i s0 = boxSums_avx2(_mm256_loadu_si256(a), _mm256_loadu_si256(b));
+        const __m256i s1 = boxSums_avx2(_mm256_loadu_si256(a + 1), _mm256_loadu_si256(b + 1));
+        const __m256i out = _mm256_packus_epi16(_mm256_srli_epi16(_mm256_add_epi16(s0, round), 2), _mm256_srli_epi16(_mm256_add_epi16(s1, round), 2));
+
+        // packing interleaves the lanes: 0 1 4 5 | 2 3 6 7
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_permute4x64_epi64(out, _MM_SHUFFLE(3, 1, 2, 0)));
+    }
+    downsample_scalar(dst + i, row0 + 2 * i, row1 + 2 * i, count - i);
+}
+
+// split 16 pixels into the 8 even and 8 odd ones
+I3D_TARGET_AVX2
+static inline void loadPairs_avx2(const uint32_t* src, __m256i& even, __m256i& odd) {
+    const __m256i deinterleave = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+    const __m256i a = _mm256_permutevar8x32_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src)), deinterleave);
+    const __m256i b = _mm256_permutevar8x32_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 8)), deinterleave);
+    even = _mm256_permute2x128_si256(a, b, 0x20);
+    odd = _mm256_permute2x128_si256(a, b, 0x31);
+}
+
+// the sRGB conversions are table lookups, which only AVX2 can gather; SSE2 uses the scalar version
+I3D_TARGET_AVX2
+static void downsampleSRGB_avx2(uint32_t* dst, const uint32_t* row0, const uint32_t* row1, uint32_t count) {
+    const SRGBTables& tables = getSRGBTables();
+    const int* toLinear = reinterpret_cast<const int*>(tables.toLinear);
+    const int* fromLinear = reinterpret_cast<const int*>(tables.fromLinear);
+    const __m256i byteMask = _mm256_set1_epi32(0xff);
+
+    uint32_t i = 0;
+    for(; i + 8 <= count; i += 8) {
+        __m256i p[4];
+        loadPairs_avx2(row0 + 2 * i, p[0], p[1]);
+        loadPairs_avx2(row1 + 2 * i, p[2], p[3]);
+
+        __m256i alpha = _mm256_set1_epi32(2);
+        for(const __m256i& px : p)
+            alpha = _mm256_add_epi32(alpha, _mm256_srli_epi32(px, 24));
+        __m256i out = _mm256_slli_epi32(_mm256_srli_epi32(alpha, 2), 24);
+
+        for(int c = 0; c < 24; c += 8) {
+            const __m128i shift = _mm_cvtsi32_si128(c);
+            __m256i sum = _mm256_setzero_si256();
+            for(const __m256i& px : p)
+                sum = _mm256_add_epi32(sum, _mm256_i32gather_epi32(toLinear, _mm256_and_si256(_mm256_srl_epi32(px, shift), byteMask), 4));
+
+            const __m256i color = _mm256_and_si256(_mm256_i32gather_epi32(fromLinear, _mm256_srli_epi32(sum, 4), 1), byteMask);
+            out = _mm256_or_si256(out, _mm256_sll_epi32(color, shift));
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), out);
+    }
+    downsampleSRGB_scalar(dst + i, row0 + 2 * i, row1 + 2 * i, count - i);
+}
+
+#endif
+
+//----------------------------
+
+static const I3D_mipmap_kernels kernelsScalar = { "scalar", downsample_scalar, downsampleSRGB_scalar };
+#if I3D_SIMD_X86
+static const I3D_mipmap_kernels kernelsSSE2 = { "sse2", downsample_sse2, downsampleSRGB_scalar };
+static const I3D_mipmap_kernels kernelsAVX2 = { "avx2", downsample_avx2, downsampleSRGB_avx2 };
+#endif
+
+const I3D_mipmap_kernels& I3D_GetMipmapKernels(uint32_t features) {
+#if I3D_SIMD_X86
+    if(features & CPUF_AVX2) return kernelsAVX2;
+    if(features & CPUF_SSE2) return kernelsSSE2;
+#endif
+    return kernelsScalar;
+}
+
+const I3D_mipmap_kernels& I3D_GetMipmapKernels() {
+    static const I3D_mipmap_kernels& kernels = I3D_GetMipmapKernels(I3D_GetCPUFeatures());
+    return kernels;
+}
+
+//----------------------------
+// Alpha coverage. Box filtering blurs alpha, so alpha tested surfaces (fences, foliage) would thin
+// out or bloat with distance. Each level's alpha is scaled so the share of texels passing the test
+// stays that of level 0. The scale is searched on a histogram of the level, not on its pixels.
+
+static inline uint32_t scaleAlpha(uint32_t alpha, float scale) {
+    return glm::min(uint32_t(float(alpha) * scale + 0.5f), 255u);
+}
+
+static float coverage(const uint32_t histogram[256], size_t count, float scale) {
+    size_t passing = 0;
+    for(uint32_t alpha = 0; alpha < 256; ++alpha) {
+        if(scaleAlpha(alpha, scale) >= I3D_MIPMAP_ALPHA_REF)
+            passing += histogram[alpha];
+    }
+    return float(passing) / float(count);
+}
+
+static void alphaHistogram(const uint32_t* pixels, size_t count, uint32_t histogram[256]) {
+    memset(histogram, 0, 256 * sizeof(uint32_t));
+    for(size_t i = 0; i < count; ++i)
+        ++histogram[pixels[i] >> 24];
+}
+
+static void keepCoverage(uint32_t* pixels, size_t count, float target) {
+    uint32_t histogram[256];
+    alphaHistogram(pixels, count, histogram);
+
+    // coverage grows with the scale; search from 1 towards the target, as alpha comes in few distinct
+    // values it moves in steps, so take the side of the step closer to the target
+    const float current = coverage(histogram, count, 1.0f);
+    if(current == target) return;
+
+    float lo = current < target ? 1.0f : 0.0f;
+    float hi = current < target ? 256.0f : 1.0f;
+    for(int i = 0; i < 16; ++i) {
+        const float mid = (lo + hi) * 0.5f;
+        (coverage(histogram, count, mid) < target ? lo : hi) = mid;
+    }
+
+    const float scale = glm::abs(coverage(histogram, count, lo) - target) < glm::abs(coverage(histogram, count, hi) - target) ? lo : hi;
+    if(coverage(histogram, count, scale) == current) return;
+
+    for(size_t i = 0; i < count; ++i)
+        pixels[i] = (pixels[i] & 0x00ffffff) | (scaleAlpha(pixels[i] >> 24, scale) << 24);
+}
+
+//----------------------------
+
+void I3D_GenerateMips(uint8_t* chain, uint32_t width, uint32_t height, uint32_t numLevels, uint32_t flags) {
+    const I3D_mipmap_kernels& kernels = I3D_GetMipmapKernels();
+    const auto downsample = (flags & MIPMAP_SRGB) ? kernels.downsampleSRGB : kernels.downsample;
+
+    uint32_t* src = reinterpret_cast<uint32_t*>(chain);
+    float target = 0.0f;
+    if(flags & MIPMAP_ALPHA_COVERAGE) {
+        uint32_t histogram[256];
+        alphaHistogram(src, size_t(width) * height, histogram);
+        target = coverage(histogram, size_t(width) * height, 1.0f);
+    }
+
+    for(uint32_t level = 1; level < numLevels; ++level) {
+        const uint32_t w = glm::max(width >> 1, 1u);
+        const uint32_t h = glm::max(height >> 1, 1u);
+        uint32_t* dst = src + size_t(width) * height;
+
+        for(uint32_t y = 0; y < h; ++y) {
+            const uint32_t* row0 = src + size_t(glm::min(y * 2, height - 1)) * width;
+            const uint32_t* row1 = src + size_t(glm::min(y * 2 + 1, height - 1)) * width;
+
+            // a one pixel wide level has no pairs, the pixel stands for both
+            uint32_t narrow[4];
+            if(width == 1) {
+                narrow[0] = narrow[1] = row0[0];
+                narrow[2] = narrow[3] = row1[0];
+                row0 = narrow;
+                row1 = narrow + 2;
+            }
+            downsample(dst + size_t(y) * w, row0, row1, w);
+        }
+
+        // nothing passing at level 0 is kept as it is
+        if((flags & MIPMAP_ALPHA_COVERAGE) && target > 0.0f)
+            keepCoverage(dst, size_t(w) * h, target);
+
+        src = dst;
+        width = w;
+        height = h;
+    }
+}
\ No newline at end of file
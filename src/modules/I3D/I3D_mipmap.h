@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+//----------------------------
+// Mip chains are stored tightly, level 0 first, then every level at half the size of the previous
+// one (rounded down, at least 1) down to 1x1. All levels are RGBA8.
+uint32_t I3D_GetNumMipLevels(uint32_t width, uint32_t height);
+size_t I3D_GetMipChainSize(uint32_t width, uint32_t height, uint32_t numLevels);
+
+//----------------------------
+// Downsampling kernels, pixels are RGBA8 packed to uint32_t (red in the low byte). Every dst pixel
+// is the 2x2 box of pixels 2i and 2i+1 of the two source rows, so both rows hold 2 * count pixels.
+struct I3D_mipmap_kernels {
+    const char* name;
+
+    // all channels averaged as stored
+    void (*downsample)(uint32_t* dst, const uint32_t* row0, const uint32_t* row1, uint32_t count);
+
+    // color averaged in linear light and encoded back to sRGB, alpha averaged as stored
+    void (*downsampleSRGB)(uint32_t* dst, const uint32_t* row0, const uint32_t* row1, uint32_t count);
+};
+
+// kernels for the best instruction set of this CPU
+const I3D_mipmap_kernels& I3D_GetMipmapKernels();
+
+// kernels for a given feature mask (CPUF_*), e.g. to compare implementations
+const I3D_mipmap_kernels& I3D_GetMipmapKernels(uint32_t features);
+
+//----------------------------
+
+enum I3D_MIPMAP_FLAGS {
+    MIPMAP_SRGB = (1 << 0),             // color is sRGB encoded, filter it in linear space
+    MIPMAP_ALPHA_COVERAGE = (1 << 1),   // alpha tested, keep the share of texels passing the test
+};
+
+// alpha test reference the coverage is kept for
+static constexpr uint8_t I3D_MIPMAP_ALPHA_REF = 128;
+
+// Fill levels 1..numLevels-1 of a chain from its level 0.
+void I3D_GenerateMips(uint8_t* chain, uint32_t width, uint32_t height, uint32_t numLevels, uint32_t flags);
\ No newline at end of file
@@ -0,0 +1,38 @@
+#include "I3D_model.h"
+#include "I3D_driver.h"
+
+I3D_model::I3D_model(I3D_driver* driver) :
+    I3D_frame(driver)
+{
+    _type = FRAME_MODEL;
+}
+
+void I3D_model::duplicate(I3D_frame* src) {
+    while(_firstChild)
+        removeChild(_firstChild);
+
+    I3D_frame::duplicate(src);
+    duplicateChildren(this, src);
+}
+
+// duplicate() isn't virtual, every frame class copies its own data
+void I3D_model::duplicateChildren(I3D_frame* dst, I3D_frame* src) {
+    for(I3D_frame* child = src->getFirstChild(); child; child = child->getNextSibling()) {
+        I3D_frame* copy = _driver->createFrame(child->getFrameType());
+        if(!copy) continue;
+
+        switch(child->getFrameType()) {
+        case FRAME_VISUAL: I3DCAST_VISUAL(copy)->duplicate(child); break;
+        case FRAME_DUMMY: I3DCAST_DUMMY(copy)->duplicate(child); break;
+        case FRAME_CAMERA: I3DCAST_CAMERA(copy)->duplicate(child); break;
+        case FRAME_OCCLUDER: I3DCAST_OCCLUDER(copy)->duplicate(child); break;
+        case FRAME_MODEL: I3DCAST_MODEL(copy)->I3D_frame::duplicate(child); break;
+        default: copy->duplicate(child); break;
+        }
+
+        // parent holds the only reference
+        dst->addChild(copy);
+        copy->release();
+        duplicateChildren(copy, child);
+    }
+}
\ No newline at end of file
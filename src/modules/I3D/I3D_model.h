@@ -0,0 +1,29 @@
+#pragma once
+#include "I3D_frame.h"
+
+//----------------------------
+// Root of a hierarchy placed many times, e.g. a 4DS file loaded once under a model that's never
+// linked into a scene. duplicate() copies the whole hierarchy under the source, visuals of the
+// copy share meshes with the source, so an instance costs only its frames.
+class I3D_model : public I3D_frame {
+public:
+    I3D_model(I3D_driver* driver);
+
+    // frame data of the source and copies of all frames under it, children of this model
+    // from before are unlinked
+    void duplicate(I3D_frame* src);
+private:
+    void duplicateChildren(I3D_frame* dst, I3D_frame* src);
+};
+
+//----------------------------
+
+#ifdef _DEBUG
+inline I3D_model* I3DCAST_MODEL(I3D_frame* f){ return !f ? nullptr : f->getFrameType()!=FRAME_MODEL ? nullptr : reinterpret_cast<I3D_model*>(f); }
+inline const I3D_model* I3DCAST_CMODEL(const I3D_frame* f){ return !f ? nullptr : f->getFrameType()!=FRAME_MODEL ? nullptr : static_cast<const I3D_model*>(f); }
+#else
+inline I3D_model* I3DCAST_MODEL(I3D_frame* f){ return reinterpret_cast<I3D_model*>(f); }
+inline const I3D_model* I3DCAST_CMODEL(const I3D_frame* f){ return static_cast<const I3D_model*>(f); }
+#endif
+
+//----------------------------
\ No newline at end of file
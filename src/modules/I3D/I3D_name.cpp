@@ -0,0 +1,105 @@
+#include "I3D_name.h"
+
+#include <cassert>
+#include <cctype>
+#include <mutex>
+#include <EASTL/hash_map.h>
+
+static bool equalNames(const ea::string& a, const char* b, uint32_t length) {
+    if(a.size() != length) return false;
+    for(uint32_t i = 0; i < length; ++i) {
+        if(tolower(uint8_t(a[i])) != tolower(uint8_t(b[i]))) return false;
+    }
+    return true;
+}
+
+//----------------------------
+// Entries live in fixed chunks that never move, so readers don't need the lock.
+class I3D_name_table {
+public:
+    I3D_name_table() {
+        add("", 0, I3D_HashName(""));
+    }
+
+    ~I3D_name_table() {
+        for(uint32_t i = 0; i * CHUNK_SIZE < _count; ++i)
+            delete[] _chunks[i];
+    }
+
+    uint32_t intern(const char* str, uint32_t length, bool create) {
+        if(!length) return 0;
+
+        const uint32_t hash = I3D_HashName(str, length);
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        auto range = _ids.equal_range(hash);
+        for(auto it = range.first; it != range.second; ++it) {
+            if(equalNames(get(it->second).str, str, length))
+                return it->second;
+        }
+
+        if(!create) return 0;
+        return add(str, length, hash);
+    }
+
+    struct Entry {
+        ea::string str;
+        uint32_t hash;
+    };
+
+    const Entry& get(uint32_t id) const { return _chunks[id / CHUNK_SIZE][id % CHUNK_SIZE]; }
+private:
+    static constexpr uint32_t CHUNK_SIZE = 1024;
+    static constexpr uint32_t MAX_CHUNKS = 4096;
+
+    uint32_t add(const char* str, uint32_t length, uint32_t hash) {
+        const uint32_t id = _count;
+        assert(id / CHUNK_SIZE < MAX_CHUNKS);
+        if(id % CHUNK_SIZE == 0)
+            _chunks[id / CHUNK_SIZE] = new Entry[CHUNK_SIZE];
+
+        Entry& entry = _chunks[id / CHUNK_SIZE][id % CHUNK_SIZE];
+        entry.str.assign(str, length);
+        entry.hash = hash;
+
+        _ids.insert(ea::make_pair(hash, id));
+        ++_count;
+        return id;
+    }
+
+    std::mutex _mutex{};
+    ea::hash_multimap<uint32_t, uint32_t> _ids{}; // hash -> id
+    Entry* _chunks[MAX_CHUNKS]{};
+    uint32_t _count{};
+};
+
+static I3D_name_table& getTable() {
+    static I3D_name_table table;
+    return table;
+}
+
+//----------------------------
+
+I3D_name::I3D_name(const char* str) :
+    _id(getTable().intern(str, uint32_t(strlen(str)), true)) {
+}
+
+I3D_name::I3D_name(const char* str, uint32_t length) :
+    _id(getTable().intern(str, length, true)) {
+}
+
+I3D_name I3D_name::find(const char* str) {
+    return fromId(getTable().intern(str, uint32_t(strlen(str)), false));
+}
+
+const char* I3D_name::c_str() const {
+    return getTable().get(_id).str.c_str();
+}
+
+const ea::string& I3D_name::str() const {
+    return getTable().get(_id).str;
+}
+
+uint32_t I3D_name::getHash() const {
+    return getTable().get(_id).hash;
+}
\ No newline at end of file
@@ -0,0 +1,35 @@
+#pragma once
+#include "I3D.h"
+
+#include <cstdint>
+#include <EASTL/string.h>
+namespace ea = eastl;
+
+//----------------------------
+// Interned name - handle into a global, thread-safe string table. Equal names (compared case
+// insensitively, as DOS-era asset names are) share one entry, so comparing names is comparing
+// ids and the hash is computed only once. The table keeps the spelling seen first.
+class I3D_name {
+public:
+    I3D_name() {}
+    I3D_name(const char* str);
+    // not null-terminated string, e.g. straight from a file
+    I3D_name(const char* str, uint32_t length);
+    I3D_name(const ea::string& str) : I3D_name(str.c_str()) {}
+
+    // look up an already interned name without adding it, returns empty name if not found
+    static I3D_name find(const char* str);
+    // handle back from an id returned by getId()
+    static I3D_name fromId(uint32_t id) { I3D_name name; name._id = id; return name; }
+
+    const char* c_str() const;
+    const ea::string& str() const;
+    uint32_t getHash() const;
+    uint32_t getId() const { return _id; }
+    bool empty() const { return _id == 0; }
+
+    bool operator==(const I3D_name& other) const { return _id == other._id; }
+    bool operator!=(const I3D_name& other) const { return _id != other._id; }
+private:
+    uint32_t _id{}; // 0 = empty string
+};
\ No newline at end of file
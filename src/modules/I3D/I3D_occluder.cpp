@@ -0,0 +1,34 @@
+#include "I3D_occluder.h"
+
+I3D_occluder::I3D_occluder(I3D_driver* driver) :
+    I3D_frame(driver)
+{
+    _type = FRAME_OCCLUDER;
+}
+
+void I3D_occluder::duplicate(I3D_frame* src) {
+    if(src->getFrameType() == FRAME_OCCLUDER) {
+        const I3D_occluder* occluder = I3DCAST_OCCLUDER(src);
+        setMesh(occluder->_vertices, occluder->_indices);
+    }
+
+    return I3D_frame::duplicate(src);
+}
+
+void I3D_occluder::setMesh(ea::vector<glm::vec3> vertices, ea::vector<uint16_t> indices) {
+    I3D_bbox bbox;
+    bbox.Invalidate();
+    for(const glm::vec3& vertex : vertices) {
+        bbox.min = glm::min(bbox.min, vertex);
+        bbox.max = glm::max(bbox.max, vertex);
+    }
+
+    _vertices = ea::move(vertices);
+    _indices = ea::move(indices);
+    getTransforms().setLocalBBox(_xform, bbox);
+}
+
+
+const I3D_bbox& I3D_occluder::getBBox() const {
+    return getTransforms().getLocalBBox(_xform);
+}
\ No newline at end of file
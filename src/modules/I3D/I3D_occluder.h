@@ -0,0 +1,38 @@
+#pragma once
+#include "I3D_frame.h"
+
+#include <EASTL/vector.h>
+namespace ea = eastl;
+
+//----------------------------
+// Closed convex mesh hiding what's behind it - never rendered, only drawn into the software
+// depth buffer of I3D_occlusion_buffer. The mesh bounds are the frame's local bbox.
+class I3D_occluder : public I3D_frame {
+public:
+    I3D_occluder(I3D_driver* driver);
+    void duplicate(I3D_frame* src);
+
+    // local space, 3 indices per triangle, either winding
+    void setMesh(ea::vector<glm::vec3> vertices, ea::vector<uint16_t> indices);
+    const ea::vector<glm::vec3>& getVertices() const { return _vertices; }
+    const ea::vector<uint16_t>& getIndices() const { return _indices; }
+    const I3D_bbox& getBBox() const;
+private:
+    friend class I3D_scene;
+
+    ea::vector<glm::vec3> _vertices{};
+    ea::vector<uint16_t> _indices{};
+    uint32_t _sceneIndex{};     // in the scene's occluders
+};
+
+//----------------------------
+
+#ifdef _DEBUG
+inline I3D_occluder* I3DCAST_OCCLUDER(I3D_frame* f){ return !f ? nullptr : f->getFrameType()!=FRAME_OCCLUDER ? nullptr : reinterpret_cast<I3D_occluder*>(f); }
+inline const I3D_occluder* I3DCAST_COCCLUDER(const I3D_frame* f){ return !f ? nullptr : f->getFrameType()!=FRAME_OCCLUDER ? nullptr : static_cast<const I3D_occluder*>(f); }
+#else
+inline I3D_occluder* I3DCAST_OCCLUDER(I3D_frame* f){ return reinterpret_cast<I3D_occluder*>(f); }
+inline const I3D_occluder* I3DCAST_COCCLUDER(const I3D_frame* f){ return static_cast<const I3D_occluder*>(f); }
+#endif
+
+//----------------------------
\ No newline at end of file
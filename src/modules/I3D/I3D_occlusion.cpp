@@ -0,0 +1,435 @@
+#include "I3D_occlusion.h"
+#include "I3D_simd.h"
+#include "I3D_scene.h"
+#include "I3D_occluder.h"
+
+#include <EASTL/algorithm.h>
+
+#include <cfloat>
+
+static constexpr int32_t BUFFER_WIDTH = int32_t(I3D_occlusion_buffer::WIDTH);
+static constexpr int32_t BUFFER_HEIGHT = int32_t(I3D_occlusion_buffer::HEIGHT);
+
+// Polygons are clipped to w >= CLIP_NEAR_W and to a guard band of GUARD_BAND times the view
+// in x and y; the band keeps screen coordinates small enough for exact float edge functions.
+static constexpr float CLIP_NEAR_W = 1e-3f;
+static constexpr float GUARD_BAND = 2.0f;
+static constexpr uint32_t NUM_CLIP_PLANES = 5;
+
+// signed distance to a clip plane, >= 0 inside
+static inline float clipDistance(const glm::vec4& v, uint32_t plane) {
+    switch(plane) {
+    case 0: return v.w - CLIP_NEAR_W;
+    case 1: return GUARD_BAND * v.w - v.x;
+    case 2: return GUARD_BAND * v.w + v.x;
+    case 3: return GUARD_BAND * v.w - v.y;
+    default: return GUARD_BAND * v.w + v.y;
+    }
+}
+
+// bit per plane the vertex is outside of
+static inline uint32_t clipCode(const glm::vec4& v) {
+    uint32_t code = 0;
+    for(uint32_t plane = 0; plane < NUM_CLIP_PLANES; ++plane)
+        code |= uint32_t(clipDistance(v, plane) < 0.0f) << plane;
+    return code;
+}
+
+// Two triangles sharing an edge that make a convex quad on screen, as corners a, b, c of the first
+// and d of the second. Quads crossing the near plane are clipped before they project, that keeps
+// them convex if they're flat and convex in clip space.
+static bool mergeQuad(const glm::vec4* vertices, const uint16_t* first, const uint16_t* second, uint16_t corners[4]) {
+    for(uint32_t r = 0; r < 3; ++r) {
+        const uint16_t a = first[r], b = first[(r + 1) % 3], c = first[(r + 2) % 3];
+        for(uint32_t k = 0; k < 3; ++k) {
+            const uint16_t p = second[k], q = second[(k + 1) % 3];
+            if(!((p == a && q == c) || (p == c && q == a))) continue;
+
+            corners[0] = a;
+            corners[1] = b;
+            corners[2] = c;
+            corners[3] = second[(k + 2) % 3];
+
+            bool inFront = true;
+            glm::vec3 points[4];
+            for(uint32_t i = 0; i < 4; ++i) {
+                const glm::vec4& v = vertices[corners[i]];
+                points[i] = glm::vec3(v.x, v.y, v.w);
+                inFront = inFront && v.w >= CLIP_NEAR_W;
+            }
+
+            glm::vec3 normal(0.0f, 0.0f, 1.0f);
+            if(inFront) {
+                for(glm::vec3& point : points)
+                    point = glm::vec3(glm::vec2(point) / point.z, 0.0f);
+            } else {
+                normal = glm::cross(points[1] - points[0], points[2] - points[0]);
+                const glm::vec3 offset = points[3] - points[0];
+                if(glm::abs(glm::dot(normal, offset)) > 1e-3f * glm::length(normal) * glm::length(offset)) return false;
+            }
+
+            // turns the same way at every corner
+            float turns[4];
+            for(uint32_t i = 0; i < 4; ++i) {
+                const glm::vec3 e0 = points[(i + 1) % 4] - points[i];
+                const glm::vec3 e1 = points[(i + 2) % 4] - points[(i + 1) % 4];
+                turns[i] = glm::dot(normal, glm::cross(e0, e1));
+            }
+            return (turns[0] > 0.0f && turns[1] > 0.0f && turns[2] > 0.0f && turns[3] > 0.0f) ||
+                   (turns[0] < 0.0f && turns[1] < 0.0f && turns[2] < 0.0f && turns[3] < 0.0f);
+        }
+    }
+    return false;
+}
+
+//----------------------------
+// scalar
+
+static void drawPolygons_scalar(float* depth, const I3D_raster_polygon* polygons, uint32_t count) {
+    for(uint32_t i = 0; i < count; ++i) {
+        const I3D_raster_polygon& t = polygons[i];
+        for(int32_t y = t.minY; y <= t.maxY; ++y) {
+            const float py = float(y) + 0.5f;
+            float* row = depth + y * BUFFER_WIDTH;
+            for(int32_t x = t.minX; x <= t.maxX; ++x) {
+                const float px = float(x) + 0.5f;
+                bool inside = true;
+                for(uint32_t e = 0; e < t.numEdges && inside; ++e)
+                    inside = t.edges[e].x * px + t.edges[e].y * py + t.edges[e].z >= 0.0f;
+                if(inside) row[x] = glm::max(row[x], t.depth.x * px + t.depth.y * py + t.depth.z);
+            }
+        }
+    }
+}
+
+#if I3D_SIMD_X86
+//----------------------------
+// SSE2 / AVX2 - a row is walked a register of pixels at a time from minX rounded down, rows are
+// a whole number of registers, so that never leaves the row. Pixels outside the polygon get
+// depth 0, which never wins against what's stored.
+
+I3D_TARGET_SSE2
+static void drawPolygons_sse2(float* depth, const I3D_raster_polygon* polygons, uint32_t count) {
+    const __m128 centers = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+    const __m128 zero = _mm_setzero_ps();
+    __m128 ex[I3D_raster_polygon::MAX_EDGES], ey[I3D_raster_polygon::MAX_EDGES];
+    for(uint32_t i = 0; i < count; ++i) {
+        const I3D_raster_polygon& t = polygons[i];
+        for(uint32_t e = 0; e < t.numEdges; ++e)
+            ex[e] = _mm_set1_ps(t.edges[e].x);
+        const __m128 zx = _mm_set1_ps(t.depth.x);
+
+        for(int32_t y = t.minY; y <= t.maxY; ++y) {
+            const float py = float(y) + 0.5f;
+            for(uint32_t e = 0; e < t.numEdges; ++e)
+                ey[e] = _mm_set1_ps(t.edges[e].y * py + t.edges[e].z);
+            const __m128 zy = _mm_set1_ps(t.depth.y * py + t.depth.z);
+
+            float* row = depth + y * BUFFER_WIDTH;
+            for(int32_t x = t.minX & ~3; x <= t.maxX; x += 4) {
+                const __m128 px = _mm_add_ps(_mm_set1_ps(float(x)), centers);
+                __m128 inside = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(ex[0], px), ey[0]), zero);
+                for(uint32_t e = 1; e < t.numEdges; ++e)
+                    inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(ex[e], px), ey[e]), zero));
+
+                const __m128 z = _mm_and_ps(inside, _mm_add_ps(_mm_mul_ps(zx, px), zy));
+                _mm_storeu_ps(row + x, _mm_max_ps(_mm_loadu_ps(row + x), z));
+            }
+        }
+    }
+}
+
+I3D_TARGET_AVX2
+static void drawPolygons_avx2(float* depth, const I3D_raster_polygon* polygons, uint32_t count) {
+    const __m256 centers = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+    const __m256 zero = _mm256_setzero_ps();
+    __m256 ex[I3D_raster_polygon::MAX_EDGES], ey[I3D_raster_polygon::MAX_EDGES];
+    for(uint32_t i = 0; i < count; ++i) {
+        const I3D_raster_polygon& t = polygons[i];
+        for(uint32_t e = 0; e < t.numEdges; ++e)
+            ex[e] = _mm256_set1_ps(t.edges[e].x);
+        const __m256 zx = _mm256_set1_ps(t.depth.x);
+
+        for(int32_t y = t.minY; y <= t.maxY; ++y) {
+            const float py = float(y) + 0.5f;
+            for(uint32_t e = 0; e < t.numEdges; ++e)
+                ey[e] = _mm256_set1_ps(t.edges[e].y * py + t.edges[e].z);
+            const __m256 zy = _mm256_set1_ps(t.depth.y * py + t.depth.z);
+
+            float* row = depth + y * BUFFER_WIDTH;
+            for(int32_t x = t.minX & ~7; x <= t.maxX; x += 8) {
+                const __m256 px = _mm256_add_ps(_mm256_set1_ps(float(x)), centers);
+                __m256 inside = _mm256_cmp_ps(_mm256_fmadd_ps(ex[0], px, ey[0]), zero, _CMP_GE_OQ);
+                for(uint32_t e = 1; e < t.numEdges; ++e)
+                    inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_fmadd_ps(ex[e], px, ey[e]), zero, _CMP_GE_OQ));
+
+                const __m256 z = _mm256_and_ps(inside, _mm256_fmadd_ps(zx, px, zy));
+                _mm256_storeu_ps(row + x, _mm256_max_ps(_mm256_loadu_ps(row + x), z));
+            }
+        }
+    }
+}
+#endif
+
+//----------------------------
+
+static const I3D_occlusion_kernels kernelsScalar = { "scalar", drawPolygons_scalar };
+#if I3D_SIMD_X86
+static const I3D_occlusion_kernels kernelsSSE2 = { "sse2", drawPolygons_sse2 };
+static const I3D_occlusion_kernels kernelsAVX2 = { "avx2", drawPolygons_avx2 };
+#endif
+
+const I3D_occlusion_kernels& I3D_GetOcclusionKernels(uint32_t features) {
+#if I3D_SIMD_X86
+    if(features & CPUF_AVX2) return kernelsAVX2;
+    if(features & CPUF_SSE2) return kernelsSSE2;
+#endif
+    return kernelsScalar;
+}
+
+const I3D_occlusion_kernels& I3D_GetOcclusionKernels() {
+    static const I3D_occlusion_kernels& kernels = I3D_GetOcclusionKernels(I3D_GetCPUFeatures());
+    return kernels;
+}
+
+//----------------------------
+
+I3D_occlusion_buffer::I3D_occlusion_buffer() :
+    _kernels(I3D_GetOcclusionKernels()) {
+    _depth.assign(WIDTH * HEIGHT, 0.0f);
+
+    // levels down to 1x1, each half the one below
+    _levels.push_back({ WIDTH, HEIGHT, 0 });
+    uint32_t size = 0;
+    while(_levels.back().width > 1 || _levels.back().height > 1) {
+        const Level& below = _levels.back();
+        const Level level = { glm::max(below.width / 2, 1u), glm::max(below.height / 2, 1u), size };
+        size += level.width * level.height;
+        _levels.push_back(level);
+    }
+    _hiz.assign(size, 0.0f);
+}
+
+uint32_t I3D_occlusion_buffer::render(I3D_scene* scene, const glm::mat4& viewProj) {
+    begin(viewProj);
+    for(I3D_occluder* occluder : scene->getOccluders()) {
+        if(occluder->isOn()) drawOccluder(occluder);
+    }
+    end();
+    return _stats.numOccluders;
+}
+
+void I3D_occlusion_buffer::begin(const glm::mat4& viewProj) {
+    _viewProj = viewProj;
+    _frustum = I3D_frustum(viewProj);
+    ea::fill(_depth.begin(), _depth.end(), 0.0f);
+    _stats = {};
+}
+
+bool I3D_occlusion_buffer::drawOccluder(I3D_occluder* occluder) {
+    if(!_frustum.testBox(occluder->getWorldBBox())) return false;
+
+    const ea::vector<glm::vec3>& vertices = occluder->getVertices();
+    const ea::vector<uint16_t>& indices = occluder->getIndices();
+    drawMesh(vertices.data(), uint32_t(vertices.size()), indices.data(), uint32_t(indices.size()), occluder->getMatrix());
+    ++_stats.numOccluders;
+    return true;
+}
+
+void I3D_occlusion_buffer::drawMesh(const glm::vec3* vertices, uint32_t numVertices, const uint16_t* indices, uint32_t numIndices, const glm::mat4& world) {
+    const glm::mat4 matrix = _viewProj * world;
+    _clipVertices.resize(numVertices);
+    for(uint32_t i = 0; i < numVertices; ++i)
+        _clipVertices[i] = matrix * glm::vec4(vertices[i], 1.0f);
+
+    _rasterPolygons.clear();
+    for(uint32_t i = 0; i + 2 < numIndices; i += 3) {
+        if(indices[i] >= numVertices || indices[i + 1] >= numVertices || indices[i + 2] >= numVertices) continue;
+
+        // a quad split in two would leave a seam of pixels neither half covers whole
+        uint16_t corners[4] = { indices[i], indices[i + 1], indices[i + 2] };
+        uint32_t numCorners = 3;
+        if(i + 5 < numIndices && indices[i + 3] < numVertices && indices[i + 4] < numVertices && indices[i + 5] < numVertices &&
+           mergeQuad(_clipVertices.data(), indices + i, indices + i + 3, corners)) {
+            numCorners = 4;
+            i += 3;
+        }
+
+        uint32_t anyOutside = 0, allOutside = ~0u;
+        _polygon.clear();
+        for(uint32_t c = 0; c < numCorners; ++c) {
+            const glm::vec4& v = _clipVertices[corners[c]];
+            const uint32_t code = clipCode(v);
+            anyOutside |= code;
+            allOutside &= code;
+            _polygon.push_back(v);
+        }
+        if(allOutside) continue;
+
+        // Sutherland-Hodgman against the planes crossed, the result is drawn whole as well
+        for(uint32_t plane = 0; plane < NUM_CLIP_PLANES && _polygon.size() >= 3; ++plane) {
+            if(!(anyOutside & (1 << plane))) continue;
+
+            _clipped.clear();
+            for(size_t v = 0; v < _polygon.size(); ++v) {
+                const glm::vec4& p = _polygon[v];
+                const glm::vec4& q = _polygon[(v + 1) % _polygon.size()];
+                const float dp = clipDistance(p, plane);
+                const float dq = clipDistance(q, plane);
+                if(dp >= 0.0f) _clipped.push_back(p);
+                if((dp >= 0.0f) != (dq >= 0.0f)) _clipped.push_back(p + (q - p) * (dp / (dp - dq)));
+            }
+            _polygon.swap(_clipped);
+        }
+        if(_polygon.size() >= 3) setupPolygon(_polygon.data(), uint32_t(_polygon.size()));
+    }
+
+    _kernels.drawPolygons(_depth.data(), _rasterPolygons.data(), uint32_t(_rasterPolygons.size()));
+    _stats.numPolygons += uint32_t(_rasterPolygons.size());
+}
+
+// both windings are drawn, the nearer side of a closed mesh wins the depth test anyway
+void I3D_occlusion_buffer::setupPolygon(const glm::vec4* vertices, uint32_t count) {
+    glm::vec3 v[I3D_raster_polygon::MAX_EDGES];
+    for(uint32_t i = 0; i < count; ++i) {
+        const float invW = 1.0f / vertices[i].w;
+        v[i] = glm::vec3((vertices[i].x * invW * 0.5f + 0.5f) * float(BUFFER_WIDTH), (vertices[i].y * invW * 0.5f + 0.5f) * float(BUFFER_HEIGHT), invW);
+    }
+
+    // twice the area of the fan triangles, the largest one gives the depth plane
+    float area = 0.0f, planeArea = 0.0f;
+    uint32_t planeCorner = 2;
+    for(uint32_t i = 2; i < count; ++i) {
+        const float fan = (v[i - 1].x - v[0].x) * (v[i].y - v[0].y) - (v[i].x - v[0].x) * (v[i - 1].y - v[0].y);
+        area += fan;
+        if(glm::abs(fan) > glm::abs(planeArea)) {
+            planeArea = fan;
+            planeCorner = i;
+        }
+    }
+    if(glm::abs(area) < 1e-6f || glm::abs(planeArea) < 1e-6f) return;
+    if(area < 0.0f) {
+        ea::reverse(v + 1, v + count);
+        planeCorner = count + 1 - planeCorner;
+        planeArea = -planeArea;
+    }
+
+    I3D_raster_polygon t;
+    glm::vec2 minPos(FLT_MAX), maxPos(-FLT_MAX);
+    for(uint32_t i = 0; i < count; ++i) {
+        minPos = glm::min(minPos, glm::vec2(v[i]));
+        maxPos = glm::max(maxPos, glm::vec2(v[i]));
+    }
+    t.minX = glm::max(int32_t(glm::floor(minPos.x)), 0);
+    t.minY = glm::max(int32_t(glm::floor(minPos.y)), 0);
+    t.maxX = glm::min(int32_t(glm::ceil(maxPos.x)), BUFFER_WIDTH - 1);
+    t.maxY = glm::min(int32_t(glm::ceil(maxPos.y)), BUFFER_HEIGHT - 1);
+    if(t.minX > t.maxX || t.minY > t.maxY) return;
+
+    // edge i runs from vertex i to the next one and is >= 0 on the inner side
+    auto edge = [](const glm::vec3& p, const glm::vec3& q) {
+        return glm::vec3(p.y - q.y, q.x - p.x, (q.y - p.y) * p.x - (q.x - p.x) * p.y);
+    };
+    t.numEdges = count;
+    for(uint32_t i = 0; i < count; ++i)
+        t.edges[i] = edge(v[i], v[(i + 1) % count]);
+
+    // Barycentrics of the fan triangle are its edge functions opposite each vertex over the area.
+    // A quad needn't be flat, the plane is lowered to pass below the corners off it.
+    const glm::vec3& p0 = v[0];
+    const glm::vec3& p1 = v[planeCorner - 1];
+    const glm::vec3& p2 = v[planeCorner];
+    t.depth = (edge(p1, p2) * p0.z + edge(p2, p0) * p1.z + edge(p0, p1) * p2.z) / planeArea;
+    float above = 0.0f;
+    for(uint32_t i = 0; i < count; ++i)
+        above = glm::max(above, t.depth.x * v[i].x + t.depth.y * v[i].y + t.depth.z - v[i].z);
+    t.depth.z -= above;
+
+    // Conservative: the kernels test pixel centers, moved in by half a pixel along each axis the
+    // edges test the pixel's worst corner instead, so only pixels covered whole are written. The
+    // depth is lowered the same way to the farthest the polygon gets within the pixel.
+    for(uint32_t i = 0; i < count; ++i)
+        t.edges[i].z -= 0.5f * (glm::abs(t.edges[i].x) + glm::abs(t.edges[i].y));
+    t.depth.z -= 0.5f * (glm::abs(t.depth.x) + glm::abs(t.depth.y));
+    _rasterPolygons.push_back(t);
+}
+
+// a texel of a level is the farthest of its 2x2 texels below, so it bounds what's behind it
+void I3D_occlusion_buffer::end() {
+    for(uint32_t l = 1; l < _levels.size(); ++l) {
+        const Level& below = _levels[l - 1];
+        const Level& level = _levels[l];
+        const float* src = getLevel(l - 1);
+        float* dst = _hiz.data() + level.offset;
+        for(uint32_t y = 0; y < level.height; ++y) {
+            const float* row0 = src + glm::min(2 * y, below.height - 1) * below.width;
+            const float* row1 = src + glm::min(2 * y + 1, below.height - 1) * below.width;
+            for(uint32_t x = 0; x < level.width; ++x) {
+                const uint32_t x0 = glm::min(2 * x, below.width - 1);
+                const uint32_t x1 = glm::min(2 * x + 1, below.width - 1);
+                dst[y * level.width + x] = glm::min(glm::min(row0[x0], row0[x1]), glm::min(row1[x0], row1[x1]));
+            }
+        }
+    }
+}
+
+//----------------------------
+
+bool I3D_occlusion_buffer::testBox(const I3D_bbox& box) {
+    ++_stats.numTested;
+    if(!box.IsValid()) return false;
+
+    // corners from one transformed corner and the transformed edges
+    const glm::vec3 size = box.max - box.min;
+    const glm::vec4 base = _viewProj * glm::vec4(box.min, 1.0f);
+    const glm::vec4 edgeX = _viewProj[0] * size.x;
+    const glm::vec4 edgeY = _viewProj[1] * size.y;
+    const glm::vec4 edgeZ = _viewProj[2] * size.z;
+
+    glm::vec2 screenMin(FLT_MAX), screenMax(-FLT_MAX);
+    float nearest = 0.0f;
+    for(uint32_t i = 0; i < 8; ++i) {
+        glm::vec4 v = base;
+        if(i & 1) v += edgeX;
+        if(i & 2) v += edgeY;
+        if(i & 4) v += edgeZ;
+        if(v.w < CLIP_NEAR_W) return true;
+
+        const float invW = 1.0f / v.w;
+        const glm::vec2 screen = (glm::vec2(v) * invW * 0.5f + 0.5f) * glm::vec2(BUFFER_WIDTH, BUFFER_HEIGHT);
+        screenMin = glm::min(screenMin, screen);
+        screenMax = glm::max(screenMax, screen);
+        nearest = glm::max(nearest, invW);
+    }
+
+    // off the screen is for the frustum test to say
+    if(screenMax.x < 0.0f || screenMax.y < 0.0f || screenMin.x >= float(BUFFER_WIDTH) || screenMin.y >= float(BUFFER_HEIGHT)) return true;
+
+    // every pixel the box touches, not only those with their center inside
+    const int32_t x0 = glm::max(int32_t(screenMin.x), 0);
+    const int32_t y0 = glm::max(int32_t(screenMin.y), 0);
+    const int32_t x1 = glm::min(int32_t(screenMax.x), BUFFER_WIDTH - 1);
+    const int32_t y1 = glm::min(int32_t(screenMax.y), BUFFER_HEIGHT - 1);
+
+    uint32_t l = 0;
+    while((x1 >> l) - (x0 >> l) > 1 || (y1 >> l) - (y0 >> l) > 1) ++l;
+
+    const float* level = getLevel(l);
+    const uint32_t width = _levels[l].width;
+    for(int32_t y = y0 >> l; y <= y1 >> l; ++y) {
+        for(int32_t x = x0 >> l; x <= x1 >> l; ++x) {
+            if(nearest >= level[y * width + x]) return true;
+        }
+    }
+
+    ++_stats.numOccluded;
+    return false;
+}
+
+uint32_t I3D_occlusion_buffer::cullBoxes(const I3D_bbox* boxes, uint32_t count, uint32_t* visible) {
+    uint32_t numVisible = 0;
+    for(uint32_t i = 0; i < count; ++i) {
+        if(testBox(boxes[i])) visible[numVisible++] = i;
+    }
+    return numVisible;
+}
\ No newline at end of file
@@ -0,0 +1,123 @@
+#pragma once
+#include "I3D.h"
+#include "I3D_cull.h"
+
+#include <EASTL/vector.h>
+namespace ea = eastl;
+
+class I3D_scene;
+class I3D_occluder;
+
+//----------------------------
+// Convex screen space polygon set up for rasterization, pixel (x, y) is covered when all edge
+// functions e.x * px + e.y * py + e.z at its center are >= 0; depth is 1 / w in the same form.
+// Setup biases both so that center values stand for the whole pixel.
+// Pixels are taken from [minX, maxX] x [minY, maxY] only.
+struct I3D_raster_polygon {
+    static constexpr uint32_t MAX_EDGES = 9;    // a quad clipped by all 5 planes
+
+    glm::vec3 edges[MAX_EDGES];
+    glm::vec3 depth;
+    uint32_t numEdges;
+    int32_t minX, minY, maxX, maxY;
+};
+
+// Rasterization kernels. The depth buffer is I3D_occlusion_buffer::WIDTH pixels per row and
+// keeps the nearest (largest) 1 / w of everything drawn, 0 where nothing is.
+struct I3D_occlusion_kernels {
+    const char* name;
+
+    void (*drawPolygons)(float* depth, const I3D_raster_polygon* polygons, uint32_t count);
+};
+
+// kernels for the best instruction set of this CPU
+const I3D_occlusion_kernels& I3D_GetOcclusionKernels();
+
+// kernels for a given feature mask (CPUF_*), e.g. to compare implementations
+const I3D_occlusion_kernels& I3D_GetOcclusionKernels(uint32_t features);
+
+//----------------------------
+
+struct I3D_OCCLUSION_STATS {
+    uint32_t numOccluders{};    // drawn since begin()
+    uint32_t numPolygons{};     // drawn, after clipping and joining triangles to quads
+    uint32_t numTested{};       // boxes tested
+    uint32_t numOccluded{};     // boxes found hidden
+};
+
+//----------------------------
+// Software occlusion culling - occluders are rasterized on the CPU into a small depth buffer,
+// then bounds are tested against a hierarchical-Z pyramid of it, each level keeping the
+// farthest depth of 2x2 texels of the one below. A box is hidden when its nearest point is behind
+// the farthest occluder in every texel of the level where it covers at most 2x2 of them, so a
+// test reads 4 values whatever its size.
+//
+// Occluders are drawn conservatively - a pixel only gets an occluder's depth where one polygon
+// covers all of it, and then the farthest depth the polygon has there. So a box is only reported
+// hidden when every pixel it touches is behind occluders all over. The price is up to a pixel of
+// occluder lost along polygon edges; triangle pairs making a convex quad are drawn as one polygon,
+// so walls and boxes only lose their outline, but other meshes lose their inner edges too.
+class I3D_occlusion_buffer {
+public:
+    static constexpr uint32_t WIDTH = 256;
+    static constexpr uint32_t HEIGHT = 128;
+
+    I3D_occlusion_buffer();
+
+    I3D_occlusion_buffer(const I3D_occlusion_buffer&) = delete;
+    I3D_occlusion_buffer& operator=(const I3D_occlusion_buffer&) = delete;
+
+    //----------------------------
+    // Draw the occluders of a scene as seen through viewProj: begin(), every occluder that's on
+    // and in the view, end(). Returns the number of occluders drawn.
+    uint32_t render(I3D_scene* scene, const glm::mat4& viewProj);
+
+    // clear the buffer for a view
+    void begin(const glm::mat4& viewProj);
+
+    // occluder mesh through its world matrix, skipped outside the view
+    bool drawOccluder(I3D_occluder* occluder);
+
+    // triangles of a mesh through a world matrix
+    void drawMesh(const glm::vec3* vertices, uint32_t numVertices, const uint16_t* indices, uint32_t numIndices, const glm::mat4& world);
+
+    // build the pyramid, needed before testing
+    void end();
+
+    //----------------------------
+    // whether any of a world space box can be seen past the occluders; boxes crossing the near
+    // plane always can, the frustum is for the view test
+    bool testBox(const I3D_bbox& box);
+
+    // Indices of boxes that can be seen are written to 'visible' in order (room for 'count' is
+    // needed), like I3D_cull_kernels. Returns number of visible.
+    uint32_t cullBoxes(const I3D_bbox* boxes, uint32_t count, uint32_t* visible);
+
+    //----------------------------
+    const float* getDepth() const { return _depth.data(); }
+    uint32_t getNumLevels() const { return uint32_t(_levels.size()); }
+    const I3D_OCCLUSION_STATS& getStats() const { return _stats; }
+private:
+    struct Level {
+        uint32_t width;
+        uint32_t height;
+        uint32_t offset;    // in _hiz, level 0 is _depth itself
+    };
+
+    void setupPolygon(const glm::vec4* vertices, uint32_t count);
+    const float* getLevel(uint32_t level) const { return level ? _hiz.data() + _levels[level].offset : _depth.data(); }
+
+    const I3D_occlusion_kernels& _kernels;
+    glm::mat4 _viewProj{ 1.0f };
+    I3D_frustum _frustum{};
+    ea::vector<float> _depth{};
+    ea::vector<float> _hiz{};
+    ea::vector<Level> _levels{};
+
+    ea::vector<glm::vec4> _clipVertices{};
+    ea::vector<glm::vec4> _polygon{};
+    ea::vector<glm::vec4> _clipped{};
+    ea::vector<I3D_raster_polygon> _rasterPolygons{};
+
+    I3D_OCCLUSION_STATS _stats{};
+};
\ No newline at end of file
@@ -0,0 +1,161 @@
+#pragma once
+#include <cstdint>
+#include <new>
+#include <EASTL/vector.h>
+#include <EASTL/sort.h>
+#include <EASTL/utility.h>
+namespace ea = eastl;
+
+//----------------------------
+// occupancy of a pool; fragmentation is the share of free objects inside slabs that are in use
+struct I3D_POOL_STATS {
+    uint32_t numUsed{};
+    uint32_t capacity{};
+    uint32_t numSlabs{};
+    uint32_t numEmptySlabs{};
+    float occupancy{};
+    float fragmentation{};
+};
+
+//----------------------------
+// Pool allocator for objects of one type. Memory comes in slabs of SLAB_SIZE objects; freed objects
+// go to an intrusive free list and are recycled by the next alloc, so alloc / free are O(1) and
+// allocation-free once the pool has grown to the working set. Empty slabs are returned by trim().
+template<typename T, uint32_t SLAB_SIZE = 256>
+class I3D_pool {
+public:
+    I3D_pool() {}
+    ~I3D_pool() {
+        // NOTE: objects still alive are not destructed, only their memory is dropped
+        for(Node* slab : _slabs)
+            delete[] slab;
+    }
+
+    I3D_pool(const I3D_pool&) = delete;
+    I3D_pool& operator=(const I3D_pool&) = delete;
+
+    template<typename... Args>
+    T* alloc(Args&&... args) {
+        if(!_free) grow();
+
+        Node* node = _free;
+        _free = node->next;
+        ++_used;
+        return new(node->storage) T(ea::forward<Args>(args)...);
+    }
+
+    void free(T* obj) {
+        obj->~T();
+
+        Node* node = reinterpret_cast<Node*>(obj);
+        node->next = _free;
+        _free = node;
+        --_used;
+    }
+
+    //----------------------------
+    // Make sure the next 'count' allocs don't need to grow. Slabs added here are handed out first
+    // and in the order they were allocated, so a batch allocated right after reserve() is contiguous
+    // within each slab; separate slabs aren't adjacent in memory.
+    void reserve(uint32_t count) {
+        const uint32_t numFree = getCapacity() - _used;
+        if(numFree >= count) return;
+
+        ea::vector<Node*> slabs;
+        for(uint32_t n = (count - numFree + SLAB_SIZE - 1) / SLAB_SIZE; n > 0; --n)
+            slabs.push_back(addSlab());
+
+        // last to first, each slab in front of the previous chain
+        for(auto it = slabs.rbegin(); it != slabs.rend(); ++it)
+            linkSlab(*it);
+    }
+
+    //----------------------------
+    // Release slabs with no live objects.
+    void trim() {
+        ea::vector<uint32_t> numFree = countFreePerSlab();
+
+        Node** link = &_free;
+        while(*link) {
+            if(numFree[findSlab(*link)] == SLAB_SIZE)
+                *link = (*link)->next;
+            else
+                link = &(*link)->next;
+        }
+
+        uint32_t kept = 0;
+        for(uint32_t i = 0; i < _slabs.size(); ++i) {
+            if(numFree[i] == SLAB_SIZE)
+                delete[] _slabs[i];
+            else
+                _slabs[kept++] = _slabs[i];
+        }
+        _slabs.resize(kept);
+    }
+
+    I3D_POOL_STATS getStats() const {
+        I3D_POOL_STATS stats{};
+        stats.numUsed = _used;
+        stats.capacity = getCapacity();
+        stats.numSlabs = uint32_t(_slabs.size());
+
+        uint32_t freeInUsedSlabs = 0;
+        for(uint32_t numFree : countFreePerSlab()) {
+            if(numFree == SLAB_SIZE)
+                ++stats.numEmptySlabs;
+            else
+                freeInUsedSlabs += numFree;
+        }
+
+        const uint32_t usedSlabsCapacity = (stats.numSlabs - stats.numEmptySlabs) * SLAB_SIZE;
+        stats.occupancy = stats.capacity ? float(_used) / float(stats.capacity) : 0.0f;
+        stats.fragmentation = usedSlabsCapacity ? float(freeInUsedSlabs) / float(usedSlabsCapacity) : 0.0f;
+        return stats;
+    }
+
+    uint32_t getNumUsed() const { return _used; }
+    uint32_t getCapacity() const { return uint32_t(_slabs.size()) * SLAB_SIZE; }
+private:
+    union Node {
+        Node* next;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    void grow() {
+        linkSlab(addSlab());
+    }
+
+    Node* addSlab() {
+        Node* slab = new Node[SLAB_SIZE];
+
+        // slabs are kept sorted by address for findSlab()
+        _slabs.insert(ea::upper_bound(_slabs.begin(), _slabs.end(), slab), slab);
+        return slab;
+    }
+
+    // put a new slab at the head of the free list, chained in address order, so consecutive
+    // allocations are adjacent in memory
+    void linkSlab(Node* slab) {
+        for(uint32_t i = 0; i + 1 < SLAB_SIZE; ++i)
+            slab[i].next = &slab[i + 1];
+
+        slab[SLAB_SIZE - 1].next = _free;
+        _free = slab;
+    }
+
+    uint32_t findSlab(const Node* node) const {
+        auto it = ea::upper_bound(_slabs.begin(), _slabs.end(), node, [](const Node* n, const Node* slab) { return n < slab; });
+        return uint32_t(it - _slabs.begin()) - 1;
+    }
+
+    ea::vector<uint32_t> countFreePerSlab() const {
+        ea::vector<uint32_t> numFree(_slabs.size(), 0);
+        for(const Node* node = _free; node; node = node->next)
+            ++numFree[findSlab(node)];
+        return numFree;
+    }
+
+    Node* _free{ nullptr };
+    ea::vector<Node*> _slabs{};
+    uint32_t _used{};
+};
\ No newline at end of file
@@ -0,0 +1,310 @@
+#include "I3D_pvs.h"
+#include "I3D_driver.h"
+#include "I3D_scene.h"
+#include "I3D_mapped_file.h"
+
+#include <cstdio>
+#include <cstring>
+
+static constexpr uint32_t VERSION_PVS = 1;
+
+struct PvsHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t sourceHash;
+    uint32_t numSectors;
+    uint32_t dataSize;
+};
+
+// a camera at a sample looks along every axis, the 90 degree views make up a cube around it
+static const glm::vec3 BAKE_DIRECTIONS[6] = {
+    {  1.0f,  0.0f,  0.0f }, { -1.0f,  0.0f,  0.0f },
+    {  0.0f,  1.0f,  0.0f }, {  0.0f, -1.0f,  0.0f },
+    {  0.0f,  0.0f,  1.0f }, {  0.0f,  0.0f, -1.0f },
+};
+
+static void writeVarint(ea::vector<uint8_t>& data, uint32_t value) {
+    while(value >= 0x80) {
+        data.push_back(uint8_t(value) | 0x80);
+        value >>= 7;
+    }
+    data.push_back(uint8_t(value));
+}
+
+//----------------------------
+
+void I3D_pvs::clear() {
+    _names.clear();
+    _rows.clear();
+    _offsets.clear();
+    _data.clear();
+    _decodedRow = NO_SECTOR;
+    _decoded.clear();
+}
+
+uint32_t I3D_pvs::findSector(const I3D_name& name) const {
+    if(name.empty()) return NO_SECTOR;
+
+    auto it = _rows.find(name.getId());
+    return it != _rows.end() ? it->second : NO_SECTOR;
+}
+
+//----------------------------
+
+void I3D_pvs::bake(I3D_scene* scene, uint32_t samplesPerAxis) {
+    clear();
+    samplesPerAxis = glm::max(samplesPerAxis, 1u);
+
+    // the set being baked replaces the scene's one, which mustn't hide anything meanwhile
+    I3D_pvs* scenePVS = scene->getPVS();
+    scene->setPVS(nullptr);
+
+    // a door closed now may be open later
+    ea::vector<ea::pair<I3D_sector*, uint32_t>> closed;
+    const uint32_t numSectors = scene->getNumSectors();
+    for(uint32_t i = 0; i < numSectors; ++i) {
+        I3D_sector* sector = scene->getSector(i);
+        for(uint32_t p = 0; p < sector->getPortals().size(); ++p) {
+            if(sector->getPortals()[p].open) continue;
+            closed.push_back(ea::make_pair(sector, p));
+            sector->setPortalOpen(p, true);
+        }
+
+        const I3D_name& name = sector->getName();
+        if(name.empty() || _rows.find(name.getId()) != _rows.end()) continue;
+        _rows[name.getId()] = uint32_t(_names.size());
+        _names.push_back(name);
+    }
+
+    const uint32_t numRows = getNumSectors();
+    const uint32_t rowWords = (numRows + 31) / 32;
+    ea::vector<uint32_t> bits(size_t(numRows) * rowWords, 0);
+    auto setBit = [&](uint32_t from, uint32_t to) { bits[size_t(from) * rowWords + (to >> 5)] |= 1u << (to & 31); };
+    auto getBit = [&](uint32_t from, uint32_t to) { return (bits[size_t(from) * rowWords + (to >> 5)] >> (to & 31)) & 1u; };
+
+    // far enough to see across the whole scene from any of it
+    I3D_sector* primary = scene->getPrimarySector();
+    const I3D_bbox sceneBox = primary->getBoundBox();
+    const float extent = sceneBox.IsValid() ? glm::length(sceneBox.max - sceneBox.min) : 0.0f;
+
+    I3D_camera* camera = I3DCAST_CAMERA(scene->getDriver()->createFrame(FRAME_CAMERA));
+    camera->setFOV(glm::radians(90.0f));
+    camera->setRange(glm::vec2(0.01f, glm::max(extent * 2.0f, 1.0f)));
+    camera->updateCameraMatrices(1.0f);
+
+    ea::vector<glm::vec3> samples;
+    ea::vector<I3D_SECTOR_VIEW> views;
+    for(uint32_t i = 0; i < numSectors; ++i) {
+        I3D_sector* sector = scene->getSector(i);
+        const uint32_t from = findSector(sector->getName());
+        if(from == NO_SECTOR) continue;
+        setBit(from, from);
+
+        // the primary sector is everything that's not in another one
+        const I3D_bbox bbox = sector == primary ? sceneBox : sector->getWorldBBox();
+        if(!bbox.IsValid()) continue;
+
+        samples.clear();
+        const glm::vec3 step = (bbox.max - bbox.min) / float(samplesPerAxis);
+        for(uint32_t z = 0; z < samplesPerAxis; ++z) {
+            for(uint32_t y = 0; y < samplesPerAxis; ++y) {
+                for(uint32_t x = 0; x < samplesPerAxis; ++x) {
+                    const glm::vec3 pos = bbox.min + (glm::vec3(x, y, z) + 0.5f) * step;
+                    if(scene->findSector(pos) == sector) samples.push_back(pos);
+                }
+            }
+        }
+
+        // too thin for the grid to hit, or filled with sectors inside it - look from the middle
+        if(samples.empty()) samples.push_back((bbox.min + bbox.max) * 0.5f);
+
+        for(const glm::vec3& pos : samples) {
+            for(const glm::vec3& dir : BAKE_DIRECTIONS) {
+                const glm::vec3 up = glm::abs(dir.y) > 0.5f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+                camera->setMatrix(glm::inverse(glm::lookAtLH(pos, pos + dir, up)));
+                camera->setCurrSector(sector);
+
+                views.clear();
+                scene->getVisibleSectors(camera, views);
+                for(const I3D_SECTOR_VIEW& view : views) {
+                    const uint32_t to = findSector(view.sector->getName());
+                    if(to != NO_SECTOR) setBit(from, to);
+                }
+            }
+        }
+    }
+    camera->release();
+
+    // what one sector sees from a sample sees it back, whether or not a sample of its own did
+    for(uint32_t from = 0; from < numRows; ++from) {
+        for(uint32_t to = from + 1; to < numRows; ++to) {
+            if(getBit(from, to) || getBit(to, from)) {
+                setBit(from, to);
+                setBit(to, from);
+            }
+        }
+    }
+
+    for(const auto& portal : closed)
+        portal.first->setPortalOpen(portal.second, false);
+    scene->setPVS(scenePVS);
+
+    encodeRows(bits);
+}
+
+// a clear run that ends the row isn't stored, decoding starts from a clear row
+void I3D_pvs::encodeRows(const ea::vector<uint32_t>& bits) {
+    const uint32_t numRows = getNumSectors();
+    const uint32_t rowWords = (numRows + 31) / 32;
+
+    _offsets.clear();
+    _data.clear();
+    for(uint32_t from = 0; from < numRows; ++from) {
+        _offsets.push_back(uint32_t(_data.size()));
+
+        const uint32_t* row = bits.data() + size_t(from) * rowWords;
+        uint32_t value = 0;
+        uint32_t run = 0;
+        for(uint32_t to = 0; to < numRows; ++to) {
+            const uint32_t bit = (row[to >> 5] >> (to & 31)) & 1u;
+            if(bit != value) {
+                writeVarint(_data, run);
+                value = bit;
+                run = 0;
+            }
+            ++run;
+        }
+        if(value) writeVarint(_data, run);
+    }
+    _offsets.push_back(uint32_t(_data.size()));
+    _decodedRow = NO_SECTOR;
+}
+
+const ea::vector<uint32_t>& I3D_pvs::getVisible(uint32_t from) {
+    if(from == _decodedRow) return _decoded;
+
+    const uint32_t numRows = getNumSectors();
+    _decoded.assign((numRows + 31) / 32, 0);
+    _decodedRow = from;
+
+    // runs are clamped to the row, a damaged one can't write past it
+    const uint8_t* ptr = _data.data() + _offsets[from];
+    const uint8_t* end = _data.data() + _offsets[from + 1];
+    uint32_t pos = 0;
+    bool value = false;
+    while(ptr < end && pos < numRows) {
+        uint32_t run = 0;
+        for(uint32_t shift = 0; ptr < end && shift < 32; shift += 7) {
+            const uint8_t byte = *ptr++;
+            run |= uint32_t(byte & 0x7f) << shift;
+            if(!(byte & 0x80)) break;
+        }
+        run = glm::min(run, numRows - pos);
+
+        // whole words at once, a row of a big scene is mostly long runs
+        if(value) {
+            for(uint32_t to = pos; to < pos + run;) {
+                const uint32_t bit = to & 31;
+                const uint32_t count = glm::min(32 - bit, pos + run - to);
+                const uint32_t mask = count == 32 ? ~0u : ((1u << count) - 1) << bit;
+                _decoded[to >> 5] |= mask;
+                to += count;
+            }
+        }
+        pos += run;
+        value = !value;
+    }
+    return _decoded;
+}
+
+//----------------------------
+// File layout: header, sector names (uint32_t length and characters each), numSectors + 1
+// row offsets and the compressed rows.
+
+I3D_RESULT I3D_pvs::save(const char* filename, uint64_t sourceHash) const {
+    ea::vector<uint8_t> data(sizeof(PvsHeader));
+    auto write = [&data](const void* src, size_t size) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(src);
+        data.insert(data.end(), bytes, bytes + size);
+    };
+
+    for(const I3D_name& name : _names) {
+        const uint32_t length = uint32_t(name.str().size());
+        write(&length, sizeof(length));
+        write(name.c_str(), length);
+    }
+    write(_offsets.data(), _offsets.size() * sizeof(uint32_t));
+    write(_data.data(), _data.size());
+
+    PvsHeader header{};
+    memcpy(header.magic, "I3DP", 4);
+    header.version = VERSION_PVS;
+    header.sourceHash = sourceHash;
+    header.numSectors = getNumSectors();
+    header.dataSize = uint32_t(_data.size());
+    memcpy(data.data(), &header, sizeof(header));
+
+    FILE* file = fopen(filename, "wb");
+    if(!file) return I3DERR_FILENOTFOUND;
+
+    const bool written = fwrite(data.data(), 1, data.size(), file) == data.size();
+    if(fclose(file) != 0 || !written) {
+        remove(filename);
+        return I3DERR_FILENOTFOUND;
+    }
+    return I3D_OK;
+}
+
+I3D_RESULT I3D_pvs::load(const char* filename, const char* source) {
+    clear();
+
+    I3D_mapped_file file;
+    if(!file.open(filename)) return I3DERR_FILENOTFOUND;
+
+    const uint8_t* ptr = file.getData();
+    const uint8_t* end = ptr + file.getSize();
+    auto read = [&ptr, end](void* dst, size_t size) {
+        if(size_t(end - ptr) < size) return false;
+        memcpy(dst, ptr, size);
+        ptr += size;
+        return true;
+    };
+
+    PvsHeader header;
+    if(!read(&header, sizeof(header)) || memcmp(header.magic, "I3DP", 4) != 0) return I3DERR_BADFORMAT;
+    if(header.version != VERSION_PVS) return I3DERR_OUTOFDATE;
+
+    if(source) {
+        I3D_mapped_file sourceFile;
+        if(!sourceFile.open(source) || I3D_HashData(sourceFile.getData(), sourceFile.getSize()) != header.sourceHash)
+            return I3DERR_OUTOFDATE;
+    }
+
+    // every name takes at least its length, so a bad count can't allocate much
+    if(header.numSectors > size_t(end - ptr) / sizeof(uint32_t)) return I3DERR_BADFORMAT;
+    _names.reserve(header.numSectors);
+    for(uint32_t i = 0; i < header.numSectors; ++i) {
+        uint32_t length;
+        if(!read(&length, sizeof(length)) || length > size_t(end - ptr)) {
+            clear();
+            return I3DERR_BADFORMAT;
+        }
+
+        const I3D_name name(reinterpret_cast<const char*>(ptr), length);
+        ptr += length;
+        _rows.insert(ea::make_pair(name.getId(), i));
+        _names.push_back(name);
+    }
+
+    _offsets.resize(header.numSectors + 1);
+    _data.resize(header.dataSize);
+    bool valid = read(_offsets.data(), _offsets.size() * sizeof(uint32_t)) && read(_data.data(), _data.size());
+    valid = valid && _offsets.front() == 0 && _offsets.back() == header.dataSize;
+    for(uint32_t i = 0; valid && i < header.numSectors; ++i)
+        valid = _offsets[i] <= _offsets[i + 1];
+    if(!valid) {
+        clear();
+        return I3DERR_BADFORMAT;
+    }
+    return I3D_OK;
+}
\ No newline at end of file
@@ -0,0 +1,70 @@
+#pragma once
+#include "I3D.h"
+#include "I3D_name.h"
+
+#include <EASTL/vector.h>
+#include <EASTL/hash_map.h>
+namespace ea = eastl;
+
+class I3D_scene;
+
+//----------------------------
+// Potentially visible set - for every sector, the sectors that can be seen from anywhere inside
+// it through any portals, baked offline with bake() and stored alongside the scene. Sectors are
+// identified by name, so the set outlives the order sectors are linked in; sectors sharing a
+// name share a row. Rows are bitsets compressed to runs and decompressed one at a time.
+//
+// Set on a scene with I3D_scene::setPVS(), portal traversal doesn't enter sectors outside the
+// row of the camera's sector, that takes one bit test per portal.
+class I3D_pvs {
+public:
+    static constexpr uint32_t NO_SECTOR = ~0u;
+
+    I3D_pvs() {}
+
+    I3D_pvs(const I3D_pvs&) = delete;
+    I3D_pvs& operator=(const I3D_pvs&) = delete;
+
+    //----------------------------
+    // Sample a grid of samplesPerAxis^3 positions over the bounds of every sector, those the sector
+    // is the innermost one for look around through the scene's portals, all of them taken as open.
+    // Visibility is made mutual, so a sector seen from a sample sees the sample's sector too.
+    void bake(I3D_scene* scene, uint32_t samplesPerAxis);
+
+    // sourceHash ties the set to the scene file it was baked for, see I3D_HashData()
+    I3D_RESULT save(const char* filename, uint64_t sourceHash) const;
+
+    // with a source file given, a set baked for different contents is I3DERR_OUTOFDATE
+    I3D_RESULT load(const char* filename, const char* source = nullptr);
+
+    void clear();
+
+    //----------------------------
+    uint32_t getNumSectors() const { return uint32_t(_names.size()); }
+    const I3D_name& getSectorName(uint32_t sector) const { return _names[sector]; }
+
+    // row of a sector name, NO_SECTOR for sectors the set doesn't know
+    uint32_t findSector(const I3D_name& name) const;
+
+    // Row of 'from' as a bitset of getNumSectors() bits, 32 per word. The last row asked for
+    // is kept, so asking for the same one every frame decompresses it once.
+    const ea::vector<uint32_t>& getVisible(uint32_t from);
+
+    bool isVisible(uint32_t from, uint32_t to) { return getVisible(from)[to >> 5] & (1u << (to & 31)); }
+
+    // compressed size of all rows, bytes
+    size_t getDataSize() const { return _data.size(); }
+private:
+    void encodeRows(const ea::vector<uint32_t>& bits);
+
+    ea::vector<I3D_name> _names{};
+    ea::hash_map<uint32_t, uint32_t> _rows{};   // name id -> row
+
+    // Rows are runs of clear and set bits taking turns, starting with clear ones, every run
+    // length a LEB128 varint; row i is [_offsets[i], _offsets[i + 1]) of _data.
+    ea::vector<uint32_t> _offsets{};
+    ea::vector<uint8_t> _data{};
+
+    uint32_t _decodedRow{ NO_SECTOR };
+    ea::vector<uint32_t> _decoded{};
+};
\ No newline at end of file
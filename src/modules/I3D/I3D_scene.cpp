@@ -0,0 +1,491 @@
+#include "I3D_scene.h"
+#include "I3D_driver.h"
+#include "I3D_pvs.h"
+
+#include <EASTL/sort.h>
+
+#include <cctype>
+#include <cfloat>
+#include <cstring>
+
+// portals passed at most on the way from the camera
+static constexpr uint32_t MAX_PORTAL_DEPTH = 16;
+static constexpr uint32_t NO_VIEW = ~0u;
+
+// Times a sector is looked through by the view of the way in. Ways in inside a rect already looked
+// through are skipped; past this count the others look through all of the view so far, which keeps
+// the work of a dense portal graph at a few passes per sector instead of one per path.
+static constexpr uint32_t MAX_SECTOR_VISITS = 4;
+
+// a sector over more grid cells than this is checked for every position instead
+static constexpr uint64_t MAX_SECTOR_CELLS = 64;
+
+// case insensitive match with '*' and '?' wildcards
+static bool matchName(const char* pattern, const char* name) {
+    const char* star = nullptr;
+    const char* resume = nullptr;
+    while(*name) {
+        if(*pattern == '*') {
+            star = pattern++;
+            resume = name;
+        } else if(*pattern == '?' || tolower(uint8_t(*pattern)) == tolower(uint8_t(*name))) {
+            ++pattern;
+            ++name;
+        } else if(star) {
+            pattern = star + 1;
+            name = ++resume;
+        } else {
+            return false;
+        }
+    }
+
+    while(*pattern == '*') ++pattern;
+    return !*pattern;
+}
+
+//----------------------------
+
+I3D_scene::I3D_scene(I3D_driver* driver) :
+    _driver(driver) {
+    _primarySector = I3DCAST_SECTOR(_driver->createFrame(FRAME_SECTOR));
+    _primarySector->setName("Primary sector");
+    _primarySector->setScene(this);
+    _driver->addScene(this);
+}
+
+I3D_scene::~I3D_scene() {
+    _driver->removeScene(this);
+    _primarySector->setScene(nullptr);
+    _primarySector->release();
+}
+
+I3D_frame* I3D_scene::findFrame(const char* name) const {
+    // a name that was never interned can't belong to any frame
+    const I3D_name key = I3D_name::find(name);
+    if(key.empty()) return nullptr;
+
+    auto it = _names.find(key.getId());
+    return it != _names.end() ? it->second : nullptr;
+}
+
+uint32_t I3D_scene::findFrames(const char* pattern, ea::vector<I3D_frame*>& frames) const {
+    // plain name, no need to scan
+    if(!strpbrk(pattern, "*?")) {
+        const I3D_name key = I3D_name::find(pattern);
+        if(key.empty()) return 0;
+
+        uint32_t numFound = 0;
+        auto range = _names.equal_range(key.getId());
+        for(auto it = range.first; it != range.second; ++it, ++numFound)
+            frames.push_back(it->second);
+        return numFound;
+    }
+
+    uint32_t numFound = 0;
+    for(const auto& entry : _names) {
+        if(matchName(pattern, I3D_name::fromId(entry.first).c_str())) {
+            frames.push_back(entry.second);
+            ++numFound;
+        }
+    }
+    return numFound;
+}
+
+void I3D_scene::addToIndex(I3D_frame* frame) {
+    if(frame->getName().empty()) return;
+    _names.insert(ea::make_pair(frame->getName().getId(), frame));
+}
+
+void I3D_scene::removeFromIndex(I3D_frame* frame) {
+    if(frame->getName().empty()) return;
+
+    auto range = _names.equal_range(frame->getName().getId());
+    for(auto it = range.first; it != range.second; ++it) {
+        if(it->second == frame) {
+            _names.erase(it);
+            return;
+        }
+    }
+}
+
+//----------------------------
+
+void I3D_scene::addSector(I3D_sector* sector) {
+    sector->_sceneIndex = uint32_t(_sectors.size());
+    _sectors.push_back(sector);
+    _sectorsDirty = true;
+}
+
+void I3D_scene::removeSector(I3D_sector* sector) {
+    I3D_sector* last = _sectors.back();
+    _sectors[sector->_sceneIndex] = last;
+    last->_sceneIndex = sector->_sceneIndex;
+    _sectors.pop_back();
+    _sectorsDirty = true;
+
+    // the sector may be released before the next tick, cameras mustn't keep pointing at it
+    for(auto& tracked : _tracked) {
+        if(tracked.second == sector) tracked.second = nullptr;
+
+        I3D_frame* frame = tracked.first;
+        if(frame->getFrameType() == FRAME_CAMERA && I3DCAST_CAMERA(frame)->getCurrSector() == sector)
+            I3DCAST_CAMERA(frame)->setCurrSector(nullptr);
+    }
+}
+
+void I3D_scene::addOccluder(I3D_occluder* occluder) {
+    occluder->_sceneIndex = uint32_t(_occluders.size());
+    _occluders.push_back(occluder);
+}
+
+void I3D_scene::removeOccluder(I3D_occluder* occluder) {
+    I3D_occluder* last = _occluders.back();
+    _occluders[occluder->_sceneIndex] = last;
+    last->_sceneIndex = occluder->_sceneIndex;
+    _occluders.pop_back();
+}
+
+void I3D_scene::buildSectorIndex() {
+    for(I3D_sector* sector : _sectors) {
+        sector->_depth = 0;
+        for(I3D_frame* frame = sector->getParent(); frame; frame = frame->getParent())
+            sector->_depth += frame->getFrameType() == FRAME_SECTOR;
+    }
+
+    buildPortalGraph();
+    buildSectorGrid();
+    buildPVSRows();
+    _sectorsDirty = false;
+}
+
+void I3D_scene::buildPVSRows() {
+    _pvsRows.resize(_sectors.size());
+    for(uint32_t i = 0; i < _sectors.size(); ++i)
+        _pvsRows[i] = _pvs ? _pvs->findSector(_sectors[i]->getName()) : I3D_pvs::NO_SECTOR;
+}
+
+// a portal joins its sector with the closest sector above it, both see each other through it
+void I3D_scene::buildPortalGraph() {
+    struct Edge {
+        uint32_t from;
+        PortalLink link;
+    };
+    ea::vector<Edge> edges;
+
+    for(I3D_sector* sector : _sectors) {
+        I3D_frame* outer = sector->getParent();
+        while(outer && outer->getFrameType() != FRAME_SECTOR)
+            outer = outer->getParent();
+        if(!outer) continue;
+
+        const uint32_t outerIndex = I3DCAST_SECTOR(outer)->_sceneIndex;
+        for(uint32_t p = 0; p < sector->_portals.size(); ++p) {
+            edges.push_back({ sector->_sceneIndex, { sector, p, outerIndex } });
+            edges.push_back({ outerIndex, { sector, p, sector->_sceneIndex } });
+        }
+    }
+
+    _firstLink.assign(_sectors.size() + 1, 0);
+    for(const Edge& edge : edges)
+        ++_firstLink[edge.from + 1];
+    for(uint32_t i = 0; i < _sectors.size(); ++i)
+        _firstLink[i + 1] += _firstLink[i];
+
+    ea::vector<uint32_t> next(_firstLink.begin(), _firstLink.end() - 1);
+    _links.resize(edges.size());
+    for(const Edge& edge : edges)
+        _links[next[edge.from]++] = edge.link;
+}
+
+//----------------------------
+// Cells are as big as an average sector, so a sector usually covers a few of them and a cell
+// holds a few sectors. The primary sector contains everything, it's not in the grid.
+void I3D_scene::buildSectorGrid() {
+    _cells.clear();
+    _cellSectors.clear();
+    _largeSectors.clear();
+
+    float extent = 0.0f;
+    uint32_t numBounded = 0;
+    for(I3D_sector* sector : _sectors) {
+        const I3D_bbox& bbox = sector->getWorldBBox();
+        if(sector == _primarySector || !bbox.IsValid()) continue;
+
+        const glm::vec3 size = bbox.max - bbox.min;
+        extent += glm::max(size.x, glm::max(size.y, size.z));
+        ++numBounded;
+    }
+    _cellSize = numBounded ? glm::max(extent / float(numBounded), 1.0f) : 1.0f;
+
+    struct Entry {
+        uint64_t key;
+        uint32_t sector;
+    };
+    ea::vector<Entry> entries;
+    for(I3D_sector* sector : _sectors) {
+        const I3D_bbox& bbox = sector->getWorldBBox();
+        if(sector == _primarySector || !bbox.IsValid()) continue;
+
+        const glm::ivec3 first = getCell(bbox.min);
+        const glm::ivec3 last = getCell(bbox.max);
+        const glm::i64vec3 span = glm::i64vec3(last - first) + int64_t(1);
+        if(uint64_t(span.x * span.y * span.z) > MAX_SECTOR_CELLS) {
+            _largeSectors.push_back(sector->_sceneIndex);
+            continue;
+        }
+
+        for(int z = first.z; z <= last.z; ++z) {
+            for(int y = first.y; y <= last.y; ++y) {
+                for(int x = first.x; x <= last.x; ++x)
+                    entries.push_back({ cellKey(glm::ivec3(x, y, z)), sector->_sceneIndex });
+            }
+        }
+    }
+
+    ea::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.key < b.key; });
+    _cellSectors.resize(entries.size());
+    for(uint32_t i = 0; i < entries.size(); ++i) {
+        _cellSectors[i] = entries[i].sector;
+        CellRange& range = _cells[entries[i].key];
+        if(!range.count) range.first = i;
+        ++range.count;
+    }
+}
+
+// 21 bits per axis, cells further out wrap around and only share buckets
+uint64_t I3D_scene::cellKey(const glm::ivec3& cell) const {
+    constexpr uint64_t mask = (1 << 21) - 1;
+    return ((uint64_t(cell.x) & mask) << 42) | ((uint64_t(cell.y) & mask) << 21) | (uint64_t(cell.z) & mask);
+}
+
+// innermost of the sectors containing pos
+uint32_t I3D_scene::findInGrid(const glm::vec3& pos) {
+    uint32_t best = _primarySector->_sceneIndex;
+    auto check = [&](uint32_t sector) {
+        if(_sectors[sector]->_depth > _sectors[best]->_depth && _sectors[sector]->contains(pos)) best = sector;
+    };
+
+    auto it = _cells.find(cellKey(getCell(pos)));
+    if(it != _cells.end()) {
+        for(uint32_t i = it->second.first; i < it->second.first + it->second.count; ++i)
+            check(_cellSectors[i]);
+    }
+    for(uint32_t sector : _largeSectors)
+        check(sector);
+    return best;
+}
+
+I3D_sector* I3D_scene::findSector(const glm::vec3& pos, I3D_sector* hint) {
+    if(_sectorsDirty) buildSectorIndex();
+
+    // leaving to the primary sector could mean entering any other, that's for the grid
+    const uint32_t primary = _primarySector->_sceneIndex;
+    uint32_t current = primary;
+    if(hint && hint != _primarySector && hint->getScene() == this) {
+        const uint32_t index = hint->_sceneIndex;
+        if(hint->contains(pos)) {
+            current = index;
+        } else {
+            for(uint32_t l = _firstLink[index]; l < _firstLink[index + 1]; ++l) {
+                const uint32_t next = _links[l].sector;
+                if(next != primary && _sectors[next]->contains(pos)) {
+                    current = next;
+                    break;
+                }
+            }
+        }
+    }
+    if(current == primary) return _sectors[findInGrid(pos)];
+
+    // entered a sector inside the current one
+    for(bool deeper = true; deeper;) {
+        deeper = false;
+        for(uint32_t l = _firstLink[current]; l < _firstLink[current + 1]; ++l) {
+            const uint32_t next = _links[l].sector;
+            if(_sectors[next]->_depth > _sectors[current]->_depth && _sectors[next]->contains(pos)) {
+                current = next;
+                deeper = true;
+                break;
+            }
+        }
+    }
+    return _sectors[current];
+}
+
+//----------------------------
+
+I3D_sector* I3D_scene::getTrackedSector(I3D_frame* frame) const {
+    auto it = _tracked.find(frame);
+    return it != _tracked.end() ? it->second : nullptr;
+}
+
+void I3D_scene::addTracked(I3D_frame* frame) {
+    _tracked[frame] = nullptr;
+}
+
+void I3D_scene::removeTracked(I3D_frame* frame) {
+    _tracked.erase(frame);
+    if(frame->getFrameType() == FRAME_CAMERA) I3DCAST_CAMERA(frame)->setCurrSector(nullptr);
+}
+
+void I3D_scene::updateSectors() {
+    for(auto& tracked : _tracked) {
+        I3D_frame* frame = tracked.first;
+        tracked.second = findSector(glm::vec3(frame->getMatrix()[3]), tracked.second);
+        if(frame->getFrameType() == FRAME_CAMERA) I3DCAST_CAMERA(frame)->setCurrSector(tracked.second);
+    }
+}
+
+struct I3D_scene::Traversal {
+    glm::mat4 viewProj;
+    glm::vec3 eye;
+    float nearDistance;
+    glm::vec4 nearPlane;                // of the camera
+    ea::vector<I3D_SECTOR_VIEW>* views;
+    ea::vector<uint32_t> viewIndex;     // per sector, NO_VIEW until seen
+    ea::vector<uint8_t> onPath;         // sectors being looked through, they aren't entered again
+    ea::vector<uint32_t> numVisits;     // per sector, times looked through
+    ea::vector<glm::vec4> lookedRects;  // per sector MAX_SECTOR_VISITS rects looked through, past the cap the last is the whole view
+    ea::vector<uint32_t> lookedDepths;  // and the depths they were looked through at
+    const uint32_t* pvs;                // baked row of the camera's sector, null without one
+    ea::vector<glm::vec3> polygon;
+    ea::vector<glm::vec3> clipped;
+};
+
+uint32_t I3D_scene::getVisibleSectors(I3D_camera* camera, ea::vector<I3D_SECTOR_VIEW>& views) {
+    if(_sectorsDirty) buildSectorIndex();
+
+    I3D_sector* start = camera->getCurrSector();
+    if(!start || start->getScene() != this) start = _primarySector;
+
+    Traversal traversal;
+    traversal.viewProj = camera->getProjMatrix() * camera->getViewMatrix();
+    traversal.eye = glm::vec3(camera->getMatrix()[3]);
+    traversal.nearDistance = camera->getRange().x;
+    traversal.nearPlane = I3D_frustum(traversal.viewProj).planes[I3D_frustum::NEAR];
+    traversal.views = &views;
+    traversal.viewIndex.assign(_sectors.size(), NO_VIEW);
+    traversal.onPath.assign(_sectors.size(), 0);
+    traversal.numVisits.assign(_sectors.size(), 0);
+    traversal.lookedRects.resize(_sectors.size() * MAX_SECTOR_VISITS);
+    traversal.lookedDepths.resize(_sectors.size() * MAX_SECTOR_VISITS);
+
+    const uint32_t pvsRow = _pvsRows[start->_sceneIndex];
+    traversal.pvs = pvsRow != I3D_pvs::NO_SECTOR ? _pvs->getVisible(pvsRow).data() : nullptr;
+
+    const size_t numViews = views.size();
+    visitSector(traversal, start->_sceneIndex, glm::vec4(-1.0f, -1.0f, 1.0f, 1.0f), traversal.nearPlane, 0);
+    return uint32_t(views.size() - numViews);
+}
+
+//----------------------------
+// The view into a sector is the frustum through 'rect' starting at 'nearPlane' - the plane of
+// the last portal passed. Each portal of the sector is clipped to it, the screen bounds of what's
+// left narrow the view into the sector behind.
+void I3D_scene::visitSector(Traversal& traversal, uint32_t sector, const glm::vec4& rect, const glm::vec4& nearPlane, uint32_t depth) {
+    I3D_frustum frustum(traversal.viewProj, rect);
+    frustum.planes[I3D_frustum::NEAR] = nearPlane;
+    glm::vec4 lookRect = rect;
+
+    uint32_t& viewIndex = traversal.viewIndex[sector];
+    if(viewIndex == NO_VIEW) {
+        viewIndex = uint32_t(traversal.views->size());
+        traversal.views->push_back({ _sectors[sector], frustum, rect, depth });
+    } else {
+        // nothing new behind a rect already looked through, by a way at most as long - the view is
+        // only the bounds of the ways in, what lies between them hasn't been looked at
+        const uint32_t numLooked = glm::min(traversal.numVisits[sector], MAX_SECTOR_VISITS);
+        for(uint32_t i = sector * MAX_SECTOR_VISITS; i < sector * MAX_SECTOR_VISITS + numLooked; ++i) {
+            const glm::vec4& looked = traversal.lookedRects[i];
+            const bool contained = glm::all(glm::greaterThanEqual(glm::vec2(rect), glm::vec2(looked))) &&
+                                   glm::all(glm::lessThanEqual(glm::vec2(rect.z, rect.w), glm::vec2(looked.z, looked.w)));
+            if(contained && depth >= traversal.lookedDepths[i]) return;
+        }
+
+        I3D_SECTOR_VIEW& view = (*traversal.views)[viewIndex];
+        view.rect = glm::vec4(glm::min(glm::vec2(view.rect), glm::vec2(rect)), glm::max(glm::vec2(view.rect.z, view.rect.w), glm::vec2(rect.z, rect.w)));
+        view.frustum = I3D_frustum(traversal.viewProj, view.rect);
+        view.depth = glm::min(view.depth, depth);
+
+        // wider than this way in, from the camera's near plane, but nothing inside is visited again
+        if(traversal.numVisits[sector] >= MAX_SECTOR_VISITS) {
+            lookRect = view.rect;
+            frustum = view.frustum;
+        }
+    }
+    if(depth >= MAX_PORTAL_DEPTH) return;
+
+    // past the cap the last slot holds the whole view, which contains the rect it replaces
+    const uint32_t slot = sector * MAX_SECTOR_VISITS + glm::min(traversal.numVisits[sector], MAX_SECTOR_VISITS - 1);
+    traversal.lookedRects[slot] = lookRect;
+    traversal.lookedDepths[slot] = depth;
+    ++traversal.numVisits[sector];
+    traversal.onPath[sector] = 1;
+    for(uint32_t l = _firstLink[sector]; l < _firstLink[sector + 1]; ++l) {
+        const PortalLink& link = _links[l];
+        const I3D_portal& portal = link.owner->_portals[link.portal];
+        if(!portal.open || portal.vertices.size() < 3 || traversal.onPath[link.sector] || !_sectors[link.sector]->isOn()) continue;
+
+        // never seen from anywhere in the camera's sector, nothing to clip
+        const uint32_t pvsRow = _pvsRows[link.sector];
+        if(traversal.pvs && pvsRow != I3D_pvs::NO_SECTOR && !(traversal.pvs[pvsRow >> 5] & (1u << (pvsRow & 31)))) continue;
+
+        // Newell's normal, good for polygons that aren't quite planar
+        const glm::mat4& matrix = link.owner->getMatrix();
+        traversal.polygon.resize(portal.vertices.size());
+        glm::vec3 normal(0.0f), center(0.0f);
+        for(size_t i = 0; i < portal.vertices.size(); ++i)
+            traversal.polygon[i] = glm::vec3(matrix * glm::vec4(portal.vertices[i], 1.0f));
+        for(size_t i = 0; i < traversal.polygon.size(); ++i) {
+            const glm::vec3& a = traversal.polygon[i];
+            const glm::vec3& b = traversal.polygon[(i + 1) % traversal.polygon.size()];
+            normal += glm::vec3((a.y - b.y) * (a.z + b.z), (a.z - b.z) * (a.x + b.x), (a.x - b.x) * (a.y + b.y));
+            center += a;
+        }
+        if(glm::dot(normal, normal) < 1e-12f) continue;
+
+        normal = glm::normalize(normal);
+        center /= float(traversal.polygon.size());
+        glm::vec4 plane(normal, -glm::dot(normal, center));
+
+        // standing in the portal, its plane would cut the view - look through it as it is
+        const float eyeDistance = glm::dot(normal, traversal.eye) + plane.w;
+        if(glm::abs(eyeDistance) <= traversal.nearDistance) {
+            visitSector(traversal, link.sector, lookRect, traversal.nearPlane, depth + 1);
+            continue;
+        }
+
+        // the view continues behind the portal
+        if(eyeDistance > 0.0f) plane = -plane;
+
+        // Sutherland-Hodgman, the near plane keeps w positive for the projection below
+        for(const glm::vec4& clip : frustum.planes) {
+            traversal.clipped.clear();
+            for(size_t i = 0; i < traversal.polygon.size(); ++i) {
+                const glm::vec3& a = traversal.polygon[i];
+                const glm::vec3& b = traversal.polygon[(i + 1) % traversal.polygon.size()];
+                const float da = glm::dot(glm::vec3(clip), a) + clip.w;
+                const float db = glm::dot(glm::vec3(clip), b) + clip.w;
+                if(da >= 0.0f) traversal.clipped.push_back(a);
+                if((da >= 0.0f) != (db >= 0.0f)) traversal.clipped.push_back(a + (b - a) * (da / (da - db)));
+            }
+            traversal.polygon.swap(traversal.clipped);
+            if(traversal.polygon.size() < 3) break;
+        }
+        if(traversal.polygon.size() < 3) continue;
+
+        glm::vec4 bounds(FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX);
+        for(const glm::vec3& vertex : traversal.polygon) {
+            const glm::vec4 clipPos = traversal.viewProj * glm::vec4(vertex, 1.0f);
+            const glm::vec2 ndc = glm::vec2(clipPos) / glm::max(clipPos.w, 1e-6f);
+            bounds = glm::vec4(glm::min(glm::vec2(bounds), ndc), glm::max(glm::vec2(bounds.z, bounds.w), ndc));
+        }
+
+        // clipped to the view already, only rounding may leave it
+        bounds = glm::vec4(glm::max(glm::vec2(bounds), glm::vec2(lookRect)), glm::min(glm::vec2(bounds.z, bounds.w), glm::vec2(lookRect.z, lookRect.w)));
+        if(bounds.x >= bounds.z || bounds.y >= bounds.w) continue;
+
+        visitSector(traversal, link.sector, bounds, plane, depth + 1);
+    }
+    traversal.onPath[sector] = 0;
+}
\ No newline at end of file
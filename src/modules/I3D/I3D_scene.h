@@ -1 +1,137 @@
-#pragma once
\ No newline at end of file
+#pragma once
+#include "I3D.h"
+#include "I3D_cull.h"
+
+#include <EASTL/vector.h>
+#include <EASTL/hash_map.h>
+namespace ea = eastl;
+
+class I3D_camera;
+class I3D_pvs;
+class I3D_occluder;
+
+//----------------------------
+// Sector seen from a camera with the part of the view it's seen through - all of it for the
+// camera's sector, narrowed by the portals on the way for the others.
+struct I3D_SECTOR_VIEW {
+    I3D_sector* sector;
+    I3D_frustum frustum;
+    glm::vec4 rect;         // min x, min y, max x, max y in normalized device coordinates
+    uint32_t depth;         // portals passed on the shortest way there
+};
+
+//----------------------------
+// Scene - hierarchy of frames under the primary sector plus a name index of all of them.
+// Frames join the index when they're linked (directly or through a parent) under the primary
+// sector, and leave it when unlinked. The index is keyed by interned name ids, so a lookup
+// doesn't have to touch the frames.
+class I3D_scene {
+public:
+    I3D_scene(I3D_driver* driver);
+    ~I3D_scene();
+
+    I3D_sector* getPrimarySector() { return _primarySector; }
+    I3D_driver* getDriver() const { return _driver; }
+
+    //----------------------------
+    // Find frame by exact name (case insensitive), O(1).
+    I3D_frame* findFrame(const char* name) const;
+
+    //----------------------------
+    // Find all frames matching a pattern with '*' (any run of characters) and '?' (single character),
+    // e.g. "car01*" for a prefix lookup. Returns number of frames appended to 'frames'.
+    uint32_t findFrames(const char* pattern, ea::vector<I3D_frame*>& frames) const;
+
+    uint32_t getNumIndexed() const { return uint32_t(_names.size()); }
+
+    //----------------------------
+    // Portal visibility - walk from the camera's sector (the primary one if it has none) through
+    // open portals, clipping the view to every portal passed, so only sectors actually seen are
+    // reached. Appends a view per visible sector and returns their number. A sector seen through
+    // several portals gets the bounds of all of them, with the camera's near plane.
+    uint32_t getVisibleSectors(I3D_camera* camera, ea::vector<I3D_SECTOR_VIEW>& views);
+
+    uint32_t getNumSectors() const { return uint32_t(_sectors.size()); }
+    I3D_sector* getSector(uint32_t index) const { return _sectors[index]; }
+
+    // Baked visibility, portals leading to sectors outside the set of the camera's sector aren't
+    // looked through. Sectors the set doesn't know are taken as visible. Null to use portals alone,
+    // the set isn't owned by the scene.
+    void setPVS(I3D_pvs* pvs) { _pvs = pvs; _sectorsDirty = true; }
+    I3D_pvs* getPVS() const { return _pvs; }
+
+    //----------------------------
+    // Innermost sector containing a world position. With a hint - the sector the position was in
+    // before - the hint and the sectors behind its portals are checked first, so tracking something
+    // that moves costs a few containment tests; otherwise sectors come from a grid over their bounds.
+    I3D_sector* findSector(const glm::vec3& pos, I3D_sector* hint = nullptr);
+
+    // Current sector of a frame tracked by I3D_frame::setTrackSector(), null until the next
+    // updateSectors(). Cameras are tracked from the start, their current sector is set too.
+    I3D_sector* getTrackedSector(I3D_frame* frame) const;
+
+    // sectors of tracked frames after they moved, called by the driver every tick
+    void updateSectors();
+
+    // sectors moved, bounds and hulls are indexed again
+    void invalidateSectors() { _sectorsDirty = true; }
+
+    // occluders linked into the scene, in no particular order - see I3D_occlusion_buffer
+    const ea::vector<I3D_occluder*>& getOccluders() const { return _occluders; }
+
+    //NOTE: used internally by I3D_frame and I3D_sector
+    void addToIndex(I3D_frame* frame);
+    void removeFromIndex(I3D_frame* frame);
+    void addSector(I3D_sector* sector);
+    void removeSector(I3D_sector* sector);
+    void addOccluder(I3D_occluder* occluder);
+    void removeOccluder(I3D_occluder* occluder);
+    void addTracked(I3D_frame* frame);
+    void removeTracked(I3D_frame* frame);
+private:
+    // portal as seen from one of the two sectors it joins
+    struct PortalLink {
+        I3D_sector* owner;      // sector holding the portal
+        uint32_t portal;
+        uint32_t sector;        // index of the sector on the other side
+    };
+
+    struct Traversal;
+    void buildSectorIndex();
+    void buildPortalGraph();
+    void buildSectorGrid();
+    void buildPVSRows();
+    uint64_t cellKey(const glm::ivec3& cell) const;
+    glm::ivec3 getCell(const glm::vec3& pos) const { return glm::ivec3(glm::floor(pos / _cellSize)); }
+    uint32_t findInGrid(const glm::vec3& pos);
+    void visitSector(Traversal& traversal, uint32_t sector, const glm::vec4& rect, const glm::vec4& nearPlane, uint32_t depth);
+
+    I3D_driver* _driver{ nullptr };
+    I3D_sector* _primarySector{ nullptr };
+    ea::hash_multimap<uint32_t, I3D_frame*> _names{}; // name id -> frame
+
+    // sectors linked into the scene and their portals, links of sector i are
+    // [_firstLink[i], _firstLink[i + 1]); rebuilt when sectors or portals change
+    ea::vector<I3D_sector*> _sectors{};
+    ea::vector<uint32_t> _firstLink{};
+    ea::vector<PortalLink> _links{};
+    bool _sectorsDirty{ true };
+
+    // grid of sector bounds, a cell maps to its sectors in _cellSectors; sectors spanning too
+    // many cells are checked everywhere instead
+    struct CellRange {
+        uint32_t first;
+        uint32_t count;
+    };
+    float _cellSize{ 1.0f };
+    ea::hash_map<uint64_t, CellRange> _cells{};
+    ea::vector<uint32_t> _cellSectors{};
+    ea::vector<uint32_t> _largeSectors{};
+
+    ea::vector<I3D_occluder*> _occluders{};
+
+    I3D_pvs* _pvs{ nullptr };
+    ea::vector<uint32_t> _pvsRows{};    // per sector, its row in _pvs
+
+    ea::hash_map<I3D_frame*, I3D_sector*> _tracked{};  // frame -> current sector
+};
\ No newline at end of file
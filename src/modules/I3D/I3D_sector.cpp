@@ -1,7 +1,63 @@
 #include "I3D_sector.h"
+#include "I3D_scene.h"
 
 I3D_sector::I3D_sector(I3D_driver* driver) : 
     I3D_frame(driver)
 {
     _type = FRAME_SECTOR;
+}
+
+void I3D_sector::setBBox(const I3D_bbox& bbox) {
+    getTransforms().setLocalBBox(_xform, bbox);
+    if(_scene) _scene->invalidateSectors();
+}
+
+const I3D_bbox& I3D_sector::getBBox() const {
+    return getTransforms().getLocalBBox(_xform);
+}
+
+void I3D_sector::setHull(ea::vector<glm::vec3> vertices, ea::vector<uint16_t> indices) {
+    _hullVertices = ea::move(vertices);
+    _hullIndices = ea::move(indices);
+    if(_scene) _scene->invalidateSectors();
+}
+
+//----------------------------
+// Hulls needn't be convex, so a ray from the point counts crossings of the hull - an odd count
+// is inside. The ray is slightly skewed so it doesn't run along edges of axis-aligned walls.
+bool I3D_sector::contains(const glm::vec3& pos) {
+    const I3D_bbox& bbox = getWorldBBox();
+    if(bbox.IsValid() && (glm::any(glm::lessThan(pos, bbox.min)) || glm::any(glm::greaterThan(pos, bbox.max)))) return false;
+    if(_hullIndices.empty()) return bbox.IsValid();
+
+    const glm::vec3 origin = glm::vec3(glm::affineInverse(getMatrix()) * glm::vec4(pos, 1.0f));
+    const glm::vec3 dir(1.0f, 0.0013f, 0.0021f);
+
+    uint32_t numCrossings = 0;
+    for(size_t i = 0; i + 2 < _hullIndices.size(); i += 3) {
+        // Moller-Trumbore
+        const glm::vec3& v0 = _hullVertices[_hullIndices[i]];
+        const glm::vec3 edge1 = _hullVertices[_hullIndices[i + 1]] - v0;
+        const glm::vec3 edge2 = _hullVertices[_hullIndices[i + 2]] - v0;
+        const glm::vec3 p = glm::cross(dir, edge2);
+        const float det = glm::dot(edge1, p);
+        if(glm::abs(det) < 1e-12f) continue;
+
+        const float invDet = 1.0f / det;
+        const glm::vec3 t = origin - v0;
+        const float u = glm::dot(t, p) * invDet;
+        if(u < 0.0f || u > 1.0f) continue;
+
+        const glm::vec3 q = glm::cross(t, edge1);
+        const float v = glm::dot(dir, q) * invDet;
+        if(v < 0.0f || u + v > 1.0f) continue;
+
+        numCrossings += glm::dot(edge2, q) * invDet > 0.0f;
+    }
+    return numCrossings & 1;
+}
+
+void I3D_sector::addPortal(I3D_portal portal) {
+    _portals.push_back(ea::move(portal));
+    if(_scene) _scene->invalidateSectors();
 }
\ No newline at end of file
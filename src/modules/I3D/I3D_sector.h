@@ -1,10 +1,45 @@
 #pragma once
 #include "I3D_frame.h"
 
+#include <EASTL/vector.h>
+namespace ea = eastl;
+
+//----------------------------
+// Convex polygon through which the inside of a sector can be seen, in sector's local space.
+// It joins the sector with the one it's linked under (the primary sector at the top), the
+// view passes both ways unless the portal is closed, e.g. by a door.
+struct I3D_portal {
+    ea::vector<glm::vec3> vertices{};
+    uint32_t flags{};
+    bool open{ true };
+};
+
 class I3D_sector : public I3D_frame {
 public:
     I3D_sector(I3D_driver* driver);
+
+    void setBBox(const I3D_bbox& bbox);
+    const I3D_bbox& getBBox() const;
+
+    // closed hull enclosing the sector, 3 indices per triangle
+    void setHull(ea::vector<glm::vec3> vertices, ea::vector<uint16_t> indices);
+    const ea::vector<glm::vec3>& getHullVertices() const { return _hullVertices; }
+    const ea::vector<uint16_t>& getHullIndices() const { return _hullIndices; }
+
+    // whether a world position is inside the hull, or the bounds for a sector without one
+    bool contains(const glm::vec3& pos);
+
+    void addPortal(I3D_portal portal);
+    const ea::vector<I3D_portal>& getPortals() const { return _portals; }
+    void setPortalOpen(uint32_t index, bool open) { _portals[index].open = open; }
 private:
+    friend class I3D_scene;
+
+    ea::vector<glm::vec3> _hullVertices{};
+    ea::vector<uint16_t> _hullIndices{};
+    ea::vector<I3D_portal> _portals{};
+    uint32_t _sceneIndex{};     // in the scene's sectors
+    uint32_t _depth{};          // sectors above this one
 };
 
 //----------------------------
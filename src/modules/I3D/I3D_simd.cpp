@@ -0,0 +1,333 @@
+#include "I3D_simd.h"
+#include "I3D_transform.h"
+
+#include <cstddef>
+#include <EASTL/algorithm.h>
+
+#if I3D_SIMD_X86 && defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+static uint32_t detectCPUFeatures() {
+    uint32_t features = 0;
+#if I3D_SIMD_X86
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    const int numIds = info[0];
+
+    __cpuid(info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    const bool fma = (info[2] & (1 << 12)) != 0;
+    if(info[3] & (1 << 26)) features |= CPUF_SSE2;
+    if(info[2] & (1 << 19)) features |= CPUF_SSE41;
+
+    if(numIds >= 7 && osxsave && avx && fma && (_xgetbv(0) & 6) == 6) {
+        __cpuidex(info, 7, 0);
+        if(info[1] & (1 << 5)) features |= CPUF_AVX2;
+    }
+#else
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("sse2")) features |= CPUF_SSE2;
+    if(__builtin_cpu_supports("sse4.1")) features |= CPUF_SSE41;
+    if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) features |= CPUF_AVX2;
+#endif
+#endif
+    return features;
+}
+
+uint32_t I3D_GetCPUFeatures() {
+    static const uint32_t features = detectCPUFeatures();
+    return features;
+}
+
+//----------------------------
+// scalar
+
+static inline void composeOne(glm::mat4& m, const glm::vec3& p, const glm::quat& q, const glm::vec3& s) {
+    const float x2 = q.x + q.x, y2 = q.y + q.y, z2 = q.z + q.z;
+    const float xx = q.x * x2, yy = q.y * y2, zz = q.z * z2;
+    const float xy = q.x * y2, xz = q.x * z2, yz = q.y * z2;
+    const float wx = q.w * x2, wy = q.w * y2, wz = q.w * z2;
+
+    m[0] = glm::vec4((1.0f - (yy + zz)) * s.x, (xy + wz) * s.x, (xz - wy) * s.x, 0.0f);
+    m[1] = glm::vec4((xy - wz) * s.y, (1.0f - (xx + zz)) * s.y, (yz + wx) * s.y, 0.0f);
+    m[2] = glm::vec4((xz + wy) * s.z, (yz - wx) * s.z, (1.0f - (xx + yy)) * s.z, 0.0f);
+    m[3] = glm::vec4(p, 1.0f);
+}
+
+static void composeTRS_scalar(glm::mat4* out, const glm::vec3* pos, const glm::quat* rot, const glm::vec3* scale, const uint32_t* slots, uint32_t count) {
+    for(uint32_t i = 0; i < count; ++i) {
+        const uint32_t s = slots[i];
+        composeOne(out[s], pos[s], rot[s], scale[s]);
+    }
+}
+
+static void mulAffine_scalar(glm::mat4& out, const glm::mat4& a, const glm::mat4& b) {
+    glm::mat4 r;
+    r[0] = a[0] * b[0].x + a[1] * b[0].y + a[2] * b[0].z;
+    r[1] = a[0] * b[1].x + a[1] * b[1].y + a[2] * b[1].z;
+    r[2] = a[0] * b[2].x + a[1] * b[2].y + a[2] * b[2].z;
+    r[3] = a[0] * b[3].x + a[1] * b[3].y + a[2] * b[3].z + a[3];
+    out = r;
+}
+
+static void concatAffine_scalar(glm::mat4* world, const glm::mat4* local, const uint32_t* parents, const uint32_t* slots, uint32_t count) {
+    for(uint32_t i = 0; i < count; ++i) {
+        const uint32_t s = slots[i];
+        if(parents[s] != I3D_XFORM_NONE)
+            mulAffine_scalar(world[s], world[parents[s]], local[s]);
+        else
+            world[s] = local[s];
+    }
+}
+
+#if I3D_SIMD_X86
+
+// kernels load quaternions as 4 floats in glm's storage order
+static_assert(sizeof(glm::quat) == 4 * sizeof(float), "unexpected glm::quat layout");
+static_assert(offsetof(glm::quat, x) == sizeof(float), "kernels expect glm::quat stored as w, x, y, z");
+
+//----------------------------
+// SSE2 - 4 transforms per compose step, one column per register in multiply
+
+#define I3D_SPLAT(v, i) _mm_shuffle_ps(v, v, _MM_SHUFFLE(i, i, i, i))
+
+I3D_TARGET_SSE2
+static inline void compose4_sse2(glm::mat4* out, const glm::vec3* pos, const glm::quat* rot, const glm::vec3* scale, const uint32_t* slots) {
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 zero = _mm_setzero_ps();
+    const uint32_t s0 = slots[0], s1 = slots[1], s2 = slots[2], s3 = slots[3];
+
+    __m128 w = _mm_loadu_ps(&rot[s0].w);
+    __m128 x = _mm_loadu_ps(&rot[s1].w);
+    __m128 y = _mm_loadu_ps(&rot[s2].w);
+    __m128 z = _mm_loadu_ps(&rot[s3].w);
+    _MM_TRANSPOSE4_PS(w, x, y, z);
+
+    const __m128 sx = _mm_setr_ps(scale[s0].x, scale[s1].x, scale[s2].x, scale[s3].x);
+    const __m128 sy = _mm_setr_ps(scale[s0].y, scale[s1].y, scale[s2].y, scale[s3].y);
+    const __m128 sz = _mm_setr_ps(scale[s0].z, scale[s1].z, scale[s2].z, scale[s3].z);
+
+    const __m128 x2 = _mm_add_ps(x, x), y2 = _mm_add_ps(y, y), z2 = _mm_add_ps(z, z);
+    const __m128 xx = _mm_mul_ps(x, x2), yy = _mm_mul_ps(y, y2), zz = _mm_mul_ps(z, z2);
+    const __m128 xy = _mm_mul_ps(x, y2), xz = _mm_mul_ps(x, z2), yz = _mm_mul_ps(y, z2);
+    const __m128 wx = _mm_mul_ps(w, x2), wy = _mm_mul_ps(w, y2), wz = _mm_mul_ps(w, z2);
+
+    // rows of the 4 matrices' columns, lane = matrix
+    __m128 c00 = _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(yy, zz)), sx);
+    __m128 c01 = _mm_mul_ps(_mm_add_ps(xy, wz), sx);
+    __m128 c02 = _mm_mul_ps(_mm_sub_ps(xz, wy), sx);
+    __m128 c03 = zero;
+    __m128 c10 = _mm_mul_ps(_mm_sub_ps(xy, wz), sy);
+    __m128 c11 = _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, zz)), sy);
+    __m128 c12 = _mm_mul_ps(_mm_add_ps(yz, wx), sy);
+    __m128 c13 = zero;
+    __m128 c20 = _mm_mul_ps(_mm_add_ps(xz, wy), sz);
+    __m128 c21 = _mm_mul_ps(_mm_sub_ps(yz, wx), sz);
+    __m128 c22 = _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, yy)), sz);
+    __m128 c23 = zero;
+
+    _MM_TRANSPOSE4_PS(c00, c01, c02, c03);
+    _MM_TRANSPOSE4_PS(c10, c11, c12, c13);
+    _MM_TRANSPOSE4_PS(c20, c21, c22, c23);
+
+    const __m128 cols[4][3] = { { c00, c10, c20 }, { c01, c11, c21 }, { c02, c12, c22 }, { c03, c13, c23 } };
+    const uint32_t dst[4] = { s0, s1, s2, s3 };
+    for(int k = 0; k < 4; ++k) {
+        float* m = &out[dst[k]][0][0];
+        _mm_storeu_ps(m + 0, cols[k][0]);
+        _mm_storeu_ps(m + 4, cols[k][1]);
+        _mm_storeu_ps(m + 8, cols[k][2]);
+        out[dst[k]][3] = glm::vec4(pos[dst[k]], 1.0f);
+    }
+}
+
+I3D_TARGET_SSE2
+static void composeTRS_sse2(glm::mat4* out, const glm::vec3* pos, const glm::quat* rot, const glm::vec3* scale, const uint32_t* slots, uint32_t count) {
+    uint32_t i = 0;
+    for(; i + 4 <= count; i += 4)
+        compose4_sse2(out, pos, rot, scale, slots + i);
+
+    // tail is padded with the last slot, so every transform gets the same rounding wherever it lands
+    if(i < count) {
+        uint32_t tail[4];
+        for(uint32_t k = 0; k < 4; ++k) tail[k] = slots[ea::min(i + k, count - 1)];
+        compose4_sse2(out, pos, rot, scale, tail);
+    }
+}
+
+I3D_TARGET_SSE2
+static inline void mulAffineOne_sse2(float* out, const float* a, const float* b) {
+    const __m128 a0 = _mm_loadu_ps(a + 0);
+    const __m128 a1 = _mm_loadu_ps(a + 4);
+    const __m128 a2 = _mm_loadu_ps(a + 8);
+    const __m128 a3 = _mm_loadu_ps(a + 12);
+
+    __m128 r[4];
+    for(int j = 0; j < 4; ++j) {
+        const __m128 bj = _mm_loadu_ps(b + j * 4);
+        r[j] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a0, I3D_SPLAT(bj, 0)), _mm_mul_ps(a1, I3D_SPLAT(bj, 1))), _mm_mul_ps(a2, I3D_SPLAT(bj, 2)));
+    }
+    r[3] = _mm_add_ps(r[3], a3);
+
+    _mm_storeu_ps(out + 0, r[0]);
+    _mm_storeu_ps(out + 4, r[1]);
+    _mm_storeu_ps(out + 8, r[2]);
+    _mm_storeu_ps(out + 12, r[3]);
+}
+
+I3D_TARGET_SSE2
+static void mulAffine_sse2(glm::mat4& out, const glm::mat4& a, const glm::mat4& b) {
+    mulAffineOne_sse2(&out[0][0], &a[0][0], &b[0][0]);
+}
+
+I3D_TARGET_SSE2
+static void concatAffine_sse2(glm::mat4* world, const glm::mat4* local, const uint32_t* parents, const uint32_t* slots, uint32_t count) {
+    for(uint32_t i = 0; i < count; ++i) {
+        const uint32_t s = slots[i];
+        if(parents[s] != I3D_XFORM_NONE)
+            mulAffineOne_sse2(&world[s][0][0], &world[parents[s]][0][0], &local[s][0][0]);
+        else
+            world[s] = local[s];
+    }
+}
+
+//----------------------------
+// AVX2 + FMA - 8 transforms per compose step, two columns per register in multiply
+
+I3D_TARGET_AVX2
+static inline __m256 load8(const glm::quat* rot, const uint32_t* s, int c) {
+    return _mm256_setr_ps((&rot[s[0]].w)[c], (&rot[s[1]].w)[c], (&rot[s[2]].w)[c], (&rot[s[3]].w)[c],
+                          (&rot[s[4]].w)[c], (&rot[s[5]].w)[c], (&rot[s[6]].w)[c], (&rot[s[7]].w)[c]);
+}
+
+I3D_TARGET_AVX2
+static inline __m256 load8(const glm::vec3* v, const uint32_t* s, int c) {
+    return _mm256_setr_ps(v[s[0]][c], v[s[1]][c], v[s[2]][c], v[s[3]][c],
+                          v[s[4]][c], v[s[5]][c], v[s[6]][c], v[s[7]][c]);
+}
+
+I3D_TARGET_AVX2
+static inline void compose8_avx2(glm::mat4* out, const glm::vec3* pos, const glm::quat* rot, const glm::vec3* scale, const uint32_t* s) {
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 w = load8(rot, s, 0), x = load8(rot, s, 1), y = load8(rot, s, 2), z = load8(rot, s, 3);
+    const __m256 sx = load8(scale, s, 0), sy = load8(scale, s, 1), sz = load8(scale, s, 2);
+
+    const __m256 x2 = _mm256_add_ps(x, x), y2 = _mm256_add_ps(y, y), z2 = _mm256_add_ps(z, z);
+    const __m256 xx = _mm256_mul_ps(x, x2), yy = _mm256_mul_ps(y, y2), zz = _mm256_mul_ps(z, z2);
+    const __m256 xy = _mm256_mul_ps(x, y2), xz = _mm256_mul_ps(x, z2), yz = _mm256_mul_ps(y, z2);
+
+    // lane = matrix, c<col><row>
+    __m256 c[3][3];
+    c[0][0] = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(yy, zz)), sx);
+    c[0][1] = _mm256_mul_ps(_mm256_fmadd_ps(w, z2, xy), sx);
+    c[0][2] = _mm256_mul_ps(_mm256_fnmadd_ps(w, y2, xz), sx);
+    c[1][0] = _mm256_mul_ps(_mm256_fnmadd_ps(w, z2, xy), sy);
+    c[1][1] = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(xx, zz)), sy);
+    c[1][2] = _mm256_mul_ps(_mm256_fmadd_ps(w, x2, yz), sy);
+    c[2][0] = _mm256_mul_ps(_mm256_fmadd_ps(w, y2, xz), sz);
+    c[2][1] = _mm256_mul_ps(_mm256_fnmadd_ps(w, x2, yz), sz);
+    c[2][2] = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(xx, yy)), sz);
+
+    // transpose per 128-bit half: lanes 0-3, then 4-7
+    for(int half = 0; half < 2; ++half) {
+        __m128 cols[3][4];
+        for(int col = 0; col < 3; ++col) {
+            __m128 r0 = half ? _mm256_extractf128_ps(c[col][0], 1) : _mm256_castps256_ps128(c[col][0]);
+            __m128 r1 = half ? _mm256_extractf128_ps(c[col][1], 1) : _mm256_castps256_ps128(c[col][1]);
+            __m128 r2 = half ? _mm256_extractf128_ps(c[col][2], 1) : _mm256_castps256_ps128(c[col][2]);
+            __m128 r3 = _mm_setzero_ps();
+            _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+            cols[col][0] = r0;
+            cols[col][1] = r1;
+            cols[col][2] = r2;
+            cols[col][3] = r3;
+        }
+
+        for(int k = 0; k < 4; ++k) {
+            const uint32_t dst = s[half * 4 + k];
+            float* m = &out[dst][0][0];
+            _mm_storeu_ps(m + 0, cols[0][k]);
+            _mm_storeu_ps(m + 4, cols[1][k]);
+            _mm_storeu_ps(m + 8, cols[2][k]);
+            out[dst][3] = glm::vec4(pos[dst], 1.0f);
+        }
+    }
+}
+
+I3D_TARGET_AVX2
+static void composeTRS_avx2(glm::mat4* out, const glm::vec3* pos, const glm::quat* rot, const glm::vec3* scale, const uint32_t* slots, uint32_t count) {
+    uint32_t i = 0;
+    for(; i + 8 <= count; i += 8)
+        compose8_avx2(out, pos, rot, scale, slots + i);
+
+    if(i < count) {
+        uint32_t tail[8];
+        for(uint32_t k = 0; k < 8; ++k) tail[k] = slots[ea::min(i + k, count - 1)];
+        compose8_avx2(out, pos, rot, scale, tail);
+    }
+}
+
+I3D_TARGET_AVX2
+static inline void mulAffineOne_avx2(float* out, const float* a, const float* b) {
+    const __m256 a0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 0));
+    const __m256 a1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 4));
+    const __m256 a2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 8));
+    const __m256 a3 = _mm256_insertf128_ps(_mm256_setzero_ps(), _mm_loadu_ps(a + 12), 1);
+
+    // columns 0,1 and 2,3 of b side by side
+    const __m256 b01 = _mm256_loadu_ps(b + 0);
+    const __m256 b23 = _mm256_loadu_ps(b + 8);
+
+    __m256 r01 = _mm256_mul_ps(a0, _mm256_permute_ps(b01, 0x00));
+    r01 = _mm256_fmadd_ps(a1, _mm256_permute_ps(b01, 0x55), r01);
+    r01 = _mm256_fmadd_ps(a2, _mm256_permute_ps(b01, 0xaa), r01);
+
+    __m256 r23 = _mm256_fmadd_ps(a0, _mm256_permute_ps(b23, 0x00), a3);
+    r23 = _mm256_fmadd_ps(a1, _mm256_permute_ps(b23, 0x55), r23);
+    r23 = _mm256_fmadd_ps(a2, _mm256_permute_ps(b23, 0xaa), r23);
+
+    _mm256_storeu_ps(out + 0, r01);
+    _mm256_storeu_ps(out + 8, r23);
+}
+
+I3D_TARGET_AVX2
+static void mulAffine_avx2(glm::mat4& out, const glm::mat4& a, const glm::mat4& b) {
+    mulAffineOne_avx2(&out[0][0], &a[0][0], &b[0][0]);
+}
+
+I3D_TARGET_AVX2
+static void concatAffine_avx2(glm::mat4* world, const glm::mat4* local, const uint32_t* parents, const uint32_t* slots, uint32_t count) {
+    for(uint32_t i = 0; i < count; ++i) {
+        const uint32_t s = slots[i];
+        if(parents[s] != I3D_XFORM_NONE)
+            mulAffineOne_avx2(&world[s][0][0], &world[parents[s]][0][0], &local[s][0][0]);
+        else
+            world[s] = local[s];
+    }
+}
+
+#endif
+
+//----------------------------
+
+static const I3D_xform_kernels kernelsScalar = { "scalar", composeTRS_scalar, mulAffine_scalar, concatAffine_scalar };
+#if I3D_SIMD_X86
+static const I3D_xform_kernels kernelsSSE2 = { "sse2", composeTRS_sse2, mulAffine_sse2, concatAffine_sse2 };
+static const I3D_xform_kernels kernelsAVX2 = { "avx2", composeTRS_avx2, mulAffine_avx2, concatAffine_avx2 };
+#endif
+
+const I3D_xform_kernels& I3D_GetXformKernels(uint32_t features) {
+#if I3D_SIMD_X86
+    if(features & CPUF_AVX2) return kernelsAVX2;
+    if(features & CPUF_SSE2) return kernelsSSE2;
+#endif
+    return kernelsScalar;
+}
+
+const I3D_xform_kernels& I3D_GetXformKernels() {
+    static const I3D_xform_kernels& kernels = I3D_GetXformKernels(I3D_GetCPUFeatures());
+    return kernels;
+}
\ No newline at end of file
@@ -0,0 +1,55 @@
+#pragma once
+#include "I3D.h"
+
+#include <cstdint>
+#include <glm/ext.hpp>
+
+//----------------------------
+// x86 SIMD support - kernels are compiled per instruction set via function target attributes
+// (no global compiler flags needed) and picked at runtime from the detected CPU features.
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define I3D_SIMD_X86 1
+    #include <immintrin.h>
+    #if defined(_MSC_VER) && !defined(__clang__)
+        #define I3D_TARGET_SSE2
+        #define I3D_TARGET_SSE41
+        #define I3D_TARGET_AVX2
+    #else
+        #define I3D_TARGET_SSE2 __attribute__((target("sse2")))
+        #define I3D_TARGET_SSE41 __attribute__((target("sse4.1")))
+        #define I3D_TARGET_AVX2 __attribute__((target("avx2,fma")))
+    #endif
+#else
+    #define I3D_SIMD_X86 0
+#endif
+
+enum I3D_CPU_FEATURES : uint32_t {
+    CPUF_SSE2   = (1 << 0),
+    CPUF_SSE41  = (1 << 1),
+    CPUF_AVX2   = (1 << 2), // reported only together with FMA
+};
+
+uint32_t I3D_GetCPUFeatures();
+
+//----------------------------
+// Transform kernels. All matrices are affine (last row 0,0,0,1), which is what frame
+// hierarchies produce; the projective part is not computed.
+struct I3D_xform_kernels {
+    const char* name;
+
+    // out[s] = transl(pos[s]) * rot[s] * scale(scale[s]) for every s in slots
+    void (*composeTRS)(glm::mat4* out, const glm::vec3* pos, const glm::quat* rot, const glm::vec3* scale, const uint32_t* slots, uint32_t count);
+
+    // out = a * b
+    void (*mulAffine)(glm::mat4& out, const glm::mat4& a, const glm::mat4& b);
+
+    // world[s] = world[parents[s]] * local[s] (or local[s] for roots) for every s in slots, in order,
+    // so a parent listed earlier is already resolved when its children are processed
+    void (*concatAffine)(glm::mat4* world, const glm::mat4* local, const uint32_t* parents, const uint32_t* slots, uint32_t count);
+};
+
+// kernels for the best instruction set of this CPU
+const I3D_xform_kernels& I3D_GetXformKernels();
+
+// kernels for a given feature mask (CPUF_*), e.g. to compare implementations
+const I3D_xform_kernels& I3D_GetXformKernels(uint32_t features);
\ No newline at end of file
@@ -7,52 +7,123 @@ I3D_texture_base::I3D_texture_base(I3D_driver* driver) :
 }
 
 // --- I3D_texture
+static PixelFormat pixelFormat(I3D_TEXTURE_FORMAT format) {
+    switch(format) {
+        case TXTFMT_BC1: return SG_PIXELFORMAT_BC1_RGBA;
+        case TXTFMT_BC3: return SG_PIXELFORMAT_BC3_RGBA;
+        default: return SG_PIXELFORMAT_RGBA8;
+    }
+}
+
 I3D_texture::I3D_texture(I3D_driver* driver) : 
     I3D_texture_base(driver) {
 }
 
-const ea::string& I3D_texture::getFileName(int i) {
+I3D_texture::~I3D_texture() {
+    if(_loading) _driver->getTextureLoader().cancel(this);
+    if(isLoaded() && _driver->getDevice())
+        _driver->getDevice()->destroyImage(_textureHandle);
+}
+
+bool I3D_texture::open(const I3D_CREATETEXTURE& params) {
+    if(_loading) _driver->getTextureLoader().cancel(this);
+
+    _filenames[0] = params._diffuse;
+    _filenames[1] = params._op;
+    _flags = params._flags;
+    _loading = _driver->getTextureLoader().request(this, params);
+    return _loading;
+}
+
+bool I3D_texture::create(const I3D_CREATETEXTURE& params, const void* pixels) {
+    IDevice* device = _driver->getDevice();
+    if(!device || !pixels || !params._numLevels || params._format >= TXTFMT_LAST) return false;
+
+    if(isLoaded()) device->destroyImage(_textureHandle);
+    _unloaded = false;
+
+    ImageDesc desc{};
+    desc.width = int(params._width);
+    desc.height = int(params._height);
+    desc.pixel_format = pixelFormat(params._format);
+
+    // levels past what the device takes are left out, the smallest ones
+    desc.num_mipmaps = int(glm::min(params._numLevels, uint32_t(SG_MAX_MIPMAPS)));
+    const uint8_t* level = static_cast<const uint8_t*>(pixels);
+    for(int i = 0; i < desc.num_mipmaps; ++i) {
+        const size_t size = I3D_GetTextureSize(params._format, glm::max(params._width >> i, 1u), glm::max(params._height >> i, 1u));
+        desc.data.subimage[0][i] = sg_range{ level, size };
+        level += size;
+    }
+    if(desc.num_mipmaps > 1) {
+        desc.min_filter = SG_FILTER_LINEAR_MIPMAP_LINEAR;
+        desc.mag_filter = SG_FILTER_LINEAR;
+    }
+    _textureHandle = device->createImage(desc);
+    if(_textureHandle.id == SG_INVALID_ID) return false;
+
+    _filenames[0] = params._diffuse;
+    _filenames[1] = params._op;
+    _width = params._width;
+    _height = params._height;
+    _numLevels = uint32_t(desc.num_mipmaps);
+    _format = params._format;
+    _flags = params._flags;
+    return true;
+}
+
+const I3D_name& I3D_texture::getFileName(int i) {
     assert(i > -1 && i < 2);
     return _filenames[i];
 }
 
+void I3D_texture::unload() {
+    if(!isLoaded()) return;
+
+    _driver->getDevice()->destroyImage(_textureHandle);
+    _textureHandle = {};
+    _unloaded = true;
+}
+
 const Image I3D_texture::getTextureHandle() {
-    return _textureHandle;
+    _lastUsed = _driver->getTickCount();
+    if(isLoaded()) return _textureHandle;
+
+    if(_unloaded && !_loading) {
+        I3D_CREATETEXTURE params{};
+        params._flags = _flags;
+        params._diffuse = _filenames[0];
+        params._op = _filenames[1];
+        _unloaded = !open(params);
+    }
+    return _driver->getTextureLoader().getPlaceholder();
 }
 
 // --- I3D_animated_texture
 I3D_animated_texture::I3D_animated_texture(I3D_driver* driver) :
     I3D_texture_base(driver) {
+    _slot = _driver->getTextureAnimator().add(0, 0);
+}
+
+I3D_animated_texture::~I3D_animated_texture() {
+    _driver->getTextureAnimator().remove(_slot);
 }
 
 void I3D_animated_texture::setTextures(ea::vector<ea::shared_ptr<I3D_texture>> textures) {
     _textures = std::move(textures);
+    _driver->getTextureAnimator().setNumFrames(_slot, uint32_t(_textures.size()));
 }
 
 void I3D_animated_texture::setAnimSpeed(uint32_t delay) {
-    _delay = delay;
+    _driver->getTextureAnimator().setDelay(_slot, delay);
 }
 
-const ea::string& I3D_animated_texture::getFileName(int i) {
-    static ea::string _e = "";
+const I3D_name& I3D_animated_texture::getFileName(int i) {
+    static const I3D_name _e{};
     return _textures.empty() ? _e : _textures.front()->getFileName(i);
 }
 
 const Image I3D_animated_texture::getTextureHandle() {
     if(_textures.empty()) return {};
-
-    uint32_t currentRenderTime = _driver->getRenderTime();
-    if(_lastRenderTime != currentRenderTime) {
-        uint32_t delta = currentRenderTime - _lastRenderTime;
-        _animCnt += delta;
-
-        while(_animCnt >= _delay) {
-            _animCnt -= _delay;
-            ++_currentFrameIdx %= _textures.size();
-        }
-
-        _lastRenderTime = currentRenderTime;
-    }
-
-    return _textures[_currentFrameIdx]->getTextureHandle();
+    return _textures[_driver->getTextureAnimator().getFrame(_slot)]->getTextureHandle();
 }
\ No newline at end of file
@@ -8,6 +8,10 @@
 namespace ea = eastl;
 
 #include "IDevice.h"
+#include "I3D_name.h"
+#include "I3D_mipmap.h"
+#include "I3D_texture_compress.h"
+#include "I3D_texture_animator.h"
 
 enum I3D_TEXTURE_FLAGS {
     TXTFLAGS_DIFFUSE = (1 << 1),  
@@ -22,22 +26,31 @@ struct I3D_CREATETEXTURE {
     uint32_t _flags{};
     uint32_t _width{};
     uint32_t _height{};
-    ea::string _diffuse{};
-    ea::string _op{};
+    uint32_t _numLevels{ 1 };
+    I3D_TEXTURE_FORMAT _format{ TXTFMT_RGBA8 };
+    I3D_name _diffuse{};
+    I3D_name _op{};
 };
 
+// mip filtering of a texture: maps are sRGB colors, with an opacity map they are alpha tested
+inline uint32_t I3D_GetMipmapFlags(const I3D_CREATETEXTURE& params) {
+    return MIPMAP_SRGB | ((params._flags & TXTMAP_OPACITY) ? MIPMAP_ALPHA_COVERAGE : 0);
+}
+
 //----------------------------
 
 class I3D_texture_base {
 public:
     I3D_texture_base(I3D_driver* driver);
+    virtual ~I3D_texture_base() {}
+
     const uint32_t getWidth() const { return _width; }
     const uint32_t getHeight() const { return _height; }
     
     void setFlags(uint32_t flags) { _flags = flags; }
     uint32_t getFlags() const { return _flags; }
 
-    virtual const ea::string& getFileName(int i = 0) = 0;
+    virtual const I3D_name& getFileName(int i = 0) = 0;
     virtual const Image getTextureHandle() = 0;
 protected:
     I3D_driver* _driver{ nullptr };
@@ -49,27 +62,72 @@ protected:
 class I3D_texture : public I3D_texture_base {
 public:
     I3D_texture(I3D_driver* driver);
-    const ea::string& getFileName(int i = 0) override;
+    ~I3D_texture();
+    const I3D_name& getFileName(int i = 0) override;
     const Image getTextureHandle() override;
 
+    //----------------------------
+    // Start loading params._diffuse in the background, see I3D_texture_loader. The texture is usable
+    // right away - it shows the placeholder image until the file is loaded, or if it can't be.
     bool open(const I3D_CREATETEXTURE& params);
+    bool isLoading() const { return _loading; }
+
+    // create from decoded pixels of params._width x params._height in params._format, followed
+    // by the rest of the mip chain if params._numLevels > 1 (see I3D_mipmap.h); must be called on
+    // the render thread
+    bool create(const I3D_CREATETEXTURE& params, const void* pixels);
+
+    //----------------------------
+    // Drop the device image to free memory, the file is streamed in again when the texture
+    // is rendered next time.
+    void unload();
+
+    // Pinned textures are never unloaded by the cache - for textures created from pixels that have
+    // no file to stream them in again from, like atlas pages.
+    void setPinned(bool pinned) { _pinned = pinned; }
+    bool isPinned() const { return _pinned; }
+
+    bool isLoaded() const { return _textureHandle.id != SG_INVALID_ID; }
+
+    // device memory of the image
+    size_t getMemorySize() const { return isLoaded() ? I3D_GetTextureSize(_format, _width, _height, _numLevels) : 0; }
+    uint32_t getNumLevels() const { return _numLevels; }
+    I3D_TEXTURE_FORMAT getFormat() const { return _format; }
+
+    // driver tick the texture was last rendered in
+    uint32_t getLastUsed() const { return _lastUsed; }
 private:
-    ea::string _filenames[2];
+    friend class I3D_texture_loader;
+
+    I3D_name _filenames[2];
     Image _textureHandle{};
+    uint32_t _lastUsed{};
+    uint32_t _numLevels{ 1 };
+    I3D_TEXTURE_FORMAT _format{ TXTFMT_RGBA8 };
+    bool _loading{ false };
+    bool _unloaded{ false };
+    bool _pinned{ false };
 };
 
+//----------------------------
+// Textures shown in turn. The frame is advanced by the driver's I3D_texture_animator on tick,
+// rendering only looks it up.
 class I3D_animated_texture : public I3D_texture_base {
 public:
     I3D_animated_texture(I3D_driver* driver);
+    ~I3D_animated_texture();
+
+    I3D_animated_texture(const I3D_animated_texture&) = delete;
+    I3D_animated_texture& operator=(const I3D_animated_texture&) = delete;
+
     void setTextures(ea::vector<ea::shared_ptr<I3D_texture>> textures);
+
+    // ms each frame is shown, 0 stops at the current frame
     void setAnimSpeed(uint32_t delay);
 
-    const ea::string& getFileName(int i = 0) override;
+    const I3D_name& getFileName(int i = 0) override;
     const Image getTextureHandle() override;
 private:
-    uint32_t _lastRenderTime{};
-    uint32_t _animCnt{};
-    uint32_t _currentFrameIdx{};
-    uint32_t _delay{}; // in ms
+    uint32_t _slot{ I3D_texture_animator::INVALID_SLOT };
     ea::vector<ea::shared_ptr<I3D_texture>> _textures{};
 };
\ No newline at end of file
@@ -0,0 +1,38 @@
+#include "I3D_texture_animator.h"
+
+uint32_t I3D_texture_animator::add(uint32_t numFrames, uint32_t delay) {
+    const Anim anim{ numFrames, delay, 0, 0 };
+    if(_freeSlots.empty()) {
+        _anims.push_back(anim);
+        return uint32_t(_anims.size() - 1);
+    }
+
+    const uint32_t slot = _freeSlots.back();
+    _freeSlots.pop_back();
+    _anims[slot] = anim;
+    return slot;
+}
+
+void I3D_texture_animator::remove(uint32_t slot) {
+    _anims[slot] = {};
+    _freeSlots.push_back(slot);
+}
+
+void I3D_texture_animator::setNumFrames(uint32_t slot, uint32_t numFrames) {
+    Anim& anim = _anims[slot];
+    anim.numFrames = numFrames;
+    if(anim.frame >= numFrames) anim.frame = 0;
+}
+
+// whole frames are skipped at once, so a long tick costs the same as a short one
+void I3D_texture_animator::tick(uint32_t elapsedMs) {
+    for(Anim& anim : _anims) {
+        if(!anim.delay || anim.numFrames < 2) continue;
+
+        anim.time += elapsedMs;
+        if(anim.time < anim.delay) continue;
+
+        anim.frame = uint32_t((anim.frame + uint64_t(anim.time / anim.delay)) % anim.numFrames);
+        anim.time %= anim.delay;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,42 @@
+#pragma once
+#include "I3D.h"
+
+#include <EASTL/vector.h>
+namespace ea = eastl;
+
+//----------------------------
+// Frames of all animated textures, advanced together once per driver tick by the time that
+// passed. Animations live in one array and are referred to by slot, so a tick is a single pass
+// and an animated texture only reads its current frame when it's rendered.
+class I3D_texture_animator {
+public:
+    static constexpr uint32_t INVALID_SLOT = ~0u;
+
+    I3D_texture_animator() {}
+
+    I3D_texture_animator(const I3D_texture_animator&) = delete;
+    I3D_texture_animator& operator=(const I3D_texture_animator&) = delete;
+
+    // new animation at frame 0, each frame shown for 'delay' ms; a delay of 0 holds the frame
+    uint32_t add(uint32_t numFrames, uint32_t delay);
+    void remove(uint32_t slot);
+
+    void setNumFrames(uint32_t slot, uint32_t numFrames);
+    void setDelay(uint32_t slot, uint32_t delay) { _anims[slot].delay = delay; }
+
+    // advance all animations, called by the driver every tick
+    void tick(uint32_t elapsedMs);
+
+    uint32_t getFrame(uint32_t slot) const { return _anims[slot].frame; }
+    uint32_t getNumAnimations() const { return uint32_t(_anims.size() - _freeSlots.size()); }
+private:
+    struct Anim {
+        uint32_t numFrames;     // 0 in free slots
+        uint32_t delay;
+        uint32_t time;          // ms spent in the current frame
+        uint32_t frame;
+    };
+
+    ea::vector<Anim> _anims{};
+    ea::vector<uint32_t> _freeSlots{};
+};
\ No newline at end of file
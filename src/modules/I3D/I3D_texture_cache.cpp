@@ -0,0 +1,99 @@
+#include "I3D_texture_cache.h"
+#include "I3D_driver.h"
+
+#include <EASTL/sort.h>
+
+I3D_texture_cache::I3D_texture_cache(I3D_driver* driver) :
+    _driver(driver) {
+}
+
+ea::shared_ptr<I3D_texture> I3D_texture_cache::get(const I3D_CREATETEXTURE& params) {
+    ea::shared_ptr<I3D_texture>& texture = _textures[makeKey(params)];
+    if(!texture) {
+        texture = ea::make_shared<I3D_texture>(_driver);
+        texture->open(params);
+    }
+    return texture;
+}
+
+ea::shared_ptr<I3D_texture> I3D_texture_cache::get(const I3D_CREATETEXTURE& params, const void* pixels) {
+    ea::shared_ptr<I3D_texture>& texture = _textures[makeKey(params)];
+    if(!texture) {
+        texture = ea::make_shared<I3D_texture>(_driver);
+        texture->create(params, pixels);
+    }
+    return texture;
+}
+
+ea::shared_ptr<I3D_texture> I3D_texture_cache::find(const I3D_CREATETEXTURE& params) const {
+    auto it = _textures.find(makeKey(params));
+    return it != _textures.end() ? it->second : nullptr;
+}
+
+//----------------------------
+
+void I3D_texture_cache::tick() {
+    size_t loadedBytes = 0;
+    for(const auto& it : _textures)
+        loadedBytes += it.second->getMemorySize();
+
+    _overBudget = false;
+    if(loadedBytes <= _budget) return;
+
+    // textures in use and pinned ones stay, even over budget
+    const uint32_t tick = _driver->getTickCount();
+    ea::vector<I3D_texture*> candidates;
+    for(const auto& it : _textures) {
+        if(it.second->isLoaded() && !it.second->isPinned() && tick - it.second->getLastUsed() >= _keepTicks)
+            candidates.push_back(it.second.get());
+    }
+
+    ea::sort(candidates.begin(), candidates.end(), [](const I3D_texture* a, const I3D_texture* b) {
+        return a->getLastUsed() < b->getLastUsed();
+    });
+
+    for(I3D_texture* texture : candidates) {
+        if(loadedBytes <= _budget) break;
+
+        loadedBytes -= texture->getMemorySize();
+        texture->unload();
+        ++_numEvicted;
+    }
+    _overBudget = loadedBytes > _budget;
+
+    // unloaded and unreferenced, nothing to keep; erase(it++) as EASTL iterators warn on assignment
+    for(auto it = _textures.begin(); it != _textures.end();) {
+        if(!it->second->isLoaded() && !it->second->isLoading() && it->second.use_count() == 1)
+            _textures.erase(it++);
+        else
+            ++it;
+    }
+}
+
+void I3D_texture_cache::trim() {
+    for(auto it = _textures.begin(); it != _textures.end();) {
+        if(it->second.use_count() == 1)
+            _textures.erase(it++);
+        else
+            ++it;
+    }
+}
+
+void I3D_texture_cache::clear() {
+    _textures.clear();
+}
+
+I3D_TEXTURE_CACHE_STATS I3D_texture_cache::getStats() const {
+    I3D_TEXTURE_CACHE_STATS stats{};
+    stats.numTextures = uint32_t(_textures.size());
+    stats.numEvicted = _numEvicted;
+    stats.budget = _budget;
+    stats.overBudget = _overBudget;
+    for(const auto& it : _textures) {
+        if(!it.second->isLoaded()) continue;
+
+        ++stats.numLoaded;
+        stats.loadedBytes += it.second->getMemorySize();
+    }
+    return stats;
+}
\ No newline at end of file
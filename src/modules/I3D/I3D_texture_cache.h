@@ -0,0 +1,80 @@
+#pragma once
+#include "I3D.h"
+#include "I3D_texture.h"
+
+#include <EASTL/shared_ptr.h>
+#include <EASTL/hash_map.h>
+namespace ea = eastl;
+
+//----------------------------
+// memory in bytes
+struct I3D_TEXTURE_CACHE_STATS {
+    uint32_t numTextures{};
+    uint32_t numLoaded{};
+    uint32_t numEvicted{};      // since the cache was created
+    size_t loadedBytes{};
+    size_t budget{};
+    bool overBudget{};          // the last tick() stopped over budget, all that's left is in use or pinned
+};
+
+//----------------------------
+// Textures shared by everyone using the same files - keyed by diffuse and opacity map names and
+// create flags. Device memory is kept under a budget: when it's exceeded, tick() unloads the least
+// recently rendered textures, those nobody references any more are dropped from the cache.
+// Unloaded textures stream in again when rendered. Textures in use - rendered within the last
+// few ticks - and pinned ones are never unloaded, the cache rather stays over budget than reloads
+// what's on screen.
+class I3D_texture_cache {
+public:
+    I3D_texture_cache(I3D_driver* driver);
+
+    I3D_texture_cache(const I3D_texture_cache&) = delete;
+    I3D_texture_cache& operator=(const I3D_texture_cache&) = delete;
+
+    // shared texture for params, a new one starts loading in the background
+    ea::shared_ptr<I3D_texture> get(const I3D_CREATETEXTURE& params);
+
+    // shared texture for params, a new one is created from decoded pixels (render thread)
+    ea::shared_ptr<I3D_texture> get(const I3D_CREATETEXTURE& params, const void* pixels);
+
+    // cached texture for params, or null
+    ea::shared_ptr<I3D_texture> find(const I3D_CREATETEXTURE& params) const;
+
+    void setBudget(size_t bytes) { _budget = bytes; }
+    size_t getBudget() const { return _budget; }
+
+    // Textures rendered in the last 'ticks' ticks are in use. The driver ticks before anything is
+    // drawn, so the default of 2 keeps those of the tick being drawn and of the previous one.
+    void setKeepTicks(uint32_t ticks) { _keepTicks = glm::max(ticks, 1u); }
+    uint32_t getKeepTicks() const { return _keepTicks; }
+
+    // evict over budget, called by the driver every tick
+    void tick();
+
+    // drop all textures not referenced outside of the cache
+    void trim();
+    void clear();
+
+    I3D_TEXTURE_CACHE_STATS getStats() const;
+private:
+    struct Key {
+        uint32_t diffuse;   // I3D_name ids
+        uint32_t op;
+        uint32_t flags;
+
+        bool operator==(const Key& other) const { return diffuse == other.diffuse && op == other.op && flags == other.flags; }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const { return (size_t(key.diffuse) * 31 + key.op) * 31 + key.flags; }
+    };
+
+    static Key makeKey(const I3D_CREATETEXTURE& params) { return Key{ params._diffuse.getId(), params._op.getId(), params._flags }; }
+
+    I3D_driver* _driver{ nullptr };
+    ea::hash_map<Key, ea::shared_ptr<I3D_texture>, KeyHash> _textures{};
+    size_t _budget{ size_t(512) * 1024 * 1024 };
+    uint32_t _keepTicks{ 2 };
+    uint32_t _numEvicted{};
+    bool _overBudget{ false };
+};
\ No newline at end of file
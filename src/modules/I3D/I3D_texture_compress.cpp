@@ -0,0 +1,387 @@
+#include "I3D_texture_compress.h"
+#include "I3D_simd.h"
+
+#include <cstring>
+#include <EASTL/utility.h>
+#include <EASTL/vector.h>
+namespace ea = eastl;
+
+static uint32_t blockSize(I3D_TEXTURE_FORMAT format) {
+    return format == TXTFMT_BC1 ? 8 : 16;
+}
+
+size_t I3D_GetTextureSize(I3D_TEXTURE_FORMAT format, uint32_t width, uint32_t height, uint32_t numLevels) {
+    size_t size = 0;
+    for(uint32_t level = 0; level < numLevels; ++level) {
+        if(format == TXTFMT_RGBA8)
+            size += size_t(width) * height * 4;
+        else
+            size += size_t((width + 3) / 4) * ((height + 3) / 4) * blockSize(format);
+        width = glm::max(width >> 1, 1u);
+        height = glm::max(height >> 1, 1u);
+    }
+    return size;
+}
+
+//----------------------------
+// Color endpoints. Kernels gather the bounding box of a block and how red and blue vary with green;
+// the box diagonal is flipped for a channel falling while green rises, then inset by 1/16 of the
+// extent, which pulls the ends towards the bulk of the colors. Indices are found by projecting
+// pixels on the line between the ends, against the midpoints of the 4 palette entries.
+
+struct ColorStats {
+    int lo[3];
+    int hi[3];
+    int covRG;
+    int covBG;
+};
+
+struct ColorFit {
+    uint16_t color0;
+    uint16_t color1;
+    int axis[3];
+    int steps[3];   // doubled projections halfway between palette entries, ascending
+};
+
+// index for the number of midpoints a pixel is past, going from color1 to color0
+static const uint32_t colorIndex[4] = { 1, 3, 2, 0 };
+
+static inline uint16_t to565(const int c[3]) {
+    return uint16_t((((c[0] * 31 + 127) / 255) << 11) | (((c[1] * 63 + 127) / 255) << 5) | ((c[2] * 31 + 127) / 255));
+}
+
+static inline void from565(uint16_t c, int out[3]) {
+    const int r = c >> 11, g = (c >> 5) & 63, b = c & 31;
+    out[0] = (r << 3) | (r >> 2);
+    out[1] = (g << 2) | (g >> 4);
+    out[2] = (b << 3) | (b >> 2);
+}
+
+static inline int dot(const int a[3], const int b[3]) {
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static ColorFit fitColors(ColorStats stats) {
+    if(stats.covRG < 0) ea::swap(stats.lo[0], stats.hi[0]);
+    if(stats.covBG < 0) ea::swap(stats.lo[2], stats.hi[2]);
+    for(int c = 0; c < 3; ++c) {
+        const int inset = (stats.hi[c] - stats.lo[c]) / 16;
+        stats.hi[c] -= inset;
+        stats.lo[c] += inset;
+    }
+
+    // color0 > color1 selects the 4 color mode
+    ColorFit fit{};
+    fit.color0 = to565(stats.hi);
+    fit.color1 = to565(stats.lo);
+    if(fit.color0 < fit.color1) ea::swap(fit.color0, fit.color1);
+
+    int palette[4][3];
+    from565(fit.color0, palette[0]);
+    from565(fit.color1, palette[1]);
+    for(int c = 0; c < 3; ++c) {
+        palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+        palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        fit.axis[c] = palette[0][c] - palette[1][c];
+    }
+
+    int d[4];
+    for(int i = 0; i < 4; ++i)
+        d[i] = dot(palette[i], fit.axis);
+    fit.steps[0] = d[1] + d[3];
+    fit.steps[1] = d[3] + d[2];
+    fit.steps[2] = d[2] + d[0];
+    return fit;
+}
+
+static inline void writeColorBlock(uint8_t* dst, const ColorFit& fit, uint32_t indices) {
+    // equal ends are the 3 color mode, where index 0 is still color0
+    if(fit.color0 == fit.color1) indices = 0;
+    memcpy(dst, &fit.color0, 2);
+    memcpy(dst + 2, &fit.color1, 2);
+    memcpy(dst + 4, &indices, 4);
+}
+
+// alpha ends are the exact range; index of a pixel from its position in it, in 7 steps
+static inline uint32_t alphaIndex(uint32_t steps) {
+    const uint32_t index = (8 - steps) & 7;
+    return index < 2 ? index ^ 1 : index;
+}
+
+static inline void writeAlphaBlock(uint8_t* dst, uint8_t alpha0, uint8_t alpha1, const uint32_t indices[16]) {
+    uint64_t bits = 0;
+    if(alpha0 != alpha1) {
+        for(int i = 0; i < 16; ++i)
+            bits |= uint64_t(indices[i]) << (3 * i);
+    }
+    dst[0] = alpha0;
+    dst[1] = alpha1;
+    for(int i = 0; i < 6; ++i)
+        dst[2 + i] = uint8_t(bits >> (8 * i));
+}
+
+//----------------------------
+
+static void encodeColor_scalar(uint8_t* dst, const uint32_t* block) {
+    ColorStats stats{ { 255, 255, 255 }, { 0, 0, 0 }, 0, 0 };
+    for(int i = 0; i < 16; ++i) {
+        for(int c = 0; c < 3; ++c) {
+            const int v = (block[i] >> (8 * c)) & 0xff;
+            stats.lo[c] = glm::min(stats.lo[c], v);
+            stats.hi[c] = glm::max(stats.hi[c], v);
+        }
+    }
+
+    int center[3];
+    for(int c = 0; c < 3; ++c)
+        center[c] = (stats.lo[c] + stats.hi[c]) >> 1;
+    for(int i = 0; i < 16; ++i) {
+        const int r = int(block[i] & 0xff) - center[0];
+        const int g = int((block[i] >> 8) & 0xff) - center[1];
+        const int b = int((block[i] >> 16) & 0xff) - center[2];
+        stats.covRG += r * g;
+        stats.covBG += b * g;
+    }
+
+    const ColorFit fit = fitColors(stats);
+    uint32_t indices = 0;
+    for(int i = 0; i < 16; ++i) {
+        const int color[3] = { int(block[i] & 0xff), int((block[i] >> 8) & 0xff), int((block[i] >> 16) & 0xff) };
+        const int projection = 2 * dot(color, fit.axis);
+        const uint32_t steps = (projection > fit.steps[0]) + (projection > fit.steps[1]) + (projection > fit.steps[2]);
+        indices |= colorIndex[steps] << (2 * i);
+    }
+    writeColorBlock(dst, fit, indices);
+}
+
+static void encodeAlpha_scalar(uint8_t* dst, const uint32_t* block) {
+    uint32_t lo = 255, hi = 0;
+    for(int i = 0; i < 16; ++i) {
+        lo = glm::min(lo, block[i] >> 24);
+        hi = glm::max(hi, block[i] >> 24);
+    }
+
+    const int range = int(hi - lo);
+    uint32_t indices[16];
+    for(int i = 0; i < 16; ++i) {
+        const int position = 14 * (int(block[i] >> 24) - int(lo));
+        uint32_t steps = 0;
+        for(int k = 1; k < 8; ++k)
+            steps += position >= (2 * k - 1) * range;
+        indices[i] = alphaIndex(steps);
+    }
+    writeAlphaBlock(dst, uint8_t(hi), uint8_t(lo), indices);
+}
+
+static void encodeBC1_scalar(uint8_t* dst, const uint32_t* blocks, uint32_t count) {
+    for(uint32_t i = 0; i < count; ++i)
+        encodeColor_scalar(dst + i * 8, blocks + i * 16);
+}
+
+static void encodeBC3_scalar(uint8_t* dst, const uint32_t* blocks, uint32_t count) {
+    for(uint32_t i = 0; i < count; ++i) {
+        encodeAlpha_scalar(dst + i * 16, blocks + i * 16);
+        encodeColor_scalar(dst + i * 16 + 8, blocks + i * 16);
+    }
+}
+
+#if I3D_SIMD_X86
+
+// spread 16 bits to the even bits of 32
+static inline uint32_t spreadBits(uint32_t x) {
+    x = (x | (x << 8)) & 0x00ff00ff;
+    x = (x | (x << 4)) & 0x0f0f0f0f;
+    x = (x | (x << 2)) & 0x33333333;
+    x = (x | (x << 1)) & 0x55555555;
+    return x;
+}
+
+// per-channel min / max of 4 pixels, in the low pixel
+I3D_TARGET_SSE2
+static inline void reduceMinMax_sse2(__m128i& lo, __m128i& hi) {
+    lo = _mm_min_epu8(lo, _mm_shuffle_epi32(lo, _MM_SHUFFLE(1, 0, 3, 2)));
+    lo = _mm_min_epu8(lo, _mm_shuffle_epi32(lo, _MM_SHUFFLE(2, 3, 0, 1)));
+    hi = _mm_max_epu8(hi, _mm_shuffle_epi32(hi, _MM_SHUFFLE(1, 0, 3, 2)));
+    hi = _mm_max_epu8(hi, _mm_shuffle_epi32(hi, _MM_SHUFFLE(2, 3, 0, 1)));
+}
+
+// pairs of 16-bit products of 4 pixels to one 32-bit sum per pixel
+I3D_TARGET_SSE2
+static inline __m128i sumPairs_sse2(__m128i a, __m128i b) {
+    const __m128 even = _mm_shuffle_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b), _MM_SHUFFLE(2, 0, 2, 0));
+    const __m128 odd = _mm_shuffle_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b), _MM_SHUFFLE(3, 1, 3, 1));
+    return _mm_add_epi32(_mm_castps_si128(even), _mm_castps_si128(odd));
+}
+
+I3D_TARGET_SSE2
+static void encodeColor_sse2(uint8_t* dst, const uint32_t* block) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i px[4];
+    for(int i = 0; i < 4; ++i)
+        px[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i * 4));
+
+    __m128i lo = _mm_min_epu8(_mm_min_epu8(px[0], px[1]), _mm_min_epu8(px[2], px[3]));
+    __m128i hi = _mm_max_epu8(_mm_max_epu8(px[0], px[1]), _mm_max_epu8(px[2], px[3]));
+    reduceMinMax_sse2(lo, hi);
+    const uint32_t lo32 = uint32_t(_mm_cvtsi128_si32(lo));
+    const uint32_t hi32 = uint32_t(_mm_cvtsi128_si32(hi));
+
+    ColorStats stats{};
+    int center[3];
+    for(int c = 0; c < 3; ++c) {
+        stats.lo[c] = (lo32 >> (8 * c)) & 0xff;
+        stats.hi[c] = (hi32 >> (8 * c)) & 0xff;
+        center[c] = (stats.lo[c] + stats.hi[c]) >> 1;
+    }
+
+    // (r - cr) * (g - cg) and (b - cb) * (g - cg) per pixel, with a 16-bit multiply-add
+    const __m128i centers = _mm_setr_epi16(short(center[0]), short(center[1]), short(center[2]), 0, short(center[0]), short(center[1]), short(center[2]), 0);
+    const __m128i greenMask = _mm_setr_epi16(-1, 0, -1, 0, -1, 0, -1, 0);
+    __m128i cov = _mm_setzero_si128();
+    for(const __m128i& p : px) {
+        for(const __m128i& half : { _mm_unpacklo_epi8(p, zero), _mm_unpackhi_epi8(p, zero) }) {
+            const __m128i d = _mm_sub_epi16(half, centers);
+            const __m128i green = _mm_and_si128(_mm_shufflehi_epi16(_mm_shufflelo_epi16(d, _MM_SHUFFLE(1, 1, 1, 1)), _MM_SHUFFLE(1, 1, 1, 1)), greenMask);
+            cov = _mm_add_epi32(cov, _mm_madd_epi16(d, green));
+        }
+    }
+    cov = _mm_add_epi32(cov, _mm_shuffle_epi32(cov, _MM_SHUFFLE(1, 0, 3, 2)));
+    stats.covRG = _mm_cvtsi128_si32(cov);
+    stats.covBG = _mm_cvtsi128_si32(_mm_shuffle_epi32(cov, _MM_SHUFFLE(1, 1, 1, 1)));
+
+    const ColorFit fit = fitColors(stats);
+
+    const __m128i axis = _mm_setr_epi16(short(fit.axis[0]), short(fit.axis[1]), short(fit.axis[2]), 0, short(fit.axis[0]), short(fit.axis[1]), short(fit.axis[2]), 0);
+    const __m128i step0 = _mm_set1_epi32(fit.steps[0]);
+    const __m128i step1 = _mm_set1_epi32(fit.steps[1]);
+    const __m128i step2 = _mm_set1_epi32(fit.steps[2]);
+    __m128i past1[4], past2[4], past3[4];
+    for(int i = 0; i < 4; ++i) {
+        const __m128i a = _mm_madd_epi16(_mm_unpacklo_epi8(px[i], zero), axis);
+        const __m128i b = _mm_madd_epi16(_mm_unpackhi_epi8(px[i], zero), axis);
+        const __m128i projection = _mm_slli_epi32(sumPairs_sse2(a, b), 1);
+        past1[i] = _mm_cmpgt_epi32(projection, step0);
+        past2[i] = _mm_cmpgt_epi32(projection, step1);
+        past3[i] = _mm_cmpgt_epi32(projection, step2);
+    }
+
+    // colorIndex[steps] bit by bit: bit 0 is set below 2 steps, bit 1 for 1 or 2 steps
+    auto mask16 = [](const __m128i m[4]) {
+        return uint32_t(_mm_movemask_epi8(_mm_packs_epi16(_mm_packs_epi32(m[0], m[1]), _mm_packs_epi32(m[2], m[3]))));
+    };
+    __m128i middle[4];
+    for(int i = 0; i < 4; ++i)
+        middle[i] = _mm_andnot_si128(past3[i], past1[i]);
+    const uint32_t bit0 = ~mask16(past2) & 0xffff;
+    const uint32_t bit1 = mask16(middle);
+    writeColorBlock(dst, fit, spreadBits(bit0) | (spreadBits(bit1) << 1));
+}
+
+I3D_TARGET_SSE2
+static void encodeAlpha_sse2(uint8_t* dst, const uint32_t* block) {
+    __m128i alpha[2];
+    for(int i = 0; i < 2; ++i) {
+        const __m128i a = _mm_srli_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i * 8)), 24);
+        const __m128i b = _mm_srli_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i * 8 + 4)), 24);
+        alpha[i] = _mm_packs_epi32(a, b);
+    }
+
+    __m128i lo = _mm_min_epi16(alpha[0], alpha[1]);
+    __m128i hi = _mm_max_epi16(alpha[0], alpha[1]);
+    lo = _mm_min_epi16(lo, _mm_srli_si128(lo, 8));
+    lo = _mm_min_epi16(lo, _mm_srli_si128(lo, 4));
+    lo = _mm_min_epi16(lo, _mm_srli_si128(lo, 2));
+    hi = _mm_max_epi16(hi, _mm_srli_si128(hi, 8));
+    hi = _mm_max_epi16(hi, _mm_srli_si128(hi, 4));
+    hi = _mm_max_epi16(hi, _mm_srli_si128(hi, 2));
+    const int lo16 = _mm_extract_epi16(lo, 0);
+    const int hi16 = _mm_extract_epi16(hi, 0);
+    const int range = hi16 - lo16;
+
+    // steps = how many of the 7 thresholds (2k - 1) * range the position 14 * (alpha - lo) reaches
+    const __m128i base = _mm_set1_epi16(short(lo16));
+    const __m128i scale = _mm_set1_epi16(14);
+    alignas(16) int16_t steps[16];
+    for(int i = 0; i < 2; ++i) {
+        const __m128i position = _mm_mullo_epi16(_mm_sub_epi16(alpha[i], base), scale);
+        __m128i count = _mm_setzero_si128();
+        for(int k = 1; k < 8; ++k)
+            count = _mm_sub_epi16(count, _mm_cmpgt_epi16(position, _mm_set1_epi16(short((2 * k - 1) * range - 1))));
+        _mm_store_si128(reinterpret_cast<__m128i*>(steps + i * 8), count);
+    }
+
+    uint32_t indices[16];
+    for(int i = 0; i < 16; ++i)
+        indices[i] = alphaIndex(uint32_t(steps[i]));
+    writeAlphaBlock(dst, uint8_t(hi16), uint8_t(lo16), indices);
+}
+
+I3D_TARGET_SSE2
+static void encodeBC1_sse2(uint8_t* dst, const uint32_t* blocks, uint32_t count) {
+    for(uint32_t i = 0; i < count; ++i)
+        encodeColor_sse2(dst + i * 8, blocks + i * 16);
+}
+
+I3D_TARGET_SSE2
+static void encodeBC3_sse2(uint8_t* dst, const uint32_t* blocks, uint32_t count) {
+    for(uint32_t i = 0; i < count; ++i) {
+        encodeAlpha_sse2(dst + i * 16, blocks + i * 16);
+        encodeColor_sse2(dst + i * 16 + 8, blocks + i * 16);
+    }
+}
+
+#endif
+
+//----------------------------
+
+static const I3D_compress_kernels kernelsScalar = { "scalar", encodeBC1_scalar, encodeBC3_scalar };
+#if I3D_SIMD_X86
+static const I3D_compress_kernels kernelsSSE2 = { "sse2", encodeBC1_sse2, encodeBC3_sse2 };
+#endif
+
+// a block is too small a unit for 256-bit lanes, AVX2 CPUs use the SSE2 kernels
+const I3D_compress_kernels& I3D_GetCompressKernels(uint32_t features) {
+#if I3D_SIMD_X86
+    if(features & CPUF_SSE2) return kernelsSSE2;
+#endif
+    return kernelsScalar;
+}
+
+const I3D_compress_kernels& I3D_GetCompressKernels() {
+    static const I3D_compress_kernels& kernels = I3D_GetCompressKernels(I3D_GetCPUFeatures());
+    return kernels;
+}
+
+//----------------------------
+
+void I3D_CompressMips(uint8_t* dst, const uint8_t* chain, uint32_t width, uint32_t height, uint32_t numLevels, I3D_TEXTURE_FORMAT format) {
+    const I3D_compress_kernels& kernels = I3D_GetCompressKernels();
+    const auto encode = format == TXTFMT_BC1 ? kernels.encodeBC1 : kernels.encodeBC3;
+    const uint32_t bytesPerBlock = blockSize(format);
+
+    const uint32_t* src = reinterpret_cast<const uint32_t*>(chain);
+    ea::vector<uint32_t> blocks;
+    for(uint32_t level = 0; level < numLevels; ++level) {
+        const uint32_t numBlocksX = (width + 3) / 4;
+        const uint32_t numBlocksY = (height + 3) / 4;
+        blocks.resize(size_t(numBlocksX) * 16);
+
+        // gather a row of blocks, edges are repeated into blocks sticking out of the level
+        for(uint32_t by = 0; by < numBlocksY; ++by) {
+            for(uint32_t bx = 0; bx < numBlocksX; ++bx) {
+                uint32_t* block = blocks.data() + size_t(bx) * 16;
+                for(uint32_t y = 0; y < 4; ++y) {
+                    const uint32_t* row = src + size_t(glm::min(by * 4 + y, height - 1)) * width;
+                    for(uint32_t x = 0; x < 4; ++x)
+                        block[y * 4 + x] = row[glm::min(bx * 4 + x, width - 1)];
+                }
+            }
+            encode(dst, blocks.data(), numBlocksX);
+            dst += size_t(numBlocksX) * bytesPerBlock;
+        }
+
+        src += size_t(width) * height;
+        width = glm::max(width >> 1, 1u);
+        height = glm::max(height >> 1, 1u);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+//----------------------------
+// Pixel formats of texture data. Block compressed formats store 4x4 pixel blocks, levels smaller
+// than a block still take a whole one.
+enum I3D_TEXTURE_FORMAT : uint32_t {
+    TXTFMT_RGBA8,
+    TXTFMT_BC1,     // 8 bytes per block, RGB
+    TXTFMT_BC3,     // 16 bytes per block, RGB + alpha
+    TXTFMT_LAST,
+};
+
+// bytes of numLevels mip levels, laid out as in I3D_mipmap.h
+size_t I3D_GetTextureSize(I3D_TEXTURE_FORMAT format, uint32_t width, uint32_t height, uint32_t numLevels = 1);
+
+//----------------------------
+// Block encoders. Blocks are 16 RGBA8 pixels packed to uint32_t (red in the low byte), row by row.
+// Colors are fit to the bounding box diagonal, alpha to its exact range, so 0 and 255 survive.
+struct I3D_compress_kernels {
+    const char* name;
+
+    void (*encodeBC1)(uint8_t* dst, const uint32_t* blocks, uint32_t count);
+    void (*encodeBC3)(uint8_t* dst, const uint32_t* blocks, uint32_t count);
+};
+
+// kernels for the best instruction set of this CPU
+const I3D_compress_kernels& I3D_GetCompressKernels();
+
+// kernels for a given feature mask (CPUF_*), e.g. to compare implementations
+const I3D_compress_kernels& I3D_GetCompressKernels(uint32_t features);
+
+// Encode an RGBA8 mip chain to I3D_GetTextureSize(format, ...) bytes at dst.
+void I3D_CompressMips(uint8_t* dst, const uint8_t* chain, uint32_t width, uint32_t height, uint32_t numLevels, I3D_TEXTURE_FORMAT format);
\ No newline at end of file
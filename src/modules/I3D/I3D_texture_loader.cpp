@@ -0,0 +1,279 @@
+#include "I3D_texture_loader.h"
+#include "I3D_driver.h"
+
+#include <cstdio>
+#include <thread>
+
+#define SOKOL_FETCH_IMPL
+#include "sokol_fetch.h"
+
+// travels with each fetch request, sokol_fetch copies it
+struct FetchData {
+    I3D_texture_loader* loader;
+    uint32_t id;
+    uint32_t file;
+};
+
+I3D_texture_loader::I3D_texture_loader(I3D_driver* driver) :
+    _driver(driver) {
+}
+
+I3D_texture_loader::~I3D_texture_loader() {
+    shutdown();
+}
+
+void I3D_texture_loader::init(IDevice* device) {
+    shutdown();
+    _device = device;
+
+    // mid-grey, so missing textures don't stand out before they arrive
+    const uint32_t pixels[4] = { 0xff808080, 0xff808080, 0xff808080, 0xff808080 };
+    ImageDesc desc{};
+    desc.width = 2;
+    desc.height = 2;
+    desc.data.subimage[0][0] = SG_RANGE(pixels);
+    _placeholder = _device->createImage(desc);
+    _compress = _device->isPixelFormatSupported(SG_PIXELFORMAT_BC1_RGBA) && _device->isPixelFormatSupported(SG_PIXELFORMAT_BC3_RGBA);
+
+    // the sokol_fetch context belongs to the calling thread and may be shared with other users
+    if(!sfetch_valid()) {
+        sfetch_desc_t fetchDesc{};
+        fetchDesc.num_lanes = NUM_LANES;
+        sfetch_setup(&fetchDesc);
+        _ownsFetch = true;
+    }
+}
+
+void I3D_texture_loader::shutdown() {
+    if(!_device) return;
+
+    // drop what is in flight, textures keep the placeholder
+    for(auto& it : _requests) {
+        if(it.second.texture) it.second.texture->_loading = false;
+        cancel(it.second);
+    }
+
+    // wait for the callbacks of cancelled requests, the IO thread may still read into their buffers
+    while(_numFetching) {
+        sfetch_dowork();
+        std::this_thread::yield();
+    }
+    _requests.clear();
+    _unsent.clear();
+
+    if(_ownsFetch) {
+        sfetch_shutdown();
+        _ownsFetch = false;
+    }
+
+    {
+        // decodes still running are dropped when they arrive
+        std::lock_guard<std::mutex> lock(_mutex);
+        _decoded.clear();
+    }
+
+    _device->destroyImage(_placeholder);
+    _device = nullptr;
+}
+
+bool I3D_texture_loader::request(I3D_texture* texture, const I3D_CREATETEXTURE& params) {
+    if(!_device || params._diffuse.empty()) return false;
+
+    const uint32_t id = _nextId++;
+    Request& request = _requests[id];
+    request.texture = texture;
+    request.params = params;
+    request.numFiles = (params._flags & TXTMAP_OPACITY) && !params._op.empty() ? 2 : 1;
+
+    if(!send(id, request)) _unsent.push_back(id);
+    return true;
+}
+
+void I3D_texture_loader::cancel(I3D_texture* texture) {
+    for(auto& it : _requests) {
+        if(it.second.texture == texture) cancel(it.second);
+    }
+}
+
+// the entry goes away once sokol_fetch or the decode is done with it
+void I3D_texture_loader::cancel(Request& request) {
+    request.texture = nullptr;
+    for(uint32_t f = 0; f < request.numFiles; ++f) {
+        File& file = request.files[f];
+        if(file.fetch)
+            sfetch_cancel(sfetch_handle_t{ file.fetch });
+        else
+            file.finished = file.failed = true;
+    }
+}
+
+// send files not sent yet, false if sokol_fetch is full
+bool I3D_texture_loader::send(uint32_t id, Request& request) {
+    for(uint32_t f = 0; f < request.numFiles; ++f) {
+        File& file = request.files[f];
+        if(file.fetch || file.finished) continue;
+
+        const FetchData fetchData{ this, id, f };
+        sfetch_request_t fetch{};
+        fetch.path = (f == FILE_DIFFUSE ? request.params._diffuse : request.params._op).c_str();
+        fetch.callback = onResponse;
+        fetch.chunk_size = CHUNK_SIZE;
+        fetch.user_data = SFETCH_RANGE(fetchData);
+
+        // the file size isn't known up front, so it's read in chunks and gathered
+        file.chunk.resize(CHUNK_SIZE);
+        fetch.buffer = sfetch_range_t{ file.chunk.data(), CHUNK_SIZE };
+
+        const sfetch_handle_t handle = sfetch_send(&fetch);
+        if(!sfetch_handle_valid(handle)) {
+            file.chunk.set_capacity(0);
+            return false;
+        }
+
+        file.fetch = handle.id;
+        ++_numFetching;
+    }
+    return true;
+}
+
+void I3D_texture_loader::finish(Request& request, const I3D_image* image) {
+    if(!request.texture) return;
+
+    request.texture->_loading = false;
+    if(!image || !image->isValid()) return;
+
+    request.params._width = image->getWidth();
+    request.params._height = image->getHeight();
+    request.params._numLevels = image->getNumLevels();
+    request.params._format = image->getFormat();
+    request.texture->create(request.params, image->getData());
+}
+
+//----------------------------
+
+void I3D_texture_loader::tick() {
+    if(!_device) return;
+
+    // requests refused while sokol_fetch was full
+    uint32_t numUnsent = 0;
+    for(uint32_t id : _unsent) {
+        auto it = _requests.find(id);
+        if(it == _requests.end()) continue;
+
+        if(!it->second.texture) {
+            // a file still being read removes the request when it finishes
+            bool fetching = false;
+            for(const File& file : it->second.files)
+                fetching |= file.fetch != 0;
+            if(!fetching) _requests.erase(it);
+        } else if(!send(id, it->second)) {
+            _unsent[numUnsent++] = id;
+        }
+    }
+    _unsent.resize(numUnsent);
+
+    sfetch_dowork();
+
+    ea::vector<Decoded> decoded;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        decoded.swap(_decoded);
+    }
+
+    // upload a limited amount per tick, the rest waits for the next one
+    size_t uploaded = 0;
+    uint32_t i = 0;
+    for(; i < decoded.size() && uploaded < UPLOAD_BYTES_PER_TICK; ++i) {
+        auto it = _requests.find(decoded[i].id);
+        if(it == _requests.end()) continue;
+
+        Request& request = it->second;
+        finish(request, &decoded[i].image);
+        uploaded += decoded[i].image.getTotalSize();
+        _requests.erase(it);
+    }
+
+    if(i < decoded.size()) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _decoded.insert(_decoded.begin(), ea::make_move_iterator(decoded.begin() + i), ea::make_move_iterator(decoded.end()));
+    }
+}
+
+//----------------------------
+
+// Runs on a worker. Compressed images are cached under the hash of their source files and of
+// everything else that goes into them, so a changed file or setting just misses the cache.
+void I3D_texture_loader::decode(I3D_image& image, const ea::vector<uint8_t>& diffuse, const ea::vector<uint8_t>& opacity,
+                                uint32_t mipmapFlags, const ea::string& diskCache) const {
+    ea::string cacheFile;
+    uint64_t key = 0;
+    if(!diskCache.empty()) {
+        const uint64_t sources[4] = { I3D_HashData(diffuse.data(), diffuse.size()), I3D_HashData(opacity.data(), opacity.size()), mipmapFlags, VERSION_DECODE };
+        key = I3D_HashData(sources, sizeof(sources));
+
+        char name[32];
+        snprintf(name, sizeof(name), "%016llx.i3di", static_cast<unsigned long long>(key));
+        cacheFile = diskCache + name;
+        if(image.readCache(cacheFile.c_str(), key)) return;
+    }
+
+    if(!image.load(diffuse.data(), diffuse.size())) return;
+
+    I3D_image alpha;
+    if(!opacity.empty() && alpha.load(opacity.data(), opacity.size())) image.mergeAlpha(alpha);
+    image.generateMips(mipmapFlags);
+
+    if(!_compress || !image.compress()) return;
+    if(!cacheFile.empty()) image.writeCache(cacheFile.c_str(), key);
+}
+
+void I3D_texture_loader::onResponse(const sfetch_response_t* response) {
+    const FetchData* fetchData = static_cast<const FetchData*>(response->user_data);
+    fetchData->loader->handleResponse(response, fetchData->id, fetchData->file);
+}
+
+void I3D_texture_loader::handleResponse(const sfetch_response_t* response, uint32_t id, uint32_t f) {
+    if(response->finished) --_numFetching;
+
+    auto it = _requests.find(id);
+    if(it == _requests.end()) return;
+
+    Request& request = it->second;
+    File& file = request.files[f];
+    if(response->fetched) {
+        const uint8_t* data = static_cast<const uint8_t*>(response->data.ptr);
+        file.data.insert(file.data.end(), data, data + response->data.size);
+    }
+
+    if(!response->finished) return;
+
+    file.fetch = 0;
+    file.finished = true;
+    file.failed = response->failed;
+    file.chunk.set_capacity(0);
+
+    for(uint32_t i = 0; i < request.numFiles; ++i) {
+        if(!request.files[i].finished) return;
+    }
+
+    // without the opacity map the texture still loads, just without alpha
+    if(request.files[FILE_DIFFUSE].failed || !request.texture) {
+        finish(request, nullptr);
+        _requests.erase(it);
+        return;
+    }
+
+    ea::vector<uint8_t> opacity;
+    if(request.numFiles > FILE_OPACITY && !request.files[FILE_OPACITY].failed)
+        opacity = ea::move(request.files[FILE_OPACITY].data);
+
+    const uint32_t mipmapFlags = I3D_GetMipmapFlags(request.params);
+    const ea::string diskCache = _compress ? _diskCache : ea::string();
+    _driver->getJobs().run([this, id, mipmapFlags, diskCache, diffuse = ea::move(request.files[FILE_DIFFUSE].data), opacity = ea::move(opacity)]() {
+        Decoded decoded{ id, I3D_image() };
+        decode(decoded.image, diffuse, opacity, mipmapFlags, diskCache);
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        _decoded.push_back(ea::move(decoded));
+    });
+}
\ No newline at end of file
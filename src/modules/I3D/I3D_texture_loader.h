@@ -0,0 +1,104 @@
+#pragma once
+#include "I3D.h"
+#include "I3D_name.h"
+#include "I3D_image.h"
+#include "I3D_texture.h"
+
+#include <mutex>
+#include <EASTL/vector.h>
+#include <EASTL/string.h>
+#include <EASTL/hash_map.h>
+namespace ea = eastl;
+
+struct sfetch_response_t;
+
+//----------------------------
+// Streams texture files in the background. Files are read by sokol_fetch on its IO thread,
+// decoded by the driver's workers and uploaded from a queue in tick() on the render thread,
+// a limited amount per tick so loading never stalls a frame. Until then textures show the
+// placeholder image. Decodes capture the loader, so it has to outlive the driver's workers.
+// Where the device samples BC1 / BC3 textures are block compressed by the workers too, and with
+// a disk cache set the results are kept there to skip decoding next time.
+class I3D_texture_loader {
+public:
+    I3D_texture_loader(I3D_driver* driver);
+    ~I3D_texture_loader();
+
+    I3D_texture_loader(const I3D_texture_loader&) = delete;
+    I3D_texture_loader& operator=(const I3D_texture_loader&) = delete;
+
+    // called from the render thread, like all other methods
+    void init(IDevice* device);
+    void shutdown();
+
+    // start loading params._diffuse into 'texture', with TXTMAP_OPACITY params._op goes to its alpha
+    bool request(I3D_texture* texture, const I3D_CREATETEXTURE& params);
+
+    // forget the request of a texture being destroyed
+    void cancel(I3D_texture* texture);
+
+    // progress reads and upload decoded images
+    void tick();
+
+    // path prefix of compressed texture files, empty to not keep them
+    void setDiskCache(const char* path) { _diskCache = path; }
+
+    // whether textures get block compressed for the device
+    bool isCompressing() const { return _compress; }
+
+    Image getPlaceholder() const { return _placeholder; }
+    uint32_t getNumPending() const { return uint32_t(_requests.size()); }
+private:
+    static constexpr uint32_t NUM_LANES = 4;
+    static constexpr uint32_t CHUNK_SIZE = 64 * 1024;
+    static constexpr size_t UPLOAD_BYTES_PER_TICK = 4 * 1024 * 1024;
+
+    enum { FILE_DIFFUSE, FILE_OPACITY, MAX_FILES };
+
+    struct File {
+        uint32_t fetch;                 // sfetch handle while fetching, else 0
+        bool finished;
+        bool failed;
+        ea::vector<uint8_t> chunk;      // read buffer while fetching
+        ea::vector<uint8_t> data;       // file content, gathered chunk by chunk
+    };
+
+    struct Request {
+        I3D_texture* texture;           // null once cancelled
+        I3D_CREATETEXTURE params;
+        File files[MAX_FILES];
+        uint32_t numFiles;
+    };
+
+    struct Decoded {
+        uint32_t id;
+        I3D_image image;
+    };
+
+    // bump when decoded images change, it invalidates the disk cache
+    static constexpr uint64_t VERSION_DECODE = 1;
+
+    void decode(I3D_image& image, const ea::vector<uint8_t>& diffuse, const ea::vector<uint8_t>& opacity,
+                uint32_t mipmapFlags, const ea::string& diskCache) const;
+    static void onResponse(const sfetch_response_t* response);
+    void handleResponse(const sfetch_response_t* response, uint32_t id, uint32_t file);
+    bool send(uint32_t id, Request& request);
+    void cancel(Request& request);
+    void finish(Request& request, const I3D_image* image);
+
+    I3D_driver* _driver{ nullptr };
+    IDevice* _device{ nullptr };
+    Image _placeholder{};
+
+    uint32_t _nextId{ 1 };
+    uint32_t _numFetching{};            // sent and not finished yet, callbacks still to come
+    ea::hash_map<uint32_t, Request> _requests{};
+    ea::vector<uint32_t> _unsent{};     // waiting for a free slot in sokol_fetch
+    bool _ownsFetch{ false };
+    bool _compress{ false };
+    ea::string _diskCache{};
+
+    // written by workers
+    std::mutex _mutex{};
+    ea::vector<Decoded> _decoded{};
+};
\ No newline at end of file
@@ -0,0 +1,502 @@
+#include "I3D_transform.h"
+#include "I3D_simd.h"
+
+#include <atomic>
+#include <EASTL/sort.h>
+#include <EASTL/algorithm.h>
+
+static I3D_bbox invalidBox() {
+    I3D_bbox box;
+    box.Invalidate();
+    return box;
+}
+
+// AABB of a transformed box: transformed center, extents projected on the world axes
+static I3D_bbox transformBox(const I3D_bbox& box, const glm::mat4& mat) {
+    if(!box.IsValid()) return box;
+
+    const glm::vec3 center = glm::vec3(mat * glm::vec4((box.min + box.max) * 0.5f, 1.0f));
+    const glm::vec3 half = (box.max - box.min) * 0.5f;
+    const glm::vec3 extent = glm::abs(glm::vec3(mat[0])) * half.x + glm::abs(glm::vec3(mat[1])) * half.y + glm::abs(glm::vec3(mat[2])) * half.z;
+    return I3D_bbox(center - extent, center + extent);
+}
+
+static void mergeBox(I3D_bbox& box, const I3D_bbox& other) {
+    box.min = glm::min(box.min, other.min);
+    box.max = glm::max(box.max, other.max);
+}
+
+static I3D_bsphere boxSphere(const I3D_bbox& box) {
+    if(!box.IsValid()) return I3D_bsphere(glm::vec3(0.0f), -1.0f);
+    return I3D_bsphere((box.min + box.max) * 0.5f, glm::length(box.max - box.min) * 0.5f);
+}
+
+I3D_xform I3D_transform_store::create() {
+    I3D_xform xf;
+    if(!_free.empty()) {
+        xf = _free.back();
+        _free.pop_back();
+    } else {
+        xf = I3D_xform(_slots.size());
+        _slots.push_back(I3D_XFORM_NONE);
+        _parents.push_back(I3D_XFORM_NONE);
+    }
+
+    // new root goes to the end, which keeps the pre-order valid without a re-sort
+    const uint32_t slot = uint32_t(_handles.size());
+    _slots[xf] = slot;
+    _parents[xf] = I3D_XFORM_NONE;
+
+    _pos.push_back(glm::vec3(0.0f));
+    _rot.push_back(glm::identity<glm::quat>());
+    _scale.push_back(glm::vec3(1.0f));
+    _local.push_back(glm::mat4(1.0f));
+    _world.push_back(glm::mat4(1.0f));
+    _localBox.push_back(invalidBox());
+    _worldBox.push_back(invalidBox());
+    _boundBox.push_back(invalidBox());
+    _boundSphere.push_back(boxSphere(invalidBox()));
+    _parentSlots.push_back(I3D_XFORM_NONE);
+    _subtreeEnd.push_back(slot + 1);
+    _flags.push_back(0);
+    _handles.push_back(xf);
+    return xf;
+}
+
+void I3D_transform_store::reserve(uint32_t count) {
+    const uint32_t numSlots = uint32_t(_handles.size()) + count;
+    _pos.reserve(numSlots);
+    _rot.reserve(numSlots);
+    _scale.reserve(numSlots);
+    _local.reserve(numSlots);
+    _world.reserve(numSlots);
+    _localBox.reserve(numSlots);
+    _worldBox.reserve(numSlots);
+    _boundBox.reserve(numSlots);
+    _boundSphere.reserve(numSlots);
+    _parentSlots.reserve(numSlots);
+    _subtreeEnd.reserve(numSlots);
+    _flags.reserve(numSlots);
+    _handles.reserve(numSlots);
+
+    const uint32_t numHandles = uint32_t(_slots.size() + count);
+    _slots.reserve(numHandles);
+    _parents.reserve(numHandles);
+}
+
+void I3D_transform_store::release(I3D_xform xf) {
+    assert(_slots[xf] != I3D_XFORM_NONE);
+    _slots[xf] = I3D_XFORM_NONE;
+    _parents[xf] = I3D_XFORM_NONE;
+    _released.push_back(xf);
+    _orderDirty = true;
+}
+
+void I3D_transform_store::copy(I3D_xform dst, I3D_xform src) {
+    const uint32_t d = _slots[dst];
+    const uint32_t s = _slots[src];
+    _pos[d] = _pos[s];
+    _rot[d] = _rot[s];
+    _scale[d] = _scale[s];
+    _local[d] = _local[s];
+    _world[d] = _world[s];
+    markDirty(d, (_flags[s] & XFMFLAGS_LOCAL_DIRTY) | XFMFLAGS_WORLD_DIRTY);
+}
+
+void I3D_transform_store::setParent(I3D_xform xf, I3D_xform parent) {
+    assert(xf != parent);
+    if(_parents[xf] == parent) return;
+
+    _parents[xf] = parent;
+    _orderDirty = true;
+    markDirty(_slots[xf], XFMFLAGS_WORLD_DIRTY);
+}
+
+void I3D_transform_store::setPos(I3D_xform xf, const glm::vec3& pos) {
+    const uint32_t slot = _slots[xf];
+    _pos[slot] = pos;
+    markDirty(slot, XFMFLAGS_LOCAL_DIRTY);
+}
+
+void I3D_transform_store::setRot(I3D_xform xf, const glm::quat& rot) {
+    const uint32_t slot = _slots[xf];
+    _rot[slot] = rot;
+    markDirty(slot, XFMFLAGS_LOCAL_DIRTY);
+}
+
+void I3D_transform_store::setScale(I3D_xform xf, const glm::vec3& scale) {
+    const uint32_t slot = _slots[xf];
+    _scale[slot] = scale;
+    markDirty(slot, XFMFLAGS_LOCAL_DIRTY);
+}
+
+const glm::mat4& I3D_transform_store::getLocalMatrix(I3D_xform xf) {
+    if(!_dirtyList.empty() || _orderDirty) update();
+    return _local[_slots[xf]];
+}
+
+const glm::mat4& I3D_transform_store::getMatrix(I3D_xform xf) {
+    if(!_dirtyList.empty() || _orderDirty) update();
+    return _world[_slots[xf]];
+}
+
+void I3D_transform_store::setLocalMatrix(I3D_xform xf, const glm::mat4& mat) {
+    const uint32_t slot = _slots[xf];
+    _local[slot] = mat;
+    _flags[slot] &= ~XFMFLAGS_LOCAL_DIRTY;
+    markDirty(slot, XFMFLAGS_WORLD_DIRTY);
+}
+
+void I3D_transform_store::setLocalBBox(I3D_xform xf, const I3D_bbox& bbox) {
+    const uint32_t slot = _slots[xf];
+    _localBox[slot] = bbox;
+    markDirty(slot, XFMFLAGS_BOUNDS_DIRTY);
+}
+
+const I3D_bbox& I3D_transform_store::getWorldBBox(I3D_xform xf) {
+    if(!_dirtyList.empty() || _orderDirty) update();
+    return _worldBox[_slots[xf]];
+}
+
+const I3D_bbox& I3D_transform_store::getBoundBox(I3D_xform xf) {
+    updateBounds();
+    return _boundBox[_slots[xf]];
+}
+
+const I3D_bsphere& I3D_transform_store::getBoundSphere(I3D_xform xf) {
+    updateBounds();
+    return _boundSphere[_slots[xf]];
+}
+
+void I3D_transform_store::update(I3D_jobs* jobs) {
+    // below this many slots to walk, threading costs more than it saves
+    constexpr uint32_t PARALLEL_MIN_SLOTS = 4096;
+
+    if(_orderDirty) sort();
+
+    _stats = {};
+    if(_dirtyList.empty()) return;
+
+    _stats.numDirty = uint32_t(_dirtyList.size());
+    buildDirtyRanges();
+    _dirtyList.clear();
+
+    const uint32_t count = uint32_t(_handles.size());
+    const bool parallel = jobs && jobs->getNumThreads() > 1 && _stats.numVisited >= PARALLEL_MIN_SLOTS;
+    if(parallel && _stats.numVisited > count / 2 && _batches.size() > 1) {
+        // most of the hierarchy is dirty, resolve everything in the presorted batches
+        std::atomic<uint32_t> numUpdated{ 0 };
+        for(uint32_t slot : _topSlots)
+            numUpdated += updateRange(slot, slot + 1);
+
+        jobs->parallelFor(uint32_t(_batches.size()), [this, &numUpdated](uint32_t b) {
+            numUpdated += updateRange(_batches[b].first, _batches[b].last);
+        });
+
+        // roots created since the last sort aren't part of any batch yet
+        numUpdated += updateRange(_numBatchedSlots, count);
+
+        ea::fill(_flags.begin(), _flags.end(), uint8_t(0));
+        _boundsAll = true;
+        _stats.numVisited = count;
+        _stats.numUpdated = numUpdated;
+    } else if(parallel && _dirtyRanges.size() > 1) {
+        // dirty subtrees don't overlap, so they are independent of each other
+        std::atomic<uint32_t> numUpdated{ 0 };
+        jobs->parallelFor(uint32_t(_dirtyRanges.size()), [this, &numUpdated](uint32_t r) {
+            const Batch& range = _dirtyRanges[r];
+            numUpdated += updateRange(range.first, range.last);
+            ea::fill(_flags.begin() + range.first, _flags.begin() + range.last, uint8_t(0));
+        });
+        _stats.numUpdated = numUpdated;
+        _boundsRanges.insert(_boundsRanges.end(), _dirtyRanges.begin(), _dirtyRanges.end());
+    } else {
+        for(const Batch& range : _dirtyRanges) {
+            _stats.numUpdated += updateRange(range.first, range.last);
+            ea::fill(_flags.begin() + range.first, _flags.begin() + range.last, uint8_t(0));
+        }
+        _boundsRanges.insert(_boundsRanges.end(), _dirtyRanges.begin(), _dirtyRanges.end());
+    }
+}
+
+void I3D_transform_store::updateBounds() {
+    if(!_dirtyList.empty() || _orderDirty) update();
+
+    if(_boundsAll) {
+        mergeBounds(0, uint32_t(_handles.size()));
+        _boundsRanges.clear();
+        _boundsAll = false;
+        return;
+    }
+
+    if(_boundsRanges.empty()) return;
+
+    // ranges of several updates may nest, the outer one covers the inner ones
+    ea::sort(_boundsRanges.begin(), _boundsRanges.end(), [](const Batch& a, const Batch& b) {
+        return a.first < b.first || (a.first == b.first && a.last > b.last);
+    });
+
+    ea::vector<uint32_t> ancestors{};
+    uint32_t covered = 0;
+    for(const Batch& range : _boundsRanges) {
+        if(range.first < covered) continue;
+        covered = range.last;
+
+        mergeBounds(range.first, range.last);
+        for(uint32_t parent = _parentSlots[range.first]; parent != I3D_XFORM_NONE; parent = _parentSlots[parent])
+            ancestors.push_back(parent);
+    }
+    _boundsRanges.clear();
+
+    // deepest first, so every ancestor sees final bounds of its children
+    ea::sort(ancestors.begin(), ancestors.end(), [](uint32_t a, uint32_t b) { return a > b; });
+    ancestors.erase(ea::unique(ancestors.begin(), ancestors.end()), ancestors.end());
+    for(uint32_t slot : ancestors)
+        mergeChildBounds(slot);
+}
+
+//----------------------------
+
+uint32_t I3D_transform_store::updateRange(uint32_t first, uint32_t last) {
+    // dirty slots are gathered per chunk and handed to the SIMD kernels in one go
+    constexpr uint32_t CHUNK_SIZE = 256;
+    uint32_t composeSlots[CHUNK_SIZE];
+    uint32_t concatSlots[CHUNK_SIZE];
+    uint32_t boundsSlots[CHUNK_SIZE];
+
+    const I3D_xform_kernels& kernels = I3D_GetXformKernels();
+    uint32_t numUpdated = 0;
+    for(uint32_t begin = first; begin < last; begin += CHUNK_SIZE) {
+        const uint32_t end = ea::min(begin + CHUNK_SIZE, last);
+        uint32_t numCompose = 0;
+        uint32_t numConcat = 0;
+        uint32_t numBounds = 0;
+
+        for(uint32_t i = begin; i < end; ++i) {
+            const uint32_t parent = _parentSlots[i];
+            uint8_t flags = _flags[i];
+            if(parent != I3D_XFORM_NONE)
+                flags |= (_flags[parent] & XFMFLAGS_WORLD_DIRTY);
+
+            if(!flags) continue;
+
+            if(flags & XFMFLAGS_LOCAL_DIRTY)
+                composeSlots[numCompose++] = i;
+
+            boundsSlots[numBounds++] = i;
+            if(flags == XFMFLAGS_BOUNDS_DIRTY) {
+                _flags[i] = 0;
+                continue;
+            }
+
+            concatSlots[numConcat++] = i;
+
+            // parent precedes children, so they pick this up later in the same pass
+            _flags[i] = XFMFLAGS_WORLD_DIRTY;
+        }
+
+        // local matrix = transl * rot * scale, world = parent's world * local
+        kernels.composeTRS(_local.data(), _pos.data(), _rot.data(), _scale.data(), composeSlots, numCompose);
+        kernels.concatAffine(_world.data(), _local.data(), _parentSlots.data(), concatSlots, numConcat);
+        numUpdated += numConcat;
+
+        for(uint32_t n = 0; n < numBounds; ++n) {
+            const uint32_t slot = boundsSlots[n];
+            _worldBox[slot] = transformBox(_localBox[slot], _world[slot]);
+        }
+    }
+
+    return numUpdated;
+}
+
+void I3D_transform_store::mergeBounds(uint32_t first, uint32_t last) {
+    // [first, last) is a whole subtree or a run of them, children follow their parent
+    for(uint32_t i = first; i < last; ++i)
+        _boundBox[i] = _worldBox[i];
+
+    for(uint32_t i = last; i-- > first;) {
+        const uint32_t parent = _parentSlots[i];
+        if(parent != I3D_XFORM_NONE && parent >= first)
+            mergeBox(_boundBox[parent], _boundBox[i]);
+        _boundSphere[i] = boxSphere(_boundBox[i]);
+    }
+}
+
+void I3D_transform_store::mergeChildBounds(uint32_t slot) {
+    _boundBox[slot] = _worldBox[slot];
+    for(uint32_t child = slot + 1; child < _subtreeEnd[slot]; child = _subtreeEnd[child])
+        mergeBox(_boundBox[slot], _boundBox[child]);
+    _boundSphere[slot] = boxSphere(_boundBox[slot]);
+}
+
+void I3D_transform_store::buildDirtyRanges() {
+    // in slot order, a dirty transform inside an already taken subtree is resolved with it
+    ea::vector<uint32_t> dirtySlots{};
+    dirtySlots.reserve(_dirtyList.size());
+    for(I3D_xform xf : _dirtyList) {
+        if(_slots[xf] != I3D_XFORM_NONE)
+            dirtySlots.push_back(_slots[xf]);
+    }
+    ea::sort(dirtySlots.begin(), dirtySlots.end());
+
+    _dirtyRanges.clear();
+    uint32_t covered = 0;
+    for(uint32_t slot : dirtySlots) {
+        if(slot < covered) continue;
+
+        covered = _subtreeEnd[slot];
+        _dirtyRanges.push_back({ slot, covered });
+        _stats.numVisited += covered - slot;
+    }
+
+    _stats.numRanges = uint32_t(_dirtyRanges.size());
+}
+
+//----------------------------
+
+void I3D_transform_store::markDirty(uint32_t slot, uint8_t flags) {
+    if(!_flags[slot])
+        _dirtyList.push_back(_handles[slot]);
+    _flags[slot] |= flags;
+}
+
+void I3D_transform_store::sort() {
+    const uint32_t numHandles = uint32_t(_slots.size());
+    const uint32_t numSlots = uint32_t(_handles.size());
+
+    // gather children of every handle (CSR), keeping the current slot order among siblings
+    ea::vector<uint32_t> firstChild(numHandles + 1, 0);
+    ea::vector<I3D_xform> roots{};
+    for(uint32_t slot = 0; slot < numSlots; ++slot) {
+        const I3D_xform xf = _handles[slot];
+        if(_slots[xf] == I3D_XFORM_NONE) continue;
+
+        const I3D_xform parent = _parents[xf];
+        if(parent != I3D_XFORM_NONE && _slots[parent] != I3D_XFORM_NONE) {
+            ++firstChild[parent + 1];
+        } else {
+            if(parent != I3D_XFORM_NONE) {
+                // orphaned by release of its parent
+                _parents[xf] = I3D_XFORM_NONE;
+                markDirty(slot, XFMFLAGS_WORLD_DIRTY);
+            }
+            roots.push_back(xf);
+        }
+    }
+
+    for(uint32_t i = 0; i < numHandles; ++i)
+        firstChild[i + 1] += firstChild[i];
+
+    ea::vector<I3D_xform> children(firstChild[numHandles]);
+    ea::vector<uint32_t> cursor(firstChild.begin(), firstChild.end() - 1);
+    for(uint32_t slot = 0; slot < numSlots; ++slot) {
+        const I3D_xform xf = _handles[slot];
+        if(_slots[xf] == I3D_XFORM_NONE || _parents[xf] == I3D_XFORM_NONE) continue;
+        children[cursor[_parents[xf]]++] = xf;
+    }
+
+    // depth-first pre-order
+    ea::vector<I3D_xform> order{};
+    ea::vector<I3D_xform> stack{};
+    order.reserve(numSlots);
+    for(I3D_xform root : roots) {
+        stack.push_back(root);
+        while(!stack.empty()) {
+            const I3D_xform xf = stack.back();
+            stack.pop_back();
+            order.push_back(xf);
+
+            for(uint32_t c = firstChild[xf + 1]; c > firstChild[xf]; --c)
+                stack.push_back(children[c - 1]);
+        }
+    }
+
+    // permute slot arrays into the new order
+    const uint32_t count = uint32_t(order.size());
+    assert(count + _released.size() == numSlots && "cycle in frame hierarchy");
+    ea::vector<glm::vec3> pos(count);
+    ea::vector<glm::quat> rot(count);
+    ea::vector<glm::vec3> scale(count);
+    ea::vector<glm::mat4> local(count);
+    ea::vector<glm::mat4> world(count);
+    ea::vector<I3D_bbox> localBox(count);
+    ea::vector<I3D_bbox> worldBox(count);
+    ea::vector<uint8_t> flags(count);
+    for(uint32_t i = 0; i < count; ++i) {
+        const uint32_t old = _slots[order[i]];
+        pos[i] = _pos[old];
+        rot[i] = _rot[old];
+        scale[i] = _scale[old];
+        local[i] = _local[old];
+        world[i] = _world[old];
+        localBox[i] = _localBox[old];
+        worldBox[i] = _worldBox[old];
+        flags[i] = _flags[old];
+    }
+
+    for(uint32_t i = 0; i < count; ++i)
+        _slots[order[i]] = i;
+
+    _parentSlots.resize(count);
+    for(uint32_t i = 0; i < count; ++i) {
+        const I3D_xform parent = _parents[order[i]];
+        _parentSlots[i] = (parent != I3D_XFORM_NONE) ? _slots[parent] : I3D_XFORM_NONE;
+    }
+
+    _subtreeEnd.resize(count);
+    for(uint32_t i = 0; i < count; ++i)
+        _subtreeEnd[i] = i + 1;
+
+    for(uint32_t i = count; i-- > 0;) {
+        if(_parentSlots[i] != I3D_XFORM_NONE)
+            _subtreeEnd[_parentSlots[i]] = ea::max(_subtreeEnd[_parentSlots[i]], _subtreeEnd[i]);
+    }
+
+    _pos.swap(pos);
+    _rot.swap(rot);
+    _scale.swap(scale);
+    _local.swap(local);
+    _world.swap(world);
+    _localBox.swap(localBox);
+    _worldBox.swap(worldBox);
+    _flags.swap(flags);
+    _handles.swap(order);
+
+    _free.insert(_free.end(), _released.begin(), _released.end());
+    _released.clear();
+    _orderDirty = false;
+
+    // subtree bounds are rebuilt from scratch in the new order
+    _boundBox.resize(count);
+    _boundSphere.resize(count);
+    _boundsRanges.clear();
+    _boundsAll = true;
+
+    buildBatches();
+}
+
+void I3D_transform_store::buildBatches() {
+    // subtrees up to this size are resolved by a single job
+    constexpr uint32_t BATCH_SIZE = 1024;
+
+    _topSlots.clear();
+    _batches.clear();
+
+    const uint32_t count = uint32_t(_handles.size());
+    uint32_t i = 0;
+    while(i < count) {
+        if(_subtreeEnd[i] - i > BATCH_SIZE) {
+            _topSlots.push_back(i++);
+            continue;
+        }
+
+        // merge consecutive small subtrees, all their ancestors are top slots
+        const uint32_t first = i;
+        while(i < count && _subtreeEnd[i] - first <= BATCH_SIZE)
+            i = _subtreeEnd[i];
+
+        _batches.push_back({ first, i });
+    }
+
+    _numBatchedSlots = count;
+}
\ No newline at end of file
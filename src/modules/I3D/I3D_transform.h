@@ -0,0 +1,137 @@
+#pragma once
+#include "I3D.h"
+#include "I3D_jobs.h"
+
+#include <cstdint>
+#include <EASTL/vector.h>
+namespace ea = eastl;
+
+#include <glm/ext.hpp>
+
+//----------------------------
+// Handle of a transform inside I3D_transform_store. Handles are stable for the whole
+// lifetime of the owner, the slot they point to is not (it moves when the store re-sorts).
+using I3D_xform = uint32_t;
+constexpr I3D_xform I3D_XFORM_NONE = 0xffffffff;
+
+enum I3D_XFORM_FLAGS : uint8_t {
+    XFMFLAGS_LOCAL_DIRTY    = (1 << 0), // pos/rot/scale changed, local matrix must be rebuilt
+    XFMFLAGS_WORLD_DIRTY    = (1 << 1), // local matrix or parent changed, world matrix must be rebuilt
+    XFMFLAGS_BOUNDS_DIRTY   = (1 << 2), // local bbox changed, world bbox must be rebuilt
+};
+
+//----------------------------
+// counters of the last update()
+struct I3D_XFORM_STATS {
+    uint32_t numDirty{};    // transforms changed since the previous update
+    uint32_t numRanges{};   // dirty subtrees resolved
+    uint32_t numVisited{};  // slots walked
+    uint32_t numUpdated{};  // world matrices rebuilt
+};
+
+//----------------------------
+// Transform store - local TRS, local and world matrices of all frames in contiguous arrays (SoA).
+// Slots are kept in hierarchy pre-order: a parent always precedes its children and every subtree
+// occupies a contiguous range of slots, so all world matrices are resolved in one linear pass.
+// Bounds follow the same layout: each slot has its own world bbox, rebuilt together with the world
+// matrix, and bounds of its whole subtree, merged from children lazily by updateBounds().
+class I3D_transform_store {
+public:
+    I3D_xform create();
+    void reserve(uint32_t count);
+    void release(I3D_xform xf);
+    void copy(I3D_xform dst, I3D_xform src);
+
+    void setParent(I3D_xform xf, I3D_xform parent);
+    I3D_xform getParent(I3D_xform xf) const { return _parents[xf]; }
+
+    const glm::vec3& getPos(I3D_xform xf) const { return _pos[_slots[xf]]; }
+    void setPos(I3D_xform xf, const glm::vec3& pos);
+
+    const glm::quat& getRot(I3D_xform xf) const { return _rot[_slots[xf]]; }
+    void setRot(I3D_xform xf, const glm::quat& rot);
+
+    const glm::vec3& getScale(I3D_xform xf) const { return _scale[_slots[xf]]; }
+    void setScale(I3D_xform xf, const glm::vec3& scale);
+
+    // NOTE: returned references stay valid only until the next create / re-sort
+    const glm::mat4& getLocalMatrix(I3D_xform xf);
+    const glm::mat4& getMatrix(I3D_xform xf);
+    void setLocalMatrix(I3D_xform xf, const glm::mat4& mat);
+
+    // invalid bbox (default) = transform has nothing to bound on its own
+    const I3D_bbox& getLocalBBox(I3D_xform xf) const { return _localBox[_slots[xf]]; }
+    void setLocalBBox(I3D_xform xf, const I3D_bbox& bbox);
+
+    // world bbox of the transform alone / of its whole subtree (sphere radius < 0 if there is none)
+    const I3D_bbox& getWorldBBox(I3D_xform xf);
+    const I3D_bbox& getBoundBox(I3D_xform xf);
+    const I3D_bsphere& getBoundSphere(I3D_xform xf);
+
+    //----------------------------
+    // Re-sort slots if the hierarchy changed and resolve all dirty local / world matrices.
+    // Setters only put the transform on a dirty list; update() walks just the subtrees under
+    // dirty transforms, each one once, no matter how many times it was changed.
+    // With a job system, independent subtrees are resolved in parallel batches.
+    void update(I3D_jobs* jobs = nullptr);
+    const I3D_XFORM_STATS& getStats() const { return _stats; }
+
+    //----------------------------
+    // Merge subtree bounds of everything under transforms resolved since the last call, then up
+    // through their ancestors (children before parents). Called on demand by getBound*().
+    void updateBounds();
+
+    uint32_t getNumSlots() const { return uint32_t(_handles.size()); }
+    uint32_t getNumBatches() const { return uint32_t(_batches.size()); }
+private:
+    struct Batch {
+        uint32_t first;
+        uint32_t last;
+    };
+
+    void sort();
+    void buildBatches();
+    uint32_t updateRange(uint32_t first, uint32_t last);
+    void buildDirtyRanges();
+    void mergeBounds(uint32_t first, uint32_t last);
+    void mergeChildBounds(uint32_t slot);
+    void markDirty(uint32_t slot, uint8_t flags);
+
+    // per slot, hierarchy pre-order
+    ea::vector<glm::vec3> _pos{};
+    ea::vector<glm::quat> _rot{};
+    ea::vector<glm::vec3> _scale{};
+    ea::vector<glm::mat4> _local{};
+    ea::vector<glm::mat4> _world{};
+    ea::vector<I3D_bbox> _localBox{};
+    ea::vector<I3D_bbox> _worldBox{};
+    ea::vector<I3D_bbox> _boundBox{};       // whole subtree, valid after updateBounds()
+    ea::vector<I3D_bsphere> _boundSphere{};
+    ea::vector<uint32_t> _parentSlots{};
+    ea::vector<uint32_t> _subtreeEnd{};  // one past the last slot of the subtree
+    ea::vector<uint8_t> _flags{};
+    ea::vector<I3D_xform> _handles{};   // slot -> handle
+
+    // per handle
+    ea::vector<uint32_t> _slots{};      // handle -> slot
+    ea::vector<I3D_xform> _parents{};   // handle -> parent handle, source of truth for sorting
+    ea::vector<I3D_xform> _free{};
+    ea::vector<I3D_xform> _released{};  // freed on next sort, so orphans can't attach to a recycled handle
+
+    // parallel update: ancestors of big subtrees go first on the calling thread,
+    // then batches of whole small subtrees are independent of each other
+    ea::vector<uint32_t> _topSlots{};
+    ea::vector<Batch> _batches{};
+    uint32_t _numBatchedSlots{};
+
+    // handles changed since the last update, may contain duplicates and released handles
+    ea::vector<I3D_xform> _dirtyList{};
+    ea::vector<Batch> _dirtyRanges{};
+    I3D_XFORM_STATS _stats{};
+
+    // subtrees whose world bboxes changed since the last updateBounds()
+    ea::vector<Batch> _boundsRanges{};
+    bool _boundsAll{ false };
+
+    bool _orderDirty{ false };
+};
\ No newline at end of file
@@ -0,0 +1,64 @@
+#include "I3D_visual.h"
+#include "I3D_camera.h"
+
+I3D_LOD_VIEW::I3D_LOD_VIEW(I3D_camera* camera, float quality) :
+    eye(camera->getMatrix()[3]),
+    distanceScale(glm::tan(camera->getFOV() * 0.5f) / (glm::tan(I3D_LOD_REFERENCE_FOV * 0.5f) * quality)),
+    range(camera->getRange().y) {
+}
+
+//----------------------------
+
+I3D_visual::I3D_visual(I3D_driver* driver) :
+    I3D_frame(driver)
+{
+    _type = FRAME_VISUAL;
+}
+
+void I3D_visual::duplicate(I3D_frame* src) {
+    if(src->getFrameType() == FRAME_VISUAL) {
+        I3D_visual* visual = I3DCAST_VISUAL(src);
+        _visualType = visual->_visualType;
+        _renderFlags = visual->_renderFlags;
+        setMesh(visual->_mesh);
+    }
+
+    return I3D_frame::duplicate(src);
+}
+
+void I3D_visual::setMesh(const ea::shared_ptr<I3D_mesh>& mesh) {
+    _mesh = mesh;
+    _lod = NO_LOD;
+
+    I3D_bbox bbox;
+    if(_mesh)
+        bbox = _mesh->getBBox();
+    else
+        bbox.Invalidate();
+    getTransforms().setLocalBBox(_xform, bbox);
+}
+
+uint32_t I3D_visual::updateLod(const I3D_LOD_VIEW& view) {
+    const uint32_t numLods = _mesh ? _mesh->getNumLods() : 0;
+    const I3D_bbox& bbox = getWorldBBox();
+    if(!numLods || !bbox.IsValid()) return _lod = NO_LOD;
+
+    const glm::vec3 center = (bbox.min + bbox.max) * 0.5f;
+    const float radius = glm::length(bbox.max - bbox.min) * 0.5f;
+    const float distance = glm::length(center - view.eye);
+    if(distance - radius > view.range) return _lod = NO_LOD;
+
+    // LODs come nearest first; 'lowest' is reached moving away, 'highest' is kept moving closer
+    const float lodDistance = distance * view.distanceScale;
+    uint32_t lowest = 0, nearest = 0, highest = 0;
+    for(uint32_t i = 1; i < numLods; ++i) {
+        const float start = _mesh->getLod(i).distance;
+        if(lodDistance >= start * (1.0f + view.hysteresis)) lowest = i;
+        if(lodDistance >= start) nearest = i;
+        if(lodDistance >= start * (1.0f - view.hysteresis)) highest = i;
+    }
+
+    // coming back into the view, nothing to keep
+    _lod = _lod == NO_LOD || _lod >= numLods ? nearest : glm::clamp(_lod, lowest, highest);
+    return _lod;
+}
\ No newline at end of file
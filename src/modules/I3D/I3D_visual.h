@@ -0,0 +1,91 @@
+#pragma once
+#include "I3D_frame.h"
+#include "I3D_mesh.h"
+
+class I3D_camera;
+
+#include <EASTL/shared_ptr.h>
+namespace ea = eastl;
+
+#include <cfloat>
+
+// LS3D visual types, as stored in 4DS files
+enum I3D_VISUAL_TYPE : uint8_t {
+    VISUAL_OBJECT,
+    VISUAL_LITOBJECT,
+    VISUAL_SINGLEMESH,
+    VISUAL_SINGLEMORPH,
+    VISUAL_BILLBOARD,
+    VISUAL_MORPH,
+    VISUAL_LENSFLARE,
+    VISUAL_PROJECTOR,
+    VISUAL_MIRROR,
+    VISUAL_EMITOR,
+    VISUAL_SHADOW,
+    VISUAL_LANDPATCH,
+    VISUAL_LAST,
+};
+
+//----------------------------
+// What LOD selection needs of a camera. LOD distances of 4DS meshes are meant for a view of
+// I3D_LOD_REFERENCE_FOV, the distance to a visual is scaled by how much smaller it shows in the
+// camera's view than in that one, so a LOD follows the projected size - zooming in brings
+// detail back. Quality above 1 keeps detailed LODs further out.
+static constexpr float I3D_LOD_REFERENCE_FOV = 60.0f * 3.14159265f / 180.0f;
+
+struct I3D_LOD_VIEW {
+    I3D_LOD_VIEW() {}
+    I3D_LOD_VIEW(I3D_camera* camera, float quality = 1.0f);
+
+    glm::vec3 eye{};
+    float distanceScale{ 1.0f };    // camera distance to LOD distance
+    float range{ FLT_MAX };         // visuals whose bounds start further are out of the view
+    float hysteresis{ 0.1f };       // share of a LOD distance to move past before switching to it
+};
+
+//----------------------------
+// Renderable frame - instance of a (shared) mesh.
+class I3D_visual : public I3D_frame {
+public:
+    static constexpr uint32_t NO_LOD = ~0u;
+
+    I3D_visual(I3D_driver* driver);
+
+    void duplicate(I3D_frame* src);
+
+    void setVisualType(I3D_VISUAL_TYPE type) { _visualType = type; }
+    I3D_VISUAL_TYPE getVisualType() const { return _visualType; }
+
+    void setRenderFlags(uint32_t flags) { _renderFlags = flags; }
+    uint32_t getRenderFlags() const { return _renderFlags; }
+
+    // also sets the frame's local bbox to the mesh bounds
+    void setMesh(const ea::shared_ptr<I3D_mesh>& mesh);
+    const ea::shared_ptr<I3D_mesh>& getMesh() const { return _mesh; }
+
+    // Pick the LOD for a view by the distance to the center of the world bounds. Moving away,
+    // a coarser LOD is taken once past its distance plus the hysteresis, moving closer the
+    // current one is kept until its distance minus the hysteresis, so a visual near a boundary
+    // doesn't switch every frame. NO_LOD beyond the view range or without a mesh.
+    uint32_t updateLod(const I3D_LOD_VIEW& view);
+
+    // LOD picked by the last updateLod()
+    uint32_t getLod() const { return _lod; }
+private:
+    I3D_VISUAL_TYPE _visualType{ VISUAL_OBJECT };
+    uint32_t _renderFlags{};
+    ea::shared_ptr<I3D_mesh> _mesh{};
+    uint32_t _lod{ NO_LOD };
+};
+
+//----------------------------
+
+#ifdef _DEBUG
+inline I3D_visual* I3DCAST_VISUAL(I3D_frame* f){ return !f ? nullptr : f->getFrameType()!=FRAME_VISUAL ? nullptr : reinterpret_cast<I3D_visual*>(f); }
+inline const I3D_visual* I3DCAST_CVISUAL(const I3D_frame* f){ return !f ? nullptr : f->getFrameType()!=FRAME_VISUAL ? nullptr : static_cast<const I3D_visual*>(f); }
+#else
+inline I3D_visual* I3DCAST_VISUAL(I3D_frame* f){ return reinterpret_cast<I3D_visual*>(f); }
+inline const I3D_visual* I3DCAST_CVISUAL(const I3D_frame* f){ return static_cast<const I3D_visual*>(f); }
+#endif
+
+//----------------------------
\ No newline at end of file
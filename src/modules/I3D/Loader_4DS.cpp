@@ -0,0 +1,1124 @@
+#include "Loader_4DS.h"
+#include "I3D_driver.h"
+#include "I3D_material.h"
+#include "I3D_mesh.h"
+#include "I3D_atlas.h"
+
+#include <EASTL/hash_map.h>
+#include <EASTL/hash_set.h>
+#include <EASTL/sort.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+
+static constexpr uint16_t VERSION_4DS = 29;
+static constexpr uint32_t VERSION_COOKED = 5;
+static constexpr size_t COOKED_ALIGN = 16;
+
+// Maps up to this size are packed into atlas pages. Every map gets a border of repeated edge
+// texels and starts on a 4x4 block, so mip levels down to ATLAS_LEVELS - 1 and block compression
+// don't mix neighbours; deeper levels would, pages stop there.
+static constexpr uint32_t ATLAS_MAX_MAP = 128;
+static constexpr uint32_t ATLAS_BORDER = 4;
+static constexpr uint32_t ATLAS_LEVELS = 3;
+static constexpr float ATLAS_UV_EPSILON = 1.0f / 1024.0f;
+
+//----------------------------
+// Bounds-checked reads from the mapped file. Fields are packed and unaligned, so scalars are
+// copied out, arrays are returned as pointers into the file. A read past the end makes the
+// reader fail for good and return zeros, so it's enough to check once per record.
+class Loader_4DS::Reader {
+public:
+    Reader(const uint8_t* data, size_t size) :
+        _ptr(data),
+        _end(data + size) {
+    }
+
+    template<typename T>
+    T read() {
+        T value{};
+        if(check(sizeof(T))) {
+            memcpy(&value, _ptr, sizeof(T));
+            _ptr += sizeof(T);
+        }
+        return value;
+    }
+
+    const uint8_t* skip(size_t size) {
+        if(!check(size)) return nullptr;
+        const uint8_t* data = _ptr;
+        _ptr += size;
+        return data;
+    }
+
+    Text readText() {
+        Text text;
+        text.length = read<uint8_t>();
+        text.str = reinterpret_cast<const char*>(skip(text.length));
+        return text;
+    }
+
+    void fail() { _failed = true; }
+    bool failed() const { return _failed; }
+private:
+    bool check(size_t size) {
+        if(!_failed && size_t(_end - _ptr) >= size) return true;
+        _failed = true;
+        return false;
+    }
+
+    const uint8_t* _ptr{ nullptr };
+    const uint8_t* _end{ nullptr };
+    bool _failed{ false };
+};
+
+// faces index only existing vertices, so a broken file can't make the device read outside buffers
+static bool checkFaces(const uint8_t* faces, uint32_t numFaces, uint32_t numVertices) {
+    for(uint32_t i = 0; i < numFaces * 3; ++i) {
+        uint16_t index;
+        memcpy(&index, faces + i * sizeof(uint16_t), sizeof(uint16_t));
+        if(index >= numVertices) return false;
+    }
+    return true;
+}
+
+static I3D_name makeName(const char* str, uint8_t length) {
+    return str ? I3D_name(str, length) : I3D_name();
+}
+
+using Clock = std::chrono::steady_clock;
+
+static float elapsedMs(Clock::time_point start) {
+    return std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+}
+
+//----------------------------
+
+Loader_4DS::Loader_4DS(I3D_driver* driver) :
+    _driver(driver) {
+}
+
+I3D_RESULT Loader_4DS::load(const char* filename, I3D_frame* root) {
+    I3D_RESULT result = open(filename);
+    if(result == I3D_OK)
+        result = create(root);
+
+    close();
+    return result;
+}
+
+I3D_RESULT Loader_4DS::open(const char* filename) {
+    close();
+    if(!_file.open(filename)) return I3DERR_FILENOTFOUND;
+
+    const Clock::time_point start = Clock::now();
+    const I3D_RESULT result = parse();
+    _stats.parseMs = elapsedMs(start);
+
+    if(result != I3D_OK) close();
+    return result;
+}
+
+void Loader_4DS::close() {
+    _materials.clear();
+    _frames.clear();
+    _lods.clear();
+    _faceGroups.clear();
+    _portals.clear();
+    _textures.clear();
+    _atlasVertices.clear();
+    _sourceHash = 0;
+    _file.close();
+}
+
+//----------------------------
+
+I3D_RESULT Loader_4DS::parse() {
+    Reader reader(_file.getData(), _file.getSize());
+    _stats = {};
+
+    const uint8_t* magic = reader.skip(4);
+    if(!magic || memcmp(magic, "4DS", 4) != 0) return I3DERR_BADFORMAT;
+    if(reader.read<uint16_t>() != VERSION_4DS) return I3DERR_UNSUPPORTED;
+    reader.read<uint64_t>(); // timestamp
+
+    _materials.resize(reader.read<uint16_t>());
+    for(Material& material : _materials)
+        parseMaterial(reader, material);
+
+    _frames.resize(reader.read<uint16_t>());
+    for(Frame& frame : _frames) {
+        const I3D_RESULT result = parseFrame(reader, frame);
+        if(result != I3D_OK) return result;
+    }
+
+    return reader.failed() ? I3DERR_BADFORMAT : checkReferences();
+}
+
+//----------------------------
+// Check references between records, so create() can follow them blindly. Face indices of meshes
+// are checked later by the build stage.
+I3D_RESULT Loader_4DS::checkReferences() const {
+    for(uint32_t i = 0; i < _frames.size(); ++i) {
+        const Frame& frame = _frames[i];
+
+        // references go back to frames already parsed
+        if(frame.parent > i || frame.instance > i) return I3DERR_BADFORMAT;
+        if(frame.instance && _frames[frame.instance - 1].numLods == 0) return I3DERR_BADFORMAT;
+
+        if(frame.firstLod + uint64_t(frame.numLods) > _lods.size()) return I3DERR_BADFORMAT;
+        if(frame.firstPortal + uint64_t(frame.numPortals) > _portals.size()) return I3DERR_BADFORMAT;
+        if(frame.hullFaces && !checkFaces(frame.hullFaces, frame.numHullFaces, frame.numHullVertices)) return I3DERR_BADFORMAT;
+    }
+
+    for(const Lod& lod : _lods) {
+        if(lod.firstFaceGroup + uint64_t(lod.numFaceGroups) > _faceGroups.size()) return I3DERR_BADFORMAT;
+    }
+
+    for(const FaceGroup& faceGroup : _faceGroups) {
+        if(faceGroup.material > _materials.size()) return I3DERR_BADFORMAT;
+    }
+
+    return I3D_OK;
+}
+
+void Loader_4DS::parseMaterial(Reader& reader, Material& material) {
+    material = {};
+    material.flags = reader.read<uint32_t>();
+    material.ambient = reader.read<glm::vec3>();
+    material.diffuse = reader.read<glm::vec3>();
+    material.emissive = reader.read<glm::vec3>();
+    material.alpha = reader.read<float>();
+
+    if(material.flags & MTLFLAGS_ENV_TEXTURE) {
+        material.envRatio = reader.read<float>();
+        material.maps[MTLMAP_ENV] = reader.readText();
+    }
+
+    material.maps[MTLMAP_DIFFUSE] = reader.readText();
+    if(material.flags & MTLFLAGS_ALPHA_TEXTURE)
+        material.maps[MTLMAP_ALPHA] = reader.readText();
+
+    if(material.flags & MTLFLAGS_ANIMATED_DIFFUSE) {
+        material.animFrames = reader.read<uint32_t>();
+        reader.skip(sizeof(uint16_t));
+        material.animDelay = reader.read<uint32_t>();
+        reader.skip(2 * sizeof(uint32_t));
+    }
+}
+
+I3D_RESULT Loader_4DS::parseFrame(Reader& reader, Frame& frame) {
+    frame = {};
+    frame.type = reader.read<uint8_t>();
+    if(frame.type == FRAME_VISUAL) {
+        frame.visualType = reader.read<uint8_t>();
+        frame.renderFlags = reader.read<uint16_t>();
+    }
+
+    frame.parent = reader.read<uint16_t>();
+    frame.pos = reader.read<glm::vec3>();
+    frame.scale = reader.read<glm::vec3>();
+
+    // stored as w, x, y, z
+    const glm::vec4 rot = reader.read<glm::vec4>();
+    frame.rot = glm::quat(rot.x, rot.y, rot.z, rot.w);
+
+    reader.read<uint8_t>(); // culling flags
+    frame.name = reader.readText();
+    reader.readText();      // user properties
+    frame.bbox.Invalidate();
+
+    switch(frame.type) {
+    case FRAME_VISUAL:
+        switch(frame.visualType) {
+        case VISUAL_OBJECT:
+        case VISUAL_LITOBJECT:
+            parseMesh(reader, frame);
+            break;
+
+        case VISUAL_BILLBOARD:
+            parseMesh(reader, frame);
+            reader.read<uint32_t>();    // rotation axis
+            reader.read<uint8_t>();     // rotate around the camera
+            break;
+
+        case VISUAL_LENSFLARE: {
+            const uint8_t numGlows = reader.read<uint8_t>();
+            reader.skip(numGlows * (sizeof(float) + sizeof(uint16_t)));
+            break;
+        }
+
+        case VISUAL_MIRROR: {
+            frame.bbox.min = reader.read<glm::vec3>();
+            frame.bbox.max = reader.read<glm::vec3>();
+            reader.skip(4 * sizeof(float));     // unknown
+            reader.skip(16 * sizeof(float));    // reflection matrix
+            reader.skip(3 * sizeof(float));     // background color
+            reader.read<float>();               // view distance
+            const uint32_t numVertices = reader.read<uint32_t>();
+            const uint32_t numFaces = reader.read<uint32_t>();
+            reader.skip(size_t(numVertices) * sizeof(glm::vec3));
+            reader.skip(size_t(numFaces) * 3 * sizeof(uint16_t));
+            break;
+        }
+
+        default:
+            // skinned and morphed meshes
+            return I3DERR_UNSUPPORTED;
+        }
+        break;
+
+    case FRAME_SECTOR:
+        parseSector(reader, frame);
+        break;
+
+    case FRAME_DUMMY:
+        frame.bbox.min = reader.read<glm::vec3>();
+        frame.bbox.max = reader.read<glm::vec3>();
+        break;
+
+    case FRAME_reserved: {
+        // target - keeps linked frames facing it
+        reader.read<uint16_t>();
+        const uint8_t numLinks = reader.read<uint8_t>();
+        reader.skip(numLinks * sizeof(uint16_t));
+        break;
+    }
+
+    case FRAME_JOINT:
+        reader.skip(16 * sizeof(float));    // bind matrix
+        reader.read<uint32_t>();            // joint id
+        break;
+
+    case FRAME_OCCLUDER: {
+        const uint32_t numVertices = reader.read<uint32_t>();
+        const uint32_t numFaces = reader.read<uint32_t>();
+        frame.hullVertices = reader.skip(size_t(numVertices) * sizeof(glm::vec3));
+        frame.numHullVertices = numVertices;
+        frame.hullFaces = reader.skip(size_t(numFaces) * 3 * sizeof(uint16_t));
+        frame.numHullFaces = numFaces;
+        break;
+    }
+
+    default:
+        return I3DERR_BADFORMAT;
+    }
+
+    return reader.failed() ? I3DERR_BADFORMAT : I3D_OK;
+}
+
+void Loader_4DS::parseMesh(Reader& reader, Frame& frame) {
+    frame.instance = reader.read<uint16_t>();
+    if(frame.instance) return;
+
+    frame.firstLod = uint32_t(_lods.size());
+    frame.numLods = reader.read<uint8_t>();
+    for(uint32_t l = 0; l < frame.numLods && !reader.failed(); ++l) {
+        Lod lod{};
+        lod.distance = reader.read<float>();
+        lod.numVertices = reader.read<uint16_t>();
+        lod.vertices = reader.skip(size_t(lod.numVertices) * sizeof(I3D_vertex));
+        lod.firstFaceGroup = uint32_t(_faceGroups.size());
+        lod.numFaceGroups = reader.read<uint8_t>();
+
+        for(uint32_t f = 0; f < lod.numFaceGroups && !reader.failed(); ++f) {
+            FaceGroup faceGroup{};
+            faceGroup.numFaces = reader.read<uint16_t>();
+            faceGroup.faces = reader.skip(size_t(faceGroup.numFaces) * 3 * sizeof(uint16_t));
+            faceGroup.material = reader.read<uint16_t>();
+            _faceGroups.push_back(faceGroup);
+        }
+        _lods.push_back(lod);
+    }
+}
+
+void Loader_4DS::parseSector(Reader& reader, Frame& frame) {
+    reader.skip(2 * sizeof(uint32_t));  // flags
+    const uint32_t numVertices = reader.read<uint32_t>();
+    const uint32_t numFaces = reader.read<uint32_t>();
+    frame.hullVertices = reader.skip(size_t(numVertices) * sizeof(glm::vec3));
+    frame.numHullVertices = numVertices;
+    frame.hullFaces = reader.skip(size_t(numFaces) * 3 * sizeof(uint16_t));
+    frame.numHullFaces = numFaces;
+    frame.bbox.min = reader.read<glm::vec3>();
+    frame.bbox.max = reader.read<glm::vec3>();
+
+    frame.firstPortal = uint32_t(_portals.size());
+    frame.numPortals = reader.read<uint8_t>();
+    for(uint32_t p = 0; p < frame.numPortals && !reader.failed(); ++p) {
+        Portal portal{};
+        portal.numVertices = reader.read<uint8_t>();
+        portal.flags = reader.read<uint32_t>();
+        reader.skip(6 * sizeof(float));     // plane and ranges, planes are rebuilt from the vertices
+        portal.vertices = reader.skip(size_t(portal.numVertices) * sizeof(glm::vec3));
+        _portals.push_back(portal);
+    }
+}
+
+//----------------------------
+
+I3D_RESULT Loader_4DS::create(I3D_frame* root) {
+    assert(root);
+    if(!_file.isOpen()) return I3DERR_FILENOTFOUND;
+
+    ea::vector<ea::shared_ptr<I3D_material>> materials(_materials.size());
+    for(uint32_t i = 0; i < _materials.size(); ++i) {
+        const Material& src = _materials[i];
+        auto material = ea::make_shared<I3D_material>();
+        material->setFlags(src.flags);
+        material->setAmbient(src.ambient);
+        material->setDiffuse(src.diffuse);
+        material->setEmissive(src.emissive);
+        material->setAlpha(src.alpha);
+        material->setEnvRatio(src.envRatio);
+        for(int map = 0; map < MTLMAP_LAST; ++map)
+            material->setMapName(I3D_MATERIAL_MAP(map), makeName(src.maps[map].str, src.maps[map].length));
+        material->setAnimation(src.animFrames, src.animDelay);
+        materials[i] = material;
+    }
+
+    // textures first, packing them into an atlas moves UVs the meshes are built from
+    Clock::time_point start = Clock::now();
+    decodeTextures(false);
+    _stats.decodeMs = elapsedMs(start);
+
+    start = Clock::now();
+    ea::vector<ea::shared_ptr<I3D_mesh>> meshes(_frames.size());
+    const I3D_RESULT result = buildMeshes(materials, meshes);
+    _stats.buildMs = elapsedMs(start);
+    if(result != I3D_OK) return result;
+
+    start = Clock::now();
+    ea::vector<I3D_frame*> frames(_frames.size());
+    _driver->getTransforms().reserve(uint32_t(_frames.size()));
+
+    for(uint32_t i = 0; i < _frames.size(); ++i) {
+        const Frame& src = _frames[i];
+        I3D_frame* frame = nullptr;
+
+        switch(src.type) {
+        case FRAME_VISUAL: {
+            I3D_visual* visual = I3DCAST_VISUAL(_driver->createFrame(FRAME_VISUAL));
+            visual->setVisualType(I3D_VISUAL_TYPE(src.visualType));
+            visual->setRenderFlags(src.renderFlags);
+
+            if(src.instance) meshes[i] = meshes[src.instance - 1];
+            visual->setMesh(meshes[i]);
+            frame = visual;
+            break;
+        }
+
+        case FRAME_SECTOR: {
+            I3D_sector* sector = I3DCAST_SECTOR(_driver->createFrame(FRAME_SECTOR));
+            sector->setBBox(src.bbox);
+
+            ea::vector<glm::vec3> vertices(src.numHullVertices);
+            ea::vector<uint16_t> indices(src.numHullFaces * 3);
+            if(!vertices.empty()) memcpy(vertices.data(), src.hullVertices, vertices.size() * sizeof(glm::vec3));
+            if(!indices.empty()) memcpy(indices.data(), src.hullFaces, indices.size() * sizeof(uint16_t));
+            sector->setHull(ea::move(vertices), ea::move(indices));
+
+            for(uint32_t p = src.firstPortal; p < src.firstPortal + src.numPortals; ++p) {
+                I3D_portal portal;
+                portal.flags = _portals[p].flags;
+                portal.vertices.resize(_portals[p].numVertices);
+                if(!portal.vertices.empty()) memcpy(portal.vertices.data(), _portals[p].vertices, portal.vertices.size() * sizeof(glm::vec3));
+                sector->addPortal(ea::move(portal));
+            }
+
+            frame = sector;
+            break;
+        }
+
+        case FRAME_DUMMY: {
+            I3D_dummy* dummy = I3DCAST_DUMMY(_driver->createFrame(FRAME_DUMMY));
+            dummy->setBBox(src.bbox);
+            frame = dummy;
+            break;
+        }
+
+        case FRAME_OCCLUDER: {
+            I3D_occluder* occluder = I3DCAST_OCCLUDER(_driver->createFrame(FRAME_OCCLUDER));
+            ea::vector<glm::vec3> vertices(src.numHullVertices);
+            ea::vector<uint16_t> indices(src.numHullFaces * 3);
+            if(!vertices.empty()) memcpy(vertices.data(), src.hullVertices, vertices.size() * sizeof(glm::vec3));
+            if(!indices.empty()) memcpy(indices.data(), src.hullFaces, indices.size() * sizeof(uint16_t));
+            occluder->setMesh(ea::move(vertices), ea::move(indices));
+            frame = occluder;
+            break;
+        }
+
+        default:
+            // targets and joints have no frame class yet, only their place in the hierarchy is kept
+            frame = _driver->createFrame(FRAME_NULL);
+            break;
+        }
+
+        frame->setName(makeName(src.name.str, src.name.length));
+        glm::vec3 pos = src.pos;
+        frame->setPos(pos);
+        frame->setRot(src.rot);
+        frame->setScale(src.scale);
+
+        // parent holds the only reference
+        I3D_frame* parent = src.parent ? frames[src.parent - 1] : root;
+        parent->addChild(frame);
+        frame->release();
+        frames[i] = frame;
+    }
+    _stats.createMs = elapsedMs(start);
+    _stats.numFrames = uint32_t(_frames.size());
+
+    // buffers are created from the mapping, so this has to happen before close()
+    start = Clock::now();
+    IDevice* device = _driver->getDevice();
+    for(uint32_t i = 0; i < _frames.size(); ++i) {
+        if(!_frames[i].instance && meshes[i]) meshes[i]->upload(device);
+    }
+    uploadTextures(materials);
+    _stats.uploadMs = elapsedMs(start);
+
+    return I3D_OK;
+}
+
+//----------------------------
+// Validate face indices and build meshes, one job per mesh. Meshes only reference the mapping,
+// their buffers are created in the upload stage.
+I3D_RESULT Loader_4DS::buildMeshes(const ea::vector<ea::shared_ptr<I3D_material>>& materials, ea::vector<ea::shared_ptr<I3D_mesh>>& meshes) {
+    ea::vector<uint32_t> meshFrames;
+    for(uint32_t i = 0; i < _frames.size(); ++i) {
+        if(_frames[i].type == FRAME_VISUAL && !_frames[i].instance && _frames[i].numLods)
+            meshFrames.push_back(i);
+    }
+
+    std::atomic<bool> failed{ false };
+    _driver->getJobs().parallelFor(uint32_t(meshFrames.size()), [&](uint32_t job) {
+        const Frame& src = _frames[meshFrames[job]];
+        auto mesh = ea::make_shared<I3D_mesh>();
+
+        for(uint32_t l = src.firstLod; l < src.firstLod + src.numLods; ++l) {
+            const Lod& lod = _lods[l];
+            I3D_mesh_lod& meshLod = mesh->addLod(lod.distance, lod.vertices, lod.numVertices);
+            for(uint32_t f = lod.firstFaceGroup; f < lod.firstFaceGroup + lod.numFaceGroups; ++f) {
+                const FaceGroup& faceGroup = _faceGroups[f];
+                if(!checkFaces(faceGroup.faces, faceGroup.numFaces, lod.numVertices)) {
+                    failed = true;
+                    return;
+                }
+                mesh->addFaceGroup(meshLod, faceGroup.material ? materials[faceGroup.material - 1] : nullptr, faceGroup.faces, faceGroup.numFaces * 3);
+            }
+        }
+
+        I3D_bbox bbox;
+        bbox.Invalidate();
+        const Lod& lod = _lods[src.firstLod];
+        for(uint32_t v = 0; v < lod.numVertices; ++v) {
+            glm::vec3 pos;
+            memcpy(&pos, lod.vertices + v * sizeof(I3D_vertex), sizeof(pos));
+            bbox.min = glm::min(bbox.min, pos);
+            bbox.max = glm::max(bbox.max, pos);
+        }
+        mesh->setBBox(bbox);
+        meshes[meshFrames[job]] = mesh;
+    });
+
+    _stats.numMeshes = uint32_t(meshFrames.size());
+    return failed ? I3DERR_BADFORMAT : I3D_OK;
+}
+
+// textures are cached by path, so models from different directories don't mix up their maps
+I3D_CREATETEXTURE Loader_4DS::textureParams(const Texture& texture) const {
+    I3D_CREATETEXTURE params{};
+    params._flags = TXTMAP_DIFFUSE;
+    params._width = texture.width;
+    params._height = texture.height;
+    params._numLevels = texture.numLevels;
+    params._format = texture.format;
+    params._diffuse = I3D_name((_texturePath + texture.name.c_str()).c_str());
+    if(!texture.opName.empty()) {
+        params._flags |= TXTMAP_OPACITY;
+        params._op = I3D_name((_texturePath + texture.opName.c_str()).c_str());
+    }
+    return params;
+}
+
+//----------------------------
+// Decode each distinct diffuse and environment map once, one job per texture. A map that
+// can't be loaded leaves its materials untextured. Textures of a cooked model are ready,
+// maps already in the driver's texture cache are skipped unless 'all' is set - or an atlas
+// is built, packing needs the size of every map.
+void Loader_4DS::decodeTextures(bool all) {
+    if(!_textures.empty()) return;
+
+    ea::hash_set<uint64_t> unique;
+    for(const Material& material : _materials) {
+        for(I3D_MATERIAL_MAP map : { MTLMAP_DIFFUSE, MTLMAP_ENV }) {
+            const Text& text = material.maps[map];
+            if(!text.str || !text.length) continue;
+
+            const I3D_name name(text.str, text.length);
+            const Text& opText = material.maps[MTLMAP_ALPHA];
+            const I3D_name opName = map == MTLMAP_DIFFUSE ? makeName(opText.str, opText.length) : I3D_name();
+            if(!unique.insert(textureKey(name, opName)).second) continue;
+
+            _textures.push_back();
+            _textures.back().name = name;
+            _textures.back().opName = opName;
+        }
+    }
+
+    ea::vector<uint32_t> decode;
+    for(uint32_t i = 0; i < _textures.size(); ++i) {
+        if(all || _atlasSize || !_driver->getTextureCache().find(textureParams(_textures[i])))
+            decode.push_back(i);
+    }
+
+    _driver->getJobs().parallelFor(uint32_t(decode.size()), [this, &decode](uint32_t i) {
+        Texture& texture = _textures[decode[i]];
+        const ea::string path = _texturePath + texture.name.c_str();
+        if(!texture.image.load(path.c_str())) return;
+
+        if(!texture.opName.empty()) {
+            I3D_image opacity;
+            const ea::string opPath = _texturePath + texture.opName.c_str();
+            if(opacity.load(opPath.c_str())) texture.image.mergeAlpha(opacity);
+        }
+    });
+
+    if(_atlasSize) buildAtlas(all);
+
+    const bool compress = _driver->getTextureLoader().isCompressing();
+    _driver->getJobs().parallelFor(uint32_t(_textures.size()), [this, compress](uint32_t i) {
+        Texture& texture = _textures[i];
+        if(!texture.image.isValid()) return;
+
+        texture.image.generateMips(I3D_GetMipmapFlags(textureParams(texture)), texture.maxLevels);
+        if(compress) texture.image.compress();
+
+        texture.pixels = texture.image.getData();
+        texture.width = texture.image.getWidth();
+        texture.height = texture.image.getHeight();
+        texture.numLevels = texture.image.getNumLevels();
+        texture.format = texture.image.getFormat();
+    });
+}
+
+//----------------------------
+// Pack small diffuse maps into pages and move the UVs of their faces there. A map is packed only
+// if its faces keep their UVs in 0..1, as tiling can't wrap inside a page, and share no vertices
+// with faces of another map. Maps with alpha go to pages of their own, so opaque pages still
+// compress to BC1. Pages are textures of the model, named by its content.
+void Loader_4DS::buildAtlas(bool all) {
+    static constexpr uint32_t NONE = ~0u;
+    const uint32_t numTextures = uint32_t(_textures.size());
+
+    ea::hash_map<uint64_t, uint32_t> indices;
+    ea::vector<bool> packable(numTextures);
+    for(uint32_t i = 0; i < numTextures; ++i) {
+        const I3D_image& image = _textures[i].image;
+        indices[textureKey(_textures[i].name, _textures[i].opName)] = i;
+        packable[i] = image.isValid() && image.getWidth() <= ATLAS_MAX_MAP && image.getHeight() <= ATLAS_MAX_MAP;
+    }
+
+    // environment and animated maps keep their own textures
+    ea::vector<uint32_t> materialTextures(_materials.size(), NONE);
+    for(uint32_t m = 0; m < _materials.size(); ++m) {
+        const Material& material = _materials[m];
+        const Text& diffuse = material.maps[MTLMAP_DIFFUSE];
+        const Text& opacity = material.maps[MTLMAP_ALPHA];
+        const Text& env = material.maps[MTLMAP_ENV];
+
+        const auto it = indices.find(textureKey(makeName(diffuse.str, diffuse.length), makeName(opacity.str, opacity.length)));
+        if(diffuse.length && it != indices.end()) {
+            materialTextures[m] = it->second;
+            if(material.flags & MTLFLAGS_ANIMATED_DIFFUSE) packable[it->second] = false;
+        }
+
+        const auto envIt = indices.find(textureKey(makeName(env.str, env.length), I3D_name()));
+        if(env.length && envIt != indices.end()) packable[envIt->second] = false;
+    }
+
+    auto faceGroupTexture = [&](const FaceGroup& faceGroup) {
+        return faceGroup.material ? materialTextures[faceGroup.material - 1] : NONE;
+    };
+
+    auto readUV = [](const uint8_t* vertices, uint32_t index) {
+        glm::vec2 uv;
+        memcpy(&uv, vertices + size_t(index) * sizeof(I3D_vertex) + offsetof(I3D_vertex, uv), sizeof(uv));
+        return uv;
+    };
+
+    // faces with indices out of range fail the build stage, here they are just skipped
+    ea::vector<uint32_t> owners;
+    for(const Lod& lod : _lods) {
+        owners.assign(lod.numVertices, NONE);
+        for(uint32_t f = lod.firstFaceGroup; f < lod.firstFaceGroup + lod.numFaceGroups; ++f) {
+            const FaceGroup& faceGroup = _faceGroups[f];
+            const uint32_t texture = faceGroupTexture(faceGroup);
+            if(texture == NONE) continue;
+
+            for(uint32_t i = 0; i < faceGroup.numFaces * 3; ++i) {
+                uint16_t index;
+                memcpy(&index, faceGroup.faces + i * sizeof(uint16_t), sizeof(uint16_t));
+                if(index >= lod.numVertices) continue;
+
+                uint32_t& owner = owners[index];
+                if(owner == NONE) {
+                    owner = texture;
+                    const glm::vec2 uv = readUV(lod.vertices, index);
+                    const bool inside = glm::all(glm::greaterThanEqual(uv, glm::vec2(-ATLAS_UV_EPSILON))) &&
+                                        glm::all(glm::lessThanEqual(uv, glm::vec2(1.0f + ATLAS_UV_EPSILON)));
+                    if(!inside) packable[texture] = false;
+                } else if(owner != texture) {
+                    packable[owner] = packable[texture] = false;
+                }
+            }
+        }
+    }
+
+    // tallest first, cells rounded up to whole blocks
+    ea::vector<uint32_t> order;
+    for(uint32_t i = 0; i < numTextures; ++i) {
+        if(packable[i]) order.push_back(i);
+    }
+    ea::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+        const I3D_image& imageA = _textures[a].image;
+        const I3D_image& imageB = _textures[b].image;
+        if(imageA.getHeight() != imageB.getHeight()) return imageA.getHeight() > imageB.getHeight();
+        if(imageA.getWidth() != imageB.getWidth()) return imageA.getWidth() > imageB.getWidth();
+        return a < b;
+    });
+
+    struct Page {
+        I3D_atlas atlas;
+        bool alpha;
+        ea::vector<uint32_t> maps;
+    };
+    ea::vector<Page> pages;
+    ea::vector<glm::uvec4> rects(numTextures);    // x, y, width, height of the maps in their pages
+    for(uint32_t t : order) {
+        const I3D_image& image = _textures[t].image;
+        const uint32_t width = (image.getWidth() + 2 * ATLAS_BORDER + 3) & ~3u;
+        const uint32_t height = (image.getHeight() + 2 * ATLAS_BORDER + 3) & ~3u;
+        const bool alpha = !_textures[t].opName.empty();
+
+        Page* target = nullptr;
+        uint32_t x, y;
+        for(Page& page : pages) {
+            if(page.alpha == alpha && page.atlas.insert(width, height, x, y)) {
+                target = &page;
+                break;
+            }
+        }
+        if(!target) {
+            pages.push_back(Page{ I3D_atlas(_atlasSize, _atlasSize), alpha, {} });
+            if(!pages.back().atlas.insert(width, height, x, y)) {
+                pages.pop_back();
+                continue;
+            }
+            target = &pages.back();
+        }
+        target->maps.push_back(t);
+        rects[t] = glm::uvec4(x + ATLAS_BORDER, y + ATLAS_BORDER, image.getWidth(), image.getHeight());
+    }
+
+    // a page of one map would only add borders
+    ea::vector<uint32_t> pageTextures;
+    if(!_sourceHash) _sourceHash = I3D_HashData(_file.getData(), _file.getSize());
+    for(uint32_t p = 0; p < pages.size(); ++p) {
+        if(pages[p].maps.size() < 2) continue;
+
+        char name[64];
+        snprintf(name, sizeof(name), "atlas/%016llx/%u", static_cast<unsigned long long>(_sourceHash), p);
+
+        // an alpha page is its own opacity map, so it gets alpha tested mips
+        Texture page{};
+        page.name = I3D_name(name);
+        page.opName = pages[p].alpha ? page.name : I3D_name();
+        page.width = _atlasSize;
+        page.height = (pages[p].atlas.getUsedHeight() + 3) & ~3u;
+        page.maxLevels = ATLAS_LEVELS;
+        _textures.push_back(ea::move(page));
+        pageTextures.push_back(p);
+
+        for(uint32_t t : pages[p].maps)
+            _textures[t].page = uint32_t(_textures.size());
+    }
+
+    // pages already in the texture cache aren't composed again
+    _driver->getJobs().parallelFor(uint32_t(pageTextures.size()), [&](uint32_t i) {
+        const Page& src = pages[pageTextures[i]];
+        Texture& page = _textures[numTextures + i];
+        if(all || !_driver->getTextureCache().find(textureParams(page))) {
+            if(page.image.create(page.width, page.height)) {
+                for(uint32_t t : src.maps)
+                    page.image.blit(_textures[t].image, rects[t].x, rects[t].y, ATLAS_BORDER);
+            }
+        }
+        for(uint32_t t : src.maps)
+            _textures[t].image.release();
+    });
+
+    // move the UVs of packed maps, lods they touch get a copy of their vertices
+    for(Lod& lod : _lods) {
+        owners.assign(lod.numVertices, NONE);
+        bool packed = false;
+        for(uint32_t f = lod.firstFaceGroup; f < lod.firstFaceGroup + lod.numFaceGroups; ++f) {
+            const FaceGroup& faceGroup = _faceGroups[f];
+            const uint32_t texture = faceGroupTexture(faceGroup);
+            if(texture == NONE || !_textures[texture].page) continue;
+
+            for(uint32_t i = 0; i < faceGroup.numFaces * 3; ++i) {
+                uint16_t index;
+                memcpy(&index, faceGroup.faces + i * sizeof(uint16_t), sizeof(uint16_t));
+                if(index < lod.numVertices) owners[index] = texture;
+            }
+            packed = true;
+        }
+        if(!packed) continue;
+
+        ea::vector<uint8_t> vertices(lod.vertices, lod.vertices + size_t(lod.numVertices) * sizeof(I3D_vertex));
+        for(uint32_t v = 0; v < lod.numVertices; ++v) {
+            if(owners[v] == NONE) continue;
+
+            const glm::vec4 rect(rects[owners[v]]);
+            const Texture& page = _textures[_textures[owners[v]].page - 1];
+            const glm::vec2 uv = (glm::vec2(rect.x, rect.y) + readUV(lod.vertices, v) * glm::vec2(rect.z, rect.w)) / glm::vec2(page.width, page.height);
+            memcpy(vertices.data() + size_t(v) * sizeof(I3D_vertex) + offsetof(I3D_vertex, uv), &uv, sizeof(uv));
+        }
+        _atlasVertices.push_back(ea::move(vertices));
+        lod.vertices = _atlasVertices.back().data();
+    }
+}
+
+void Loader_4DS::uploadTextures(const ea::vector<ea::shared_ptr<I3D_material>>& materials) {
+    I3D_texture_cache& cache = _driver->getTextureCache();
+    ea::hash_map<uint64_t, ea::shared_ptr<I3D_texture_base>> textures;
+    ea::vector<bool> isPage(_textures.size(), false);
+    for(const Texture& src : _textures) {
+        if(src.page) isPage[src.page - 1] = true;
+    }
+
+    for(uint32_t i = 0; i < _textures.size(); ++i) {
+        const Texture& src = _textures[i];
+        if(src.page) continue;
+
+        const I3D_CREATETEXTURE params = textureParams(src);
+        ea::shared_ptr<I3D_texture> texture = src.pixels ? cache.get(params, src.pixels) : cache.find(params);
+        if(!texture) continue;
+
+        // pages exist only in memory, once evicted they couldn't be loaded again
+        if(isPage[i]) texture->setPinned(true);
+
+        textures[textureKey(src.name, src.opName)] = texture;
+        ++_stats.numTextures;
+    }
+
+    // a packed map is its page
+    for(const Texture& src : _textures) {
+        if(!src.page) continue;
+
+        const Texture& page = _textures[src.page - 1];
+        auto it = textures.find(textureKey(page.name, page.opName));
+        if(it == textures.end()) continue;
+
+        const ea::shared_ptr<I3D_texture_base> texture = it->second;
+        textures[textureKey(src.name, src.opName)] = texture;
+    }
+
+    // the alpha map has no texture of its own, it's in the alpha of the diffuse one
+    for(const auto& material : materials) {
+        for(I3D_MATERIAL_MAP map : { MTLMAP_DIFFUSE, MTLMAP_ENV }) {
+            const I3D_name& opName = map == MTLMAP_DIFFUSE ? material->getMapName(MTLMAP_ALPHA) : I3D_name();
+            auto it = textures.find(textureKey(material->getMapName(map), opName));
+            if(it != textures.end()) material->setTexture(map, it->second);
+        }
+    }
+}
+
+//----------------------------
+// Cooked file layout: header, data (strings, vertices, indices, pixels) and record sections.
+// Records are the loader's own, with pointers stored as offsets from the start of the file
+// (0 = null), so they are only valid for the pointer size that wrote them.
+enum COOKED_SECTION {
+    SECTION_MATERIALS,
+    SECTION_FRAMES,
+    SECTION_LODS,
+    SECTION_FACEGROUPS,
+    SECTION_PORTALS,
+    SECTION_TEXTURES,
+    SECTION_LAST,
+};
+
+struct CookedHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t sourceHash;
+    uint64_t size;
+    uint32_t pointerSize;
+    uint32_t count[SECTION_LAST];
+    uint64_t offset[SECTION_LAST];
+};
+
+struct CookedTexture {
+    uint64_t name;
+    uint64_t opName;
+    uint64_t pixels;
+    uint32_t nameLength;
+    uint32_t opNameLength;
+    uint32_t width;
+    uint32_t height;
+    uint32_t numLevels;
+    uint32_t format;
+    uint32_t page;
+    uint32_t reserved;
+};
+
+//----------------------------
+// Builds the cooked file in memory; data is appended, pointers into it are returned as offsets.
+class Loader_4DS::Writer {
+public:
+    Writer() {
+        _data.resize(sizeof(CookedHeader), 0);
+    }
+
+    uint64_t write(const void* data, size_t size, size_t align) {
+        if(!data || !size) return 0;
+
+        _data.resize((_data.size() + align - 1) & ~(align - 1), 0);
+        const uint64_t offset = _data.size();
+        _data.insert(_data.end(), static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + size);
+        return offset;
+    }
+
+    template<typename T>
+    T* writePtr(T* data, size_t size, size_t align = COOKED_ALIGN) {
+        return reinterpret_cast<T*>(uintptr_t(write(data, size, align)));
+    }
+
+    template<typename T>
+    void writeSection(CookedHeader& header, COOKED_SECTION section, const ea::vector<T>& records) {
+        header.count[section] = uint32_t(records.size());
+        header.offset[section] = records.empty() ? 0 : write(records.data(), records.size() * sizeof(T), COOKED_ALIGN);
+    }
+
+    ea::vector<uint8_t>& getData() { return _data; }
+private:
+    ea::vector<uint8_t> _data{};
+};
+
+//----------------------------
+
+I3D_RESULT Loader_4DS::cook(const char* filename) {
+    if(!_file.isOpen()) return I3DERR_FILENOTFOUND;
+
+    if(!_sourceHash) _sourceHash = I3D_HashData(_file.getData(), _file.getSize());
+    decodeTextures(true);
+
+    Writer writer;
+    auto writeText = [&writer](Text& text) {
+        text.str = writer.writePtr(text.str, text.length, 1);
+    };
+
+    ea::vector<Material> materials = _materials;
+    for(Material& material : materials) {
+        for(Text& map : material.maps)
+            writeText(map);
+    }
+
+    ea::vector<Lod> lods = _lods;
+    for(Lod& lod : lods)
+        lod.vertices = writer.writePtr(lod.vertices, size_t(lod.numVertices) * sizeof(I3D_vertex));
+
+    ea::vector<FaceGroup> faceGroups = _faceGroups;
+    for(FaceGroup& faceGroup : faceGroups)
+        faceGroup.faces = writer.writePtr(faceGroup.faces, size_t(faceGroup.numFaces) * 3 * sizeof(uint16_t));
+
+    ea::vector<Portal> portals = _portals;
+    for(Portal& portal : portals)
+        portal.vertices = writer.writePtr(portal.vertices, size_t(portal.numVertices) * sizeof(glm::vec3));
+
+    ea::vector<Frame> frames = _frames;
+    for(Frame& frame : frames) {
+        writeText(frame.name);
+        frame.hullVertices = writer.writePtr(frame.hullVertices, size_t(frame.numHullVertices) * sizeof(glm::vec3));
+        frame.hullFaces = writer.writePtr(frame.hullFaces, size_t(frame.numHullFaces) * 3 * sizeof(uint16_t));
+    }
+
+    ea::vector<CookedTexture> textures(_textures.size());
+    for(uint32_t i = 0; i < _textures.size(); ++i) {
+        const Texture& src = _textures[i];
+        CookedTexture& texture = textures[i];
+        texture = {};
+        texture.nameLength = uint32_t(strlen(src.name.c_str()));
+        texture.name = writer.write(src.name.c_str(), texture.nameLength, 1);
+        texture.opNameLength = uint32_t(strlen(src.opName.c_str()));
+        texture.opName = writer.write(src.opName.c_str(), texture.opNameLength, 1);
+        texture.page = src.page;
+        if(src.pixels) {
+            texture.width = src.width;
+            texture.height = src.height;
+            texture.numLevels = src.numLevels;
+            texture.format = src.format;
+            texture.pixels = writer.write(src.pixels, I3D_GetTextureSize(src.format, src.width, src.height, src.numLevels), COOKED_ALIGN);
+        }
+    }
+
+    CookedHeader header{};
+    memcpy(header.magic, "4DSC", 4);
+    header.version = VERSION_COOKED;
+    header.sourceHash = _sourceHash;
+    header.pointerSize = sizeof(void*);
+    writer.writeSection(header, SECTION_MATERIALS, materials);
+    writer.writeSection(header, SECTION_FRAMES, frames);
+    writer.writeSection(header, SECTION_LODS, lods);
+    writer.writeSection(header, SECTION_FACEGROUPS, faceGroups);
+    writer.writeSection(header, SECTION_PORTALS, portals);
+    writer.writeSection(header, SECTION_TEXTURES, textures);
+
+    ea::vector<uint8_t>& data = writer.getData();
+    header.size = data.size();
+    memcpy(data.data(), &header, sizeof(header));
+
+    FILE* file = fopen(filename, "wb");
+    if(!file) return I3DERR_FILENOTFOUND;
+
+    const bool written = fwrite(data.data(), 1, data.size(), file) == data.size();
+    if(fclose(file) != 0 || !written) {
+        remove(filename);
+        return I3DERR_FILENOTFOUND;
+    }
+    return I3D_OK;
+}
+
+//----------------------------
+
+I3D_RESULT Loader_4DS::openCooked(const char* filename, const char* source) {
+    close();
+    if(!_file.open(filename)) return I3DERR_FILENOTFOUND;
+
+    const Clock::time_point start = Clock::now();
+    const uint8_t* base = _file.getData();
+    const size_t size = _file.getSize();
+
+    CookedHeader header;
+    if(size < sizeof(header)) {
+        close();
+        return I3DERR_BADFORMAT;
+    }
+    memcpy(&header, base, sizeof(header));
+
+    if(memcmp(header.magic, "4DSC", 4) != 0 || header.size != size) {
+        close();
+        return I3DERR_BADFORMAT;
+    }
+
+    if(header.version != VERSION_COOKED || header.pointerSize != sizeof(void*)) {
+        close();
+        return I3DERR_OUTOFDATE;
+    }
+
+    if(source) {
+        I3D_mapped_file sourceFile;
+        if(!sourceFile.open(source) || I3D_HashData(sourceFile.getData(), sourceFile.getSize()) != header.sourceHash) {
+            close();
+            return I3DERR_OUTOFDATE;
+        }
+    }
+
+    // offsets are checked against the file, so a damaged cache can't send pointers elsewhere;
+    // only empty arrays may be null
+    bool failed = false;
+    auto fixup = [&](auto*& ptr, size_t bytes) {
+        using T = typename ea::remove_reference<decltype(ptr)>::type;
+        const uint64_t offset = uint64_t(uintptr_t(ptr));
+        if(offset == 0) {
+            ptr = nullptr;
+            failed = failed || bytes != 0;
+        } else if(offset < sizeof(header) || offset > size || bytes > size - offset) {
+            ptr = nullptr;
+            failed = true;
+        } else {
+            ptr = reinterpret_cast<T>(base + offset);
+        }
+    };
+
+    auto readSection = [&](COOKED_SECTION section, auto& records) {
+        using T = typename ea::remove_reference<decltype(records)>::type::value_type;
+        const uint64_t offset = header.offset[section];
+        const uint64_t bytes = uint64_t(header.count[section]) * sizeof(T);
+        if(offset % COOKED_ALIGN || offset > size || bytes > size - offset) {
+            failed = true;
+            return;
+        }
+        records.resize(header.count[section]);
+        if(bytes) memcpy(records.data(), base + offset, bytes);
+    };
+
+    readSection(SECTION_MATERIALS, _materials);
+    readSection(SECTION_FRAMES, _frames);
+    readSection(SECTION_LODS, _lods);
+    readSection(SECTION_FACEGROUPS, _faceGroups);
+    readSection(SECTION_PORTALS, _portals);
+
+    ea::vector<CookedTexture> textures;
+    readSection(SECTION_TEXTURES, textures);
+
+    for(Material& material : _materials) {
+        for(Text& map : material.maps)
+            fixup(map.str, map.length);
+    }
+
+    for(Frame& frame : _frames) {
+        fixup(frame.name.str, frame.name.length);
+        fixup(frame.hullVertices, size_t(frame.numHullVertices) * sizeof(glm::vec3));
+        fixup(frame.hullFaces, size_t(frame.numHullFaces) * 3 * sizeof(uint16_t));
+    }
+
+    for(Lod& lod : _lods)
+        fixup(lod.vertices, size_t(lod.numVertices) * sizeof(I3D_vertex));
+
+    for(FaceGroup& faceGroup : _faceGroups)
+        fixup(faceGroup.faces, size_t(faceGroup.numFaces) * 3 * sizeof(uint16_t));
+
+    for(Portal& portal : _portals)
+        fixup(portal.vertices, size_t(portal.numVertices) * sizeof(glm::vec3));
+
+    _textures.resize(textures.size());
+    for(uint32_t i = 0; i < textures.size(); ++i) {
+        CookedTexture& src = textures[i];
+        const char* name = reinterpret_cast<const char*>(uintptr_t(src.name));
+        const char* opName = reinterpret_cast<const char*>(uintptr_t(src.opName));
+        const uint8_t* pixels = reinterpret_cast<const uint8_t*>(uintptr_t(src.pixels));
+        fixup(name, src.nameLength);
+        fixup(opName, src.opNameLength);
+        const I3D_TEXTURE_FORMAT format = I3D_TEXTURE_FORMAT(src.format);
+        const bool validSize = format < TXTFMT_LAST && src.width <= 0xffff && src.height <= 0xffff &&
+                               src.numLevels <= I3D_GetNumMipLevels(src.width, src.height);
+        failed |= !validSize || src.page > textures.size() || src.page == i + 1;
+        fixup(pixels, validSize ? I3D_GetTextureSize(format, src.width, src.height, src.numLevels) : 0);
+
+        Texture& texture = _textures[i];
+        texture.name = name ? I3D_name(name, src.nameLength) : I3D_name();
+        texture.opName = opName ? I3D_name(opName, src.opNameLength) : I3D_name();
+        texture.pixels = pixels;
+        texture.width = src.width;
+        texture.height = src.height;
+        texture.numLevels = src.numLevels;
+        texture.format = validSize ? format : TXTFMT_RGBA8;
+        texture.page = src.page;
+    }
+
+    const I3D_RESULT result = failed ? I3DERR_BADFORMAT : checkReferences();
+    _stats = {};
+    _stats.parseMs = elapsedMs(start);
+
+    if(result != I3D_OK) {
+        close();
+        return result;
+    }
+
+    _sourceHash = header.sourceHash;
+    return I3D_OK;
+}
\ No newline at end of file
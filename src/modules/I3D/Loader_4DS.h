@@ -1 +1,186 @@
 #pragma once
+#include "I3D.h"
+#include "I3D_mapped_file.h"
+#include "I3D_image.h"
+#include "I3D_name.h"
+#include "I3D_texture.h"
+
+#include <EASTL/vector.h>
+#include <EASTL/string.h>
+#include <EASTL/shared_ptr.h>
+namespace ea = eastl;
+
+#include <glm/ext.hpp>
+
+class I3D_mesh;
+class I3D_material;
+
+//----------------------------
+// wall time of the load stages in milliseconds
+struct I3D_LOAD_STATS {
+    float parseMs{};
+    float buildMs{};
+    float decodeMs{};
+    float createMs{};
+    float uploadMs{};
+    uint32_t numMeshes{};
+    uint32_t numTextures{};
+    uint32_t numFrames{};
+};
+
+//----------------------------
+// Loader of LS3D .4DS models, version 29. The file is memory mapped and parsed in place - parsed
+// records only point into the mapping, and vertex / index data go from there straight to the device,
+// so loading is bound by reading the file, not by copies and allocations.
+//
+// Loading runs in stages: the file is scanned serially, meshes are validated and built and textures
+// decoded on the driver's workers, frames are created on the calling thread and finally buffers and
+// images are uploaded - the calling thread is expected to be the render thread.
+class Loader_4DS {
+public:
+    Loader_4DS(I3D_driver* driver);
+
+    // directory texture names are relative to, with a trailing separator
+    void setTexturePath(const char* path) { _texturePath = path; }
+
+    // Pack small diffuse maps into atlas pages of this width, 0 = off. Faces of packed maps get
+    // their UVs moved to the page, so materials sharing a page bind the same texture.
+    void setAtlasSize(uint32_t size) { _atlasSize = size; }
+
+    // open + create + close
+    I3D_RESULT load(const char* filename, I3D_frame* root);
+
+    // map and parse the file
+    I3D_RESULT open(const char* filename);
+
+    // Write the opened model with its textures decoded to a cooked file. The cooked file is
+    // position independent with 16-byte aligned sections, so openCooked() is a single mapping
+    // plus pointer fix-ups, and vertices, indices and pixels go to the device as they are.
+    I3D_RESULT cook(const char* filename);
+
+    // map a cooked file instead of open(); with 'source' set it fails with I3DERR_OUTOFDATE
+    // unless the cooked file was made from the current content of the source
+    I3D_RESULT openCooked(const char* filename, const char* source = nullptr);
+
+    // create materials, meshes and frames of the opened model, its root frames are linked under 'root'
+    I3D_RESULT create(I3D_frame* root);
+
+    void close();
+
+    uint32_t getNumMaterials() const { return uint32_t(_materials.size()); }
+    uint32_t getNumFrames() const { return uint32_t(_frames.size()); }
+    const I3D_LOAD_STATS& getStats() const { return _stats; }
+private:
+    // not null-terminated string in the file
+    struct Text {
+        const char* str;
+        uint8_t length;
+    };
+
+    struct Material {
+        uint32_t flags;
+        glm::vec3 ambient;
+        glm::vec3 diffuse;
+        glm::vec3 emissive;
+        float alpha;
+        float envRatio;
+        Text maps[3];   // I3D_MATERIAL_MAP
+        uint32_t animFrames;
+        uint32_t animDelay;
+    };
+
+    struct FaceGroup {
+        const uint8_t* faces;       // 3 x uint16 per face
+        uint32_t numFaces;
+        uint32_t material;          // 1-based, 0 = none
+    };
+
+    struct Lod {
+        float distance;
+        const uint8_t* vertices;    // I3D_vertex
+        uint32_t numVertices;
+        uint32_t firstFaceGroup;
+        uint32_t numFaceGroups;
+    };
+
+    struct Portal {
+        const uint8_t* vertices;    // glm::vec3
+        uint32_t numVertices;
+        uint32_t flags;
+    };
+
+    struct Frame {
+        uint8_t type;               // I3D_FRAME_TYPE
+        uint8_t visualType;         // I3D_VISUAL_TYPE
+        uint16_t renderFlags;
+        uint32_t parent;            // 1-based frame index, 0 = root
+        glm::vec3 pos;
+        glm::vec3 scale;
+        glm::quat rot;
+        Text name;
+
+        // visuals, mesh of frame 'instance' (1-based) is shared if set
+        uint32_t instance;
+        uint32_t firstLod;
+        uint32_t numLods;
+
+        // dummies, sectors, occluders
+        I3D_bbox bbox;
+        const uint8_t* hullVertices;
+        uint32_t numHullVertices;
+        const uint8_t* hullFaces;
+        uint32_t numHullFaces;
+        uint32_t firstPortal;
+        uint32_t numPortals;
+    };
+
+    class Reader;
+    class Writer;
+
+    I3D_RESULT parse();
+    I3D_RESULT checkReferences() const;
+    void parseMaterial(Reader& reader, Material& material);
+    I3D_RESULT parseFrame(Reader& reader, Frame& frame);
+    void parseMesh(Reader& reader, Frame& frame);
+    void parseSector(Reader& reader, Frame& frame);
+
+    I3D_RESULT buildMeshes(const ea::vector<ea::shared_ptr<I3D_material>>& materials, ea::vector<ea::shared_ptr<I3D_mesh>>& meshes);
+    void decodeTextures(bool all);
+    void buildAtlas(bool all);
+    void uploadTextures(const ea::vector<ea::shared_ptr<I3D_material>>& materials);
+
+    I3D_driver* _driver{ nullptr };
+    I3D_mapped_file _file{};
+    uint64_t _sourceHash{};     // 0 until known
+    ea::string _texturePath{};
+    uint32_t _atlasSize{};
+    I3D_LOAD_STATS _stats{};
+
+    // unique texture maps of the model, decoded by workers and uploaded on the render thread;
+    // an alpha map is merged into the alpha of its diffuse map, small maps may share atlas pages
+    struct Texture {
+        I3D_name name;
+        I3D_name opName;
+        I3D_image image;
+        const uint8_t* pixels;      // mip chain, null if not loaded
+        uint32_t width;
+        uint32_t height;
+        uint32_t numLevels;
+        I3D_TEXTURE_FORMAT format;
+        uint32_t page;              // 1-based atlas page in _textures the map is packed to, 0 = none
+        uint32_t maxLevels;         // mip levels to generate, 0 = all
+    };
+    ea::vector<Texture> _textures{};
+
+    // vertices of lods with UVs moved to atlas pages, the lods point here instead of the mapping
+    ea::vector<ea::vector<uint8_t>> _atlasVertices{};
+
+    I3D_CREATETEXTURE textureParams(const Texture& texture) const;
+    static uint64_t textureKey(const I3D_name& name, const I3D_name& opName) { return (uint64_t(name.getId()) << 32) | opName.getId(); }
+
+    ea::vector<Material> _materials{};
+    ea::vector<Frame> _frames{};
+    ea::vector<Lod> _lods{};
+    ea::vector<FaceGroup> _faceGroups{};
+    ea::vector<Portal> _portals{};
+};
\ No newline at end of file
@@ -80,33 +80,38 @@ void IDevice::destroy() {
 	sg_shutdown();
 }
 
-Image createImage(const ImageDesc& imageDesc) {
+Image IDevice::createImage(const ImageDesc& imageDesc) {
 	return sg_make_image(imageDesc);
 }
 
-void destroyImage(Image& imageHandle) {
+void IDevice::destroyImage(Image& imageHandle) {
 	sg_destroy_image(imageHandle);
 	imageHandle.id = SG_INVALID_ID;
 }
 
-void bindImage(const Image& imageHandle, int samplerId) {
+void IDevice::bindImage(const Image& imageHandle, int samplerId) {
 	state.default_bindings.fs_images[samplerId] = imageHandle;
 }
 
-Buffer createBuffer(const BufferDesc& bufferDesc) {
+bool IDevice::isPixelFormatSupported(PixelFormat format) {
+	const sg_pixelformat_info info = sg_query_pixelformat(format);
+	return info.sample && info.filter;
+}
+
+Buffer IDevice::createBuffer(const BufferDesc& bufferDesc) {
 	return sg_make_buffer(bufferDesc);
 }
 
-void destroyBuffer(Buffer& bufferHandle) {
+void IDevice::destroyBuffer(Buffer& bufferHandle) {
 	sg_destroy_buffer(bufferHandle);
 	bufferHandle.id = SG_INVALID_ID;
 }
 
-void bindVertexBuffer(const Buffer& bufferHandle) {
+void IDevice::bindVertexBuffer(const Buffer& bufferHandle) {
 	state.default_bindings.vertex_buffers[0] = bufferHandle;
 }
 
-void bindIndexBuffer(const Buffer& bufferHandle) {
+void IDevice::bindIndexBuffer(const Buffer& bufferHandle) {
 	state.default_bindings.index_buffer = bufferHandle;
 }
 
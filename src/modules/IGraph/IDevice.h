@@ -14,6 +14,7 @@ using Image = sg_image;
 //typedef sg_pass      Pass;
 //typedef sg_context   Context;
 using ImageDesc = sg_image_desc;
+using PixelFormat = sg_pixel_format;
 using BufferDesc = sg_buffer_desc;
 
 class IDevice {
@@ -24,6 +25,7 @@ public:
     Image createImage(const ImageDesc& imageDesc);
     void destroyImage(Image& imageHandle);
     void bindImage(const Image& imageHandle, int samplerId);
+    bool isPixelFormatSupported(PixelFormat format);
 
     Buffer createBuffer(const BufferDesc& bufferDesc);
     void destroyBuffer(Buffer& bufferHnalde);